@@ -0,0 +1,71 @@
+/*
+  ==============================================================================
+
+    AllocationCounter.cpp
+
+  ==============================================================================
+*/
+
+#include "AllocationCounter.h"
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+    thread_local juce::int64 numAllocations = 0;
+
+    void* allocate(std::size_t size)
+    {
+        ++numAllocations;
+
+        if (auto* memory = std::malloc(size == 0 ? 1 : size))
+            return memory;
+
+        throw std::bad_alloc();
+    }
+
+    void* allocateAligned(std::size_t size, std::align_val_t alignment)
+    {
+        ++numAllocations;
+
+        void* memory = nullptr;
+        auto align = juce::jmax(sizeof(void*), static_cast<std::size_t>(alignment));
+
+        if (posix_memalign(&memory, align, size == 0 ? 1 : size) == 0)
+            return memory;
+
+        throw std::bad_alloc();
+    }
+}
+
+juce::int64 AllocationCounter::getNumAllocations() noexcept
+{
+    return numAllocations;
+}
+
+//==============================================================================
+void* operator new (std::size_t size)                                           { return allocate(size); }
+void* operator new[] (std::size_t size)                                         { return allocate(size); }
+void* operator new (std::size_t size, std::align_val_t alignment)               { return allocateAligned(size, alignment); }
+void* operator new[] (std::size_t size, std::align_val_t alignment)             { return allocateAligned(size, alignment); }
+
+void* operator new (std::size_t size, const std::nothrow_t&) noexcept
+{
+    try { return allocate(size); } catch (...) { return nullptr; }
+}
+
+void* operator new[] (std::size_t size, const std::nothrow_t&) noexcept
+{
+    try { return allocate(size); } catch (...) { return nullptr; }
+}
+
+void operator delete (void* memory) noexcept                                    { std::free(memory); }
+void operator delete[] (void* memory) noexcept                                  { std::free(memory); }
+void operator delete (void* memory, std::size_t) noexcept                       { std::free(memory); }
+void operator delete[] (void* memory, std::size_t) noexcept                     { std::free(memory); }
+void operator delete (void* memory, std::align_val_t) noexcept                  { std::free(memory); }
+void operator delete[] (void* memory, std::align_val_t) noexcept                { std::free(memory); }
+void operator delete (void* memory, std::size_t, std::align_val_t) noexcept     { std::free(memory); }
+void operator delete[] (void* memory, std::size_t, std::align_val_t) noexcept   { std::free(memory); }
+void operator delete (void* memory, const std::nothrow_t&) noexcept             { std::free(memory); }
+void operator delete[] (void* memory, const std::nothrow_t&) noexcept           { std::free(memory); }
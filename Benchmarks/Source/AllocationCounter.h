@@ -0,0 +1,22 @@
+/*
+  ==============================================================================
+
+    AllocationCounter.h
+
+    The benchmarks replace the global operator new to count how often the
+    heap is hit. The count is kept per thread, so only allocations made by
+    the thread calling processBlock are seen, not the ones made by the
+    background coefficient designer.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+namespace AllocationCounter
+{
+    // allocations made by the calling thread since it started
+    juce::int64 getNumAllocations() noexcept;
+}
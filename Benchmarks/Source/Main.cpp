@@ -0,0 +1,1467 @@
+/*
+  ==============================================================================
+
+    This file contains the basic startup code for the SimpleEQ benchmarks.
+
+    Runs SimpleeqAudioProcessor without a host or editor and measures
+    what processBlock and the coefficient updates cost, so we can compare
+    engines and catch performance regressions between releases.
+
+    Every processBlock measurement starts from one baseline (48 kHz, 512
+    samples, stereo, 48 dB/oct on both cuts) and sweeps one dimension at a
+    time: block size, sample rate, slope combination and channel layout,
+    each with static and automated parameters, for every engine, in
+    single and double precision. The baseline is also run with the
+    spectrum analyser active, to check its audio thread cost against
+    SpectrumAnalyser::maxAudioThreadOverhead, and on digital silence, where
+    the processor sleeps, and in the dual stereo modes, checked against
+    StereoCascade::maxCostRatio times linked stereo.
+
+    Independent tracks with different settings are measured once through
+    one cascade per track and once batched into SIMD lanes by
+    MultiTrackCascade. The dynamic peak band is checked against its
+    budget of DynamicPeak::maxCostRatio times the static peak, and the
+    FilterBank with 0 to 24 live bands, to show its cost grows linearly.
+    So should the cost of the cut slopes up to 96 dB/oct, which run on
+    their own at sample rates up to 384 kHz, where we also check their
+    float error and that they stay stable.
+    The LinearPhaseEngine is run on its own at several kernel lengths and
+    checked against its CPU budget, LinearPhaseEngine::getCpuBudget.
+    Finally setStateInformation is timed with the state formats of earlier
+    releases and the compact one, against recalling a preset.
+
+    This is also the allocation test: the benchmarks exit with 1 if any
+    processBlock measurement hit the heap on the audio thread. So they do
+    if an engine measured on its own allocates, misses its budget, or a
+    cut slope is not stable.
+
+    Usage: simple-eq-benchmarks [--json results.json] [--quick]
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "../../Source/PluginProcessor.h"
+#include "../../Source/MultiTrackCascade.h"
+#include "AllocationCounter.h"
+
+#if JUCE_INTEL
+ #include <x86intrin.h>
+#endif
+
+namespace
+{
+    using Engine = SimpleeqAudioProcessor::Engine;
+
+    const std::vector<std::pair<Engine, juce::String>> engines
+    {
+        { Engine::ProcessorChain, "chain" },
+        { Engine::FusedCascade,   "fused" },
+        { Engine::SimdCascade,    "simd" },
+        { Engine::SmoothedSvf,    "smoothed" },
+        { Engine::LinearPhase,    "linear" }
+    };
+
+    const juce::StringArray slopeNames { "12", "24", "36", "48", "72", "96", "LR24", "LR48" };
+
+    //==============================================================================
+    // cpu cycles, the time stamp counter on intel, otherwise derived from
+    // the time and the nominal clock speed. Both count at the nominal rate,
+    // so turbo or power saving shows up as fewer or more cycles per sample.
+    struct CycleCounter
+    {
+        static juce::int64 now() noexcept
+        {
+           #if JUCE_INTEL
+            return (juce::int64) __rdtsc();
+           #else
+            return 0;
+           #endif
+        }
+
+        static double toCycles(juce::int64 cycles, juce::int64 ticks)
+        {
+           #if JUCE_INTEL
+            juce::ignoreUnused(ticks);
+            return (double) cycles;
+           #else
+            juce::ignoreUnused(cycles);
+            return juce::Time::highResolutionTicksToSeconds(ticks)
+                     * juce::SystemStats::getCpuSpeedInMegahertz() * 1.0e6;
+           #endif
+        }
+    };
+
+    // time, cycles and heap allocations of the code between start() and stop()
+    struct Measurement
+    {
+        void start() noexcept
+        {
+            startAllocations = AllocationCounter::getNumAllocations();
+            startCycles = CycleCounter::now();
+            startTicks = juce::Time::getHighResolutionTicks();
+        }
+
+        void stop() noexcept
+        {
+            auto endTicks = juce::Time::getHighResolutionTicks();
+            auto endCycles = CycleCounter::now();
+
+            ticks += endTicks - startTicks;
+            cycles += endCycles - startCycles;
+            allocations += AllocationCounter::getNumAllocations() - startAllocations;
+        }
+
+        double getNanoseconds() const     { return juce::Time::highResolutionTicksToSeconds(ticks) * 1.0e9; }
+        double getCycles() const          { return CycleCounter::toCycles(cycles, ticks); }
+
+        juce::int64 ticks = 0, cycles = 0, allocations = 0;
+        juce::int64 startTicks = 0, startCycles = 0, startAllocations = 0;
+    };
+
+    //==============================================================================
+    // sets a parameter from its real world value (Hz, dB, choice index...)
+    void setParameter(SimpleeqAudioProcessor& processor, const juce::String& parameterID, float value)
+    {
+        auto* parameter = processor.apvts.getParameter(parameterID);
+        jassert(parameter != nullptr);
+        parameter->setValueNotifyingHost(parameter->convertTo0to1(value));
+    }
+
+    // a setting where every band does something
+    void setBaselineParameters(SimpleeqAudioProcessor& processor)
+    {
+        setParameter(processor, "LowCut Freq", 80.f);
+        setParameter(processor, "HighCut Freq", 12000.f);
+        setParameter(processor, "Peak Freq", 1000.f);
+        setParameter(processor, "Peak Gain", 6.f);
+        setParameter(processor, "Peak Quality", 1.f);
+        setParameter(processor, "LowCut Slope", (float) Slope_48);
+        setParameter(processor, "HighCut Slope", (float) Slope_48);
+
+        // the second set of the dual stereo modes, a different peak
+        const juce::String rightSide { rightSideParameterPrefix };
+        setParameter(processor, rightSide + "LowCut Freq", 80.f);
+        setParameter(processor, rightSide + "HighCut Freq", 12000.f);
+        setParameter(processor, rightSide + "Peak Freq", 3000.f);
+        setParameter(processor, rightSide + "Peak Gain", -6.f);
+        setParameter(processor, rightSide + "Peak Quality", 1.f);
+        setParameter(processor, rightSide + "LowCut Slope", (float) Slope_48);
+        setParameter(processor, rightSide + "HighCut Slope", (float) Slope_48);
+    }
+
+    // the peak sweeps between two settings, like a fast automation lane
+    void automatePeak(SimpleeqAudioProcessor& processor, int step)
+    {
+        setParameter(processor, "Peak Freq", step % 2 == 0 ? 500.f : 2000.f);
+        setParameter(processor, "Peak Gain", step % 2 == 0 ? -12.f : 12.f);
+    }
+
+    // a different setting for every track of a session
+    ChainSettings makeTrackSettings(int track)
+    {
+        ChainSettings settings;
+        settings.lowCutFreq = 20.f + float(track % 7) * 15.f;
+        settings.highCutFreq = 20000.f - float(track % 5) * 2000.f;
+        settings.peakFreq = 100.f * float(1 + track % 30);
+        settings.peakGainInDecibles = float(track % 25) - 12.f;
+        settings.peakQuality = 0.5f + float(track % 4) * 0.5f;
+        settings.lowCutSlope = static_cast<Slope>(track % 4);
+        settings.highCutSlope = static_cast<Slope>((track / 4) % 4);
+        return settings;
+    }
+
+    // white noise in every channel, used as input for all measurements
+    juce::AudioBuffer<float> makeNoise(int numChannels, int numSamples)
+    {
+        juce::AudioBuffer<float> noise(numChannels, numSamples);
+        juce::Random random(42);
+
+        for (int channel = 0; channel < numChannels; ++channel)
+            for (int i = 0; i < numSamples; ++i)
+                noise.setSample(channel, i, random.nextFloat() * 2.f - 1.f);
+
+        return noise;
+    }
+
+    //==============================================================================
+    struct BenchmarkPoint
+    {
+        juce::String sweep, layoutName;
+        Engine engine = Engine::SimdCascade;
+        juce::String engineName;
+        double sampleRate = 48000.0;
+        int blockSize = 512;
+        juce::AudioChannelSet layout = juce::AudioChannelSet::stereo();
+        Slope lowCutSlope = Slope_48, highCutSlope = Slope_48;
+        bool automated = false;
+        bool doublePrecision = false;
+        bool analyser = false;
+        bool silent = false;
+        StereoMode stereoMode = StereoMode::Linked;
+    };
+
+    struct BenchmarkResult
+    {
+        double nanosPerSample = 0, cyclesPerSample = 0, allocationsPerCall = 0;
+    };
+
+    struct Options
+    {
+        juce::File jsonFile = juce::File::getCurrentWorkingDirectory().getChildFile("benchmark-results.json");
+        bool quick = false;
+    };
+
+    // the input is processed in passes of this many samples, refilled with
+    // the same noise before each pass so the signal level never runs away
+    constexpr int passLength = 1 << 15;
+
+    // automated parameters move every this many samples, or every block
+    // if the blocks are longer
+    constexpr int automationInterval = 256;
+
+    /*
+        Runs processBlock over consecutive slices of the noise, like a host
+        would. Only processBlock is timed: the host side parameter changes
+        and the refills between passes are not. Blocks are timed in runs of
+        at least automationInterval samples so the timer itself stays out
+        of the result even for single sample blocks.
+    */
+    template <typename SampleType>
+    BenchmarkResult measure(SimpleeqAudioProcessor& processor, const BenchmarkPoint& point,
+                            const juce::AudioBuffer<float>& noise, int numPasses)
+    {
+        setParameter(processor, "LowCut Slope", (float) point.lowCutSlope);
+        setParameter(processor, "HighCut Slope", (float) point.highCutSlope);
+        setParameter(processor, "Stereo Mode", (float) point.stereoMode);
+
+        processor.setEngine(point.engine);
+        processor.setProcessingPrecision(std::is_same<SampleType, double>::value ? juce::AudioProcessor::doublePrecision
+                                                                                 : juce::AudioProcessor::singlePrecision);
+
+        // prepareToPlay designs the coefficients synchronously,
+        // so the measurement starts with the current settings
+        processor.prepareToPlay(point.sampleRate, point.blockSize);
+
+        // as if the editor was open: the audio thread feeds the analyser
+        // and its thread runs fft's next to us
+        processor.getAnalyser().setActive(point.analyser);
+
+        auto numChannels = noise.getNumChannels();
+        auto blocksPerPass = juce::jmax(1, passLength / point.blockSize);
+        auto blocksPerRun = juce::jmax(1, automationInterval / point.blockSize);
+
+        juce::AudioBuffer<SampleType> pass(numChannels, blocksPerPass * point.blockSize);
+        juce::MidiBuffer midiMessages;
+        std::vector<SampleType*> channels((size_t) numChannels);
+
+        Measurement measurement;
+        juce::int64 numCalls = 0;
+        int automationStep = 0;
+
+        // the first pass only warms up caches and branch predictors
+        for (int passIndex = 0; passIndex <= numPasses; ++passIndex)
+        {
+            for (int channel = 0; channel < numChannels; ++channel)
+            {
+                auto* source = noise.getReadPointer(channel);
+                auto* destination = pass.getWritePointer(channel);
+
+                for (int i = 0; i < pass.getNumSamples(); ++i)
+                    destination[i] = point.silent ? SampleType(0) : static_cast<SampleType>(source[i % noise.getNumSamples()]);
+            }
+
+            auto timed = passIndex > 0;
+
+            for (int block = 0; block < blocksPerPass; block += blocksPerRun)
+            {
+                if (point.automated)
+                    automatePeak(processor, automationStep++);
+
+                auto runEnd = juce::jmin(blocksPerPass, block + blocksPerRun);
+
+                if (timed)
+                    measurement.start();
+
+                for (int i = block; i < runEnd; ++i)
+                {
+                    for (int channel = 0; channel < numChannels; ++channel)
+                        channels[(size_t) channel] = pass.getWritePointer(channel, i * point.blockSize);
+
+                    juce::AudioBuffer<SampleType> buffer(channels.data(), numChannels, point.blockSize);
+                    processor.processBlock(buffer, midiMessages);
+                }
+
+                if (timed)
+                {
+                    measurement.stop();
+                    numCalls += runEnd - block;
+                }
+            }
+        }
+
+        // leave the peak where the other measurements expect it
+        if (point.automated)
+            setBaselineParameters(processor);
+
+        processor.getAnalyser().setActive(false);
+
+        auto numSamples = double(numCalls) * point.blockSize * numChannels;
+
+        BenchmarkResult result;
+        result.nanosPerSample = measurement.getNanoseconds() / numSamples;
+        result.cyclesPerSample = measurement.getCycles() / numSamples;
+        result.allocationsPerCall = double(measurement.allocations) / double(numCalls);
+        return result;
+    }
+
+    //==============================================================================
+    /*
+        The coefficient updates on their own: designing each band (what
+        updateLowCutFilters, updatePeakFilter and updateHighCutFilters used
+        to do on the audio thread, now done by the CoefficientDesigner) and
+        loading a designed set into the cascades, which is all that is left
+        on the audio thread. The frequency changes on every call so nothing
+        can be cached.
+    */
+    struct UpdateBenchmark
+    {
+        juce::String name;
+        std::function<float (int iteration)> run;
+    };
+
+    std::vector<UpdateBenchmark> makeUpdateBenchmarks(double sampleRate)
+    {
+        auto table = CutCoefficientTable::getFor(sampleRate);
+
+        auto settingsFor = [](int iteration, Slope slope)
+        {
+            ChainSettings settings;
+            settings.lowCutFreq = 20.f + float(iteration % 1000);
+            settings.highCutFreq = 20000.f - float(iteration % 1000) * 10.f;
+            settings.peakFreq = 200.f + float(iteration % 1000) * 5.f;
+            settings.peakGainInDecibles = float(iteration % 48) - 24.f;
+            settings.peakQuality = 1.f;
+            settings.lowCutSlope = slope;
+            settings.highCutSlope = slope;
+            return settings;
+        };
+
+        std::vector<UpdateBenchmark> benchmarks;
+
+        benchmarks.push_back({ "design peak", [=](int iteration)
+        {
+            return CoefficientDesigner::designPeak(settingsFor(iteration, Slope_12), sampleRate).b0;
+        }});
+
+        for (int slope = Slope_12; slope < numSlopes; ++slope)
+        {
+            benchmarks.push_back({ "design low cut " + slopeNames[slope], [=](int iteration)
+            {
+                return CoefficientDesigner::designLowCut(settingsFor(iteration, (Slope) slope), *table).sections[0].b0;
+            }});
+
+            benchmarks.push_back({ "design high cut " + slopeNames[slope], [=](int iteration)
+            {
+                return CoefficientDesigner::designHighCut(settingsFor(iteration, (Slope) slope), *table).sections[0].b0;
+            }});
+        }
+
+        // the design the plugin used before the prewarp table, for reference
+        benchmarks.push_back({ "juce butterworth 48", [=](int iteration)
+        {
+            auto settings = settingsFor(iteration, Slope_48);
+            auto coefficients = juce::dsp::FilterDesign<float>::designIIRHighpassHighOrderButterworthMethod(settings.lowCutFreq,
+                                                                                                              sampleRate, 8);
+            return coefficients[0]->coefficients[0];
+        }});
+
+        // what an instance pays when another one already uses its settings:
+        // a lookup in the process wide cache (see CoefficientService.h).
+        // The sets are held so they stay cached, like instances would
+        auto service = CoefficientService::getInstance();
+        auto heldSets = std::make_shared<std::vector<std::shared_ptr<const CoefficientSet>>>();
+
+        for (int i = 0; i < 16; ++i)
+            heldSets->push_back(service->getDesign({ sampleRate, settingsFor(i, Slope_48) }));
+
+        benchmarks.push_back({ "shared design cached", [=](int iteration)
+        {
+            return (float) service->getDesign({ sampleRate, settingsFor(iteration % 16, Slope_48) })->peak.b0;
+        }});
+
+        // two designed sets, loaded alternately
+        auto makeSet = [=](int iteration)
+        {
+            auto settings = settingsFor(iteration, Slope_48);
+
+            CoefficientSet set;
+            set.sampleRate = sampleRate;
+            set.peak = CoefficientDesigner::designPeak(settings, sampleRate);
+            set.lowCut = CoefficientDesigner::designLowCut(settings, *table);
+            set.highCut = CoefficientDesigner::designHighCut(settings, *table);
+            return set;
+        };
+
+        std::array<CoefficientSet, 2> sets { makeSet(0), makeSet(500) };
+
+        auto cascade = std::make_shared<SosCascade<float>>();
+        cascade->prepare(2);
+
+        benchmarks.push_back({ "load fused cascade", [=](int iteration)
+        {
+            cascade->setCoefficients(sets[(size_t) iteration % 2]);
+            return float(iteration);
+        }});
+
+        auto multichannelCascade = std::make_shared<MultichannelCascade<float>>();
+        multichannelCascade->prepare(2, 512);
+
+        benchmarks.push_back({ "load simd cascade", [=](int iteration)
+        {
+            multichannelCascade->setCoefficients(sets[(size_t) iteration % 2]);
+            return float(iteration);
+        }});
+
+        auto doubleCascade = std::make_shared<MultichannelCascade<double>>();
+        doubleCascade->prepare(2, 512);
+
+        benchmarks.push_back({ "load simd cascade 64", [=](int iteration)
+        {
+            doubleCascade->setCoefficients(sets[(size_t) iteration % 2]);
+            return float(iteration);
+        }});
+
+        return benchmarks;
+    }
+
+    //==============================================================================
+    // a low cut of the given slope on its own, the high cut off and the peak flat
+    CoefficientSet makeCutOrderSet(const CutCoefficientTable& table, Slope slope, float frequency)
+    {
+        ChainSettings settings;
+        settings.lowCutFreq = frequency;
+        settings.lowCutSlope = slope;
+        settings.highCutFreq = CutCoefficientTable::maxFrequency;
+
+        CoefficientSet set;
+        set.sampleRate = table.getSampleRate();
+        set.lowCut = CoefficientDesigner::designLowCut(settings, table);
+        set.highCut = CoefficientDesigner::designHighCut(settings, table);
+        return set;
+    }
+
+    // stereo blocks through one cascade, the first pass warms up the caches
+    template <typename SampleType>
+    BenchmarkResult measureCascade(const CoefficientSet& set, const juce::AudioBuffer<float>& input, int numBlocks)
+    {
+        SosCascade<SampleType> cascade;
+        cascade.prepare(input.getNumChannels());
+        cascade.setCoefficients(set);
+
+        juce::AudioBuffer<SampleType> buffer(input.getNumChannels(), input.getNumSamples());
+        juce::dsp::AudioBlock<SampleType> block(buffer);
+        Measurement measurement;
+
+        for (int pass = 0; pass < numBlocks + 1; ++pass)
+        {
+            for (int channel = 0; channel < input.getNumChannels(); ++channel)
+                for (int i = 0; i < input.getNumSamples(); ++i)
+                    buffer.setSample(channel, i, static_cast<SampleType>(input.getSample(channel, i)));
+
+            if (pass > 0)
+                measurement.start();
+
+            cascade.process(block);
+
+            if (pass > 0)
+                measurement.stop();
+        }
+
+        auto numSamples = double(numBlocks) * input.getNumSamples() * input.getNumChannels();
+
+        BenchmarkResult result;
+        result.nanosPerSample = measurement.getNanoseconds() / numSamples;
+        result.cyclesPerSample = measurement.getCycles() / numSamples;
+        result.allocationsPerCall = double(measurement.allocations) / numBlocks;
+        return result;
+    }
+
+    struct CutAccuracy
+    {
+        // the float cascade against the double one on the same noise,
+        // in dB relative to the signal
+        double errorInDecibels = 0.0;
+
+        // both stayed finite and rang out after an impulse
+        bool stable = true;
+    };
+
+    CutAccuracy measureCutAccuracy(const CoefficientSet& set, int numSamples)
+    {
+        constexpr int blockSize = 512;
+
+        SosCascade<float> single;
+        SosCascade<double> reference;
+        single.prepare(1);
+        reference.prepare(1);
+        single.setCoefficients(set);
+        reference.setCoefficients(set);
+
+        std::vector<float> singleBlock(blockSize);
+        std::vector<double> referenceBlock(blockSize);
+        juce::Random random(42);
+
+        CutAccuracy accuracy;
+        double errorEnergy = 0.0, signalEnergy = 0.0;
+
+        // a quarter of the noise lets the cascades settle before we compare
+        for (int start = 0; start < numSamples; start += blockSize)
+        {
+            for (int i = 0; i < blockSize; ++i)
+                referenceBlock[(size_t) i] = singleBlock[(size_t) i] = random.nextFloat() * 2.f - 1.f;
+
+            single.process(singleBlock.data(), blockSize, 0);
+            reference.process(referenceBlock.data(), blockSize, 0);
+
+            for (int i = 0; i < blockSize && start >= numSamples / 4; ++i)
+            {
+                auto error = (double) singleBlock[(size_t) i] - referenceBlock[(size_t) i];
+                errorEnergy += error * error;
+                signalEnergy += referenceBlock[(size_t) i] * referenceBlock[(size_t) i];
+                accuracy.stable = accuracy.stable && std::isfinite(singleBlock[(size_t) i]);
+            }
+        }
+
+        accuracy.errorInDecibels = juce::Decibels::gainToDecibels(std::sqrt(errorEnergy / juce::jmax(signalEnergy, 1.0e-30)), -300.0);
+
+        // an impulse, then silence for twice the time the set should take to
+        // fall below -120 dB, after which both have to be below -100 dB
+        single.reset();
+        reference.reset();
+
+        auto ringLength = juce::jmin(2 * set.getDecayLengthInSamples(1.0e-6), 1 << 24);
+        double tail = 0.0;
+
+        for (int start = 0; start < ringLength + blockSize; start += blockSize)
+        {
+            std::fill(singleBlock.begin(), singleBlock.end(), 0.f);
+            std::fill(referenceBlock.begin(), referenceBlock.end(), 0.0);
+            singleBlock[0] = start == 0 ? 1.f : 0.f;
+            referenceBlock[0] = singleBlock[0];
+
+            single.process(singleBlock.data(), blockSize, 0);
+            reference.process(referenceBlock.data(), blockSize, 0);
+
+            if (start >= ringLength)
+                for (int i = 0; i < blockSize; ++i)
+                    tail = juce::jmax(tail, (double) std::abs(singleBlock[(size_t) i]), std::abs(referenceBlock[(size_t) i]));
+        }
+
+        accuracy.stable = accuracy.stable && std::isfinite(tail) && tail < 1.0e-5;
+        return accuracy;
+    }
+
+    //==============================================================================
+    // the json results: the details of the run, then per section an array
+    // with one object per case
+    class Report
+    {
+    public:
+        explicit Report(const Options& options)
+        {
+            root->setProperty("version", 1);
+            root->setProperty("time", juce::Time::getCurrentTime().toISO8601(true));
+            root->setProperty("cpu", juce::SystemStats::getCpuModel());
+            root->setProperty("cpuMHz", juce::SystemStats::getCpuSpeedInMegahertz());
+            root->setProperty("os", juce::SystemStats::getOperatingSystemName());
+            root->setProperty("quick", options.quick);
+        }
+
+        // a new object at the end of the section's array
+        juce::DynamicObject& addCase(const juce::Identifier& section)
+        {
+            if (! root->hasProperty(section))
+                root->setProperty(section, juce::Array<juce::var>());
+
+            auto* object = new juce::DynamicObject();
+            root->getProperty(section).getArray()->add(juce::var(object));
+            return *object;
+        }
+
+        // keeps the limit with the case and returns whether the value is
+        // within it. A case over budget is a failure
+        bool checkBudget(juce::DynamicObject& object, const juce::String& what, double value, double limit)
+        {
+            auto withinBudget = value <= limit;
+            object.setProperty("budget", limit);
+            object.setProperty("withinBudget", withinBudget);
+
+            if (! withinBudget)
+                fail(what + " over budget: " + juce::String(value, 3) + " > " + juce::String(limit, 3));
+
+            return withinBudget;
+        }
+
+        // the audio thread side of every engine has to stay off the heap
+        void checkAllocations(const juce::String& what, double allocationsPerCall)
+        {
+            if (allocationsPerCall > 0.0)
+                fail(what + " allocates: " + juce::String(allocationsPerCall, 3) + " per call");
+        }
+
+        bool write(const juce::File& file) const
+        {
+            return file.replaceWithText(juce::JSON::toString(juce::var(root.get())));
+        }
+
+        // a case that failed its check, the benchmarks then exit with 1
+        void fail(const juce::String& what)                 { failures.add(what); }
+        const juce::StringArray& getFailures() const        { return failures; }
+
+    private:
+        juce::DynamicObject::Ptr root { new juce::DynamicObject() };
+        juce::StringArray failures;
+    };
+
+    void addProperties(juce::DynamicObject& object, const BenchmarkPoint& point, const BenchmarkResult& result)
+    {
+        object.setProperty("sweep", point.sweep);
+        object.setProperty("engine", point.engineName);
+        object.setProperty("sampleRate", point.sampleRate);
+        object.setProperty("blockSize", point.blockSize);
+        object.setProperty("layout", point.layoutName);
+        object.setProperty("channels", point.layout.size());
+        object.setProperty("lowCutSlope", slopeNames[point.lowCutSlope].getTrailingIntValue());
+        object.setProperty("highCutSlope", slopeNames[point.highCutSlope].getTrailingIntValue());
+        object.setProperty("automated", point.automated);
+        object.setProperty("precision", point.doublePrecision ? "double" : "float");
+        object.setProperty("analyser", point.analyser);
+        object.setProperty("silent", point.silent);
+        object.setProperty("stereoMode", (int) point.stereoMode);
+        object.setProperty("nsPerSample", result.nanosPerSample);
+        object.setProperty("cyclesPerSample", result.cyclesPerSample);
+        object.setProperty("allocationsPerCall", result.allocationsPerCall);
+    }
+
+    juce::String formatRatio(double ratio)      { return "x" + juce::String(ratio, 2); }
+    juce::String formatShare(double share)      { return juce::String(share * 100.0, 2) + "%"; }
+
+    // what runCase() derives from a case's result on top of the common
+    // numbers, e.g. its cost against another case. With a limit it is the
+    // case's budget, and the case is over budget above it
+    struct Budget
+    {
+        juce::Identifier name;
+        std::function<double (const BenchmarkResult&)> value;
+        std::function<juce::String (double)> format;
+        double limit = 0.0;
+    };
+
+    /*
+        A table of cases timed alike, for the engines measured on their own:
+        every case processes numBlocks blocks of samplesPerBlock samples
+        after one that warms up the caches, and refill() restores the input
+        before every block, untimed. Each case gets one row, with its
+        properties, ns/sample, cycles/sample, allocs/call and its budget,
+        and one object in the section's array of the report.
+    */
+    class Section
+    {
+    public:
+        Section(Report& reportToUse, const juce::Identifier& sectionName, const juce::Identifier& firstColumnName,
+                int blocksToRun, double samplesInBlock, std::function<void()> refillFunction)
+            : report(reportToUse), section(sectionName), firstColumn(firstColumnName),
+              numBlocks(blocksToRun), samplesPerBlock(samplesInBlock), refill(std::move(refillFunction))
+        {
+        }
+
+        BenchmarkResult runCase(const juce::var& name, const std::function<void()>& process,
+                                const Budget& budget = {}, const juce::NamedValueSet& properties = {})
+        {
+            if (! headerPrinted)
+            {
+                std::cout << firstColumn.toString().paddedRight(' ', 12);
+
+                for (const auto& property : properties)
+                    std::cout << property.name.toString().paddedRight(' ', 9);
+
+                std::cout << "  ns/sample  cycles/sample  allocs/call"
+                          << budget.name.toString().paddedLeft(' ', 12) << std::endl;
+                headerPrinted = true;
+            }
+
+            Measurement measurement;
+
+            for (int block = 0; block < numBlocks + 1; ++block)
+            {
+                refill();
+
+                // the first block warms up the caches
+                if (block > 0)
+                    measurement.start();
+
+                process();
+
+                if (block > 0)
+                    measurement.stop();
+            }
+
+            auto numSamples = double(numBlocks) * samplesPerBlock;
+
+            BenchmarkResult result;
+            result.nanosPerSample = measurement.getNanoseconds() / numSamples;
+            result.cyclesPerSample = measurement.getCycles() / numSamples;
+            result.allocationsPerCall = double(measurement.allocations) / numBlocks;
+
+            auto& object = report.addCase(section);
+            object.setProperty(firstColumn, name);
+
+            for (const auto& property : properties)
+                object.setProperty(property.name, property.value);
+
+            object.setProperty("nsPerSample", result.nanosPerSample);
+            object.setProperty("cyclesPerSample", result.cyclesPerSample);
+            object.setProperty("allocationsPerCall", result.allocationsPerCall);
+
+            auto what = section.toString() + " " + name.toString();
+            report.checkAllocations(what, result.allocationsPerCall);
+
+            std::cout << name.toString().paddedRight(' ', 12);
+
+            for (const auto& property : properties)
+                std::cout << property.value.toString().paddedRight(' ', 9);
+
+            std::cout << juce::String(result.nanosPerSample, 2).paddedLeft(' ', 11)
+                      << juce::String(result.cyclesPerSample, 2).paddedLeft(' ', 15)
+                      << juce::String(result.allocationsPerCall, 2).paddedLeft(' ', 13);
+
+            if (budget.value != nullptr)
+            {
+                auto value = budget.value(result);
+                object.setProperty(budget.name, value);
+                std::cout << budget.format(value).paddedLeft(' ', 12);
+
+                if (budget.limit > 0.0 && ! report.checkBudget(object, what, value, budget.limit))
+                    std::cout << "  over budget";
+            }
+
+            std::cout << std::endl;
+            return result;
+        }
+
+    private:
+        Report& report;
+        juce::Identifier section, firstColumn;
+        int numBlocks;
+        double samplesPerBlock;
+        std::function<void()> refill;
+        bool headerPrinted = false;
+    };
+
+    bool parseOptions(const juce::StringArray& arguments, Options& options)
+    {
+        for (int i = 0; i < arguments.size(); ++i)
+        {
+            if (arguments[i] == "--json" && i + 1 < arguments.size())
+                options.jsonFile = juce::File::getCurrentWorkingDirectory().getChildFile(arguments[++i]);
+            else if (arguments[i] == "--quick")
+                options.quick = true;
+            else
+                return false;
+        }
+
+        return true;
+    }
+}
+
+//==============================================================================
+int main (int argc, char* argv[])
+{
+    Options options;
+
+    if (! parseOptions(juce::StringArray(argv + 1, argc - 1), options))
+    {
+        std::cout << "usage: simple-eq-benchmarks [--json results.json] [--quick]" << std::endl;
+        return 1;
+    }
+
+    // the apvts needs a message manager to exist
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    // about 0.7 seconds of 48 kHz audio per measurement, a tenth with --quick
+    auto numPasses = options.quick ? 1 : 10;
+
+    SimpleeqAudioProcessor processor;
+    setBaselineParameters(processor);
+
+    Report report(options);
+
+    //==============================================================================
+    // the points to measure, one dimension away from the baseline at a time
+    const std::vector<std::pair<juce::String, juce::AudioChannelSet>> layouts
+    {
+        { "mono",      juce::AudioChannelSet::mono() },
+        { "stereo",    juce::AudioChannelSet::stereo() },
+        { "5.1",       juce::AudioChannelSet::create5point1() },
+        { "7.1.4",     juce::AudioChannelSet::create7point1point4() },
+        { "ambi 3rd",  juce::AudioChannelSet::ambisonic(3) }
+    };
+
+    std::vector<BenchmarkPoint> points;
+
+    auto addPoint = [&points](BenchmarkPoint point)
+    {
+        if (point.layoutName.isEmpty())
+            point.layoutName = "stereo";
+
+        for (const auto& engine : engines)
+        {
+            for (auto automated : { false, true })
+            {
+                for (auto doublePrecision : { false, true })
+                {
+                    point.engine = engine.first;
+                    point.engineName = engine.second;
+                    point.automated = automated;
+                    point.doublePrecision = doublePrecision;
+                    points.push_back(point);
+                }
+            }
+        }
+    };
+
+    for (int blockSize = 1; blockSize <= 4096; blockSize *= 2)
+    {
+        BenchmarkPoint point;
+        point.sweep = "blockSize";
+        point.blockSize = blockSize;
+        addPoint(point);
+    }
+
+    for (auto sampleRate : { 44100.0, 48000.0, 88200.0, 96000.0, 176400.0, 192000.0, 384000.0 })
+    {
+        BenchmarkPoint point;
+        point.sweep = "sampleRate";
+        point.sampleRate = sampleRate;
+        addPoint(point);
+    }
+
+    for (int lowCutSlope = Slope_12; lowCutSlope <= Slope_48; ++lowCutSlope)
+    {
+        for (int highCutSlope = Slope_12; highCutSlope <= Slope_48; ++highCutSlope)
+        {
+            BenchmarkPoint point;
+            point.sweep = "slopes";
+            point.lowCutSlope = (Slope) lowCutSlope;
+            point.highCutSlope = (Slope) highCutSlope;
+            addPoint(point);
+        }
+    }
+
+    for (const auto& layout : layouts)
+    {
+        BenchmarkPoint point;
+        point.sweep = "channels";
+        point.layoutName = layout.first;
+        point.layout = layout.second;
+        addPoint(point);
+    }
+
+    // the baseline with and without the spectrum analyser, to check the
+    // audio thread side of it against its budget
+    for (auto analyser : { false, true })
+    {
+        BenchmarkPoint point;
+        point.sweep = "analyser";
+        point.analyser = analyser;
+        addPoint(point);
+    }
+
+    // the baseline on digital silence, where the processor sleeps once
+    // the filters have rung out
+    {
+        BenchmarkPoint point;
+        point.sweep = "silence";
+        point.silent = true;
+        addPoint(point);
+    }
+
+    // the baseline with a set per side, against linked stereo
+    for (const auto& stereoMode : { std::make_pair(StereoMode::Linked, "stereo"),
+                                    std::make_pair(StereoMode::LeftRight, "L/R"),
+                                    std::make_pair(StereoMode::MidSide, "M/S") })
+    {
+        BenchmarkPoint point;
+        point.sweep = "stereoMode";
+        point.stereoMode = stereoMode.first;
+        point.layoutName = stereoMode.second;
+        addPoint(point);
+    }
+
+    //==============================================================================
+    std::cout << "SimpleEQ processBlock benchmark, " << points.size() << " measurements" << std::endl;
+    std::cout << "(* analyser active)" << std::endl;
+    std::cout << "sweep       engine    bits  rate     block  layout    slopes  params     ns/sample  cycles/sample  allocs/call" << std::endl;
+
+    std::vector<std::pair<BenchmarkPoint, BenchmarkResult>> analyserResults, stereoModeResults;
+    juce::AudioChannelSet currentLayout;
+    juce::AudioBuffer<float> noise;
+
+    for (const auto& point : points)
+    {
+        if (point.layout != currentLayout)
+        {
+            // the main buses carry the layout, the sidechain stays off
+            auto busesLayout = processor.getBusesLayout();
+            busesLayout.inputBuses.set(0, point.layout);
+            busesLayout.outputBuses.set(0, point.layout);
+
+            for (int bus = 1; bus < busesLayout.inputBuses.size(); ++bus)
+                busesLayout.inputBuses.set(bus, juce::AudioChannelSet::disabled());
+
+            if (! processor.setBusesLayout(busesLayout))
+            {
+                std::cout << point.layoutName << " not supported" << std::endl;
+                continue;
+            }
+
+            currentLayout = point.layout;
+            noise = makeNoise(point.layout.size(), 4096);
+        }
+
+        auto result = point.doublePrecision ? measure<double>(processor, point, noise, numPasses)
+                                            : measure<float>(processor, point, noise, numPasses);
+        addProperties(report.addCase("processBlock"), point, result);
+
+        // the allocation test: processBlock must never hit the heap
+        report.checkAllocations("processBlock " + point.sweep + " " + point.engineName
+                                + (point.doublePrecision ? " 64" : " 32") + " bit, " + juce::String(point.blockSize) + " samples, "
+                                + point.layoutName + (point.automated ? ", automated" : ", static"),
+                                result.allocationsPerCall);
+
+        if (point.sweep == "analyser")
+            analyserResults.push_back({ point, result });
+
+        if (point.sweep == "stereoMode")
+            stereoModeResults.push_back({ point, result });
+
+        std::cout << (point.sweep + (point.analyser ? "*" : "")).paddedRight(' ', 12)
+                  << point.engineName.paddedRight(' ', 10)
+                  << juce::String(point.doublePrecision ? "64" : "32").paddedRight(' ', 6)
+                  << juce::String(point.sampleRate / 1000.0, 1).paddedRight(' ', 9)
+                  << juce::String(point.blockSize).paddedRight(' ', 7)
+                  << point.layoutName.paddedRight(' ', 10)
+                  << (slopeNames[point.lowCutSlope] + "/" + slopeNames[point.highCutSlope]).paddedRight(' ', 8)
+                  << juce::String(point.automated ? "automated" : "static").paddedRight(' ', 9)
+                  << juce::String(result.nanosPerSample, 3).paddedLeft(' ', 11)
+                  << juce::String(result.cyclesPerSample, 2).paddedLeft(' ', 15)
+                  << juce::String(result.allocationsPerCall, 3).paddedLeft(' ', 13) << std::endl;
+    }
+
+    processor.releaseResources();
+
+    //==============================================================================
+    // the analyser rows come in pairs that only differ in the analyser
+    std::cout << std::endl << "spectrum analyser overhead, budget "
+              << juce::String(SpectrumAnalyser::maxAudioThreadOverhead * 100.0, 1) << "%" << std::endl;
+    std::cout << "engine    bits  params     overhead" << std::endl;
+
+    for (const auto& withAnalyser : analyserResults)
+    {
+        if (! withAnalyser.first.analyser)
+            continue;
+
+        for (const auto& without : analyserResults)
+        {
+            const auto& a = withAnalyser.first;
+            const auto& b = without.first;
+
+            if (b.analyser || a.engine != b.engine || a.automated != b.automated || a.doublePrecision != b.doublePrecision)
+                continue;
+
+            auto overhead = withAnalyser.second.nanosPerSample / without.second.nanosPerSample - 1.0;
+
+            auto& object = report.addCase("analyserOverhead");
+            object.setProperty("engine", a.engineName);
+            object.setProperty("precision", a.doublePrecision ? "double" : "float");
+            object.setProperty("automated", a.automated);
+            object.setProperty("overhead", overhead);
+            auto withinBudget = report.checkBudget(object, "analyser " + a.engineName + (a.doublePrecision ? " 64" : " 32")
+                                                       + (a.automated ? " automated" : " static"),
+                                                   overhead, SpectrumAnalyser::maxAudioThreadOverhead);
+
+            std::cout << a.engineName.paddedRight(' ', 10)
+                      << juce::String(a.doublePrecision ? "64" : "32").paddedRight(' ', 6)
+                      << juce::String(a.automated ? "automated" : "static").paddedRight(' ', 9)
+                      << (juce::String(overhead * 100.0, 1) + "%").paddedLeft(' ', 10)
+                      << (withinBudget ? "" : "  over budget") << std::endl;
+        }
+    }
+
+    //==============================================================================
+    // the dual stereo modes against linked stereo on the same engine
+    std::cout << std::endl << "stereo modes, cost against linked stereo, budget x"
+              << juce::String(StereoCascade<float>::maxCostRatio, 1) << std::endl;
+    std::cout << "engine    bits  params     mode  cost" << std::endl;
+
+    for (const auto& dual : stereoModeResults)
+    {
+        if (dual.first.stereoMode == StereoMode::Linked)
+            continue;
+
+        for (const auto& linked : stereoModeResults)
+        {
+            const auto& a = dual.first;
+            const auto& b = linked.first;
+
+            if (b.stereoMode != StereoMode::Linked || a.engine != b.engine || a.automated != b.automated
+                || a.doublePrecision != b.doublePrecision)
+                continue;
+
+            auto cost = dual.second.nanosPerSample / linked.second.nanosPerSample;
+
+            auto& object = report.addCase("stereoModes");
+            object.setProperty("engine", a.engineName);
+            object.setProperty("precision", a.doublePrecision ? "double" : "float");
+            object.setProperty("automated", a.automated);
+            object.setProperty("stereoMode", a.layoutName);
+            object.setProperty("cost", cost);
+            auto withinBudget = report.checkBudget(object, "stereo mode " + a.layoutName + " " + a.engineName
+                                                       + (a.doublePrecision ? " 64" : " 32") + (a.automated ? " automated" : " static"),
+                                                   cost, StereoCascade<float>::maxCostRatio);
+
+            std::cout << a.engineName.paddedRight(' ', 10)
+                      << juce::String(a.doublePrecision ? "64" : "32").paddedRight(' ', 6)
+                      << juce::String(a.automated ? "automated" : "static").paddedRight(' ', 11)
+                      << a.layoutName.paddedRight(' ', 6)
+                      << formatRatio(cost)
+                      << (withinBudget ? "" : "  over budget") << std::endl;
+        }
+    }
+
+    //==============================================================================
+    constexpr double updateSampleRate = 48000.0;
+    auto numIterations = options.quick ? 10000 : 100000;
+
+    std::cout << std::endl << "coefficient updates, " << updateSampleRate << " Hz" << std::endl;
+    std::cout << "update                  ns/call  cycles/call  allocs/call" << std::endl;
+
+    for (const auto& benchmark : makeUpdateBenchmarks(updateSampleRate))
+    {
+        // keeps the optimiser from dropping the work
+        volatile float sink = 0;
+
+        for (int i = 0; i < numIterations / 10; ++i)
+            sink = benchmark.run(i);
+
+        Measurement measurement;
+        measurement.start();
+
+        for (int i = 0; i < numIterations; ++i)
+            sink = benchmark.run(i);
+
+        measurement.stop();
+        juce::ignoreUnused(sink);
+
+        auto nanosPerCall = measurement.getNanoseconds() / numIterations;
+        auto cyclesPerCall = measurement.getCycles() / numIterations;
+        auto allocationsPerCall = double(measurement.allocations) / numIterations;
+
+        auto& object = report.addCase("updates");
+        object.setProperty("name", benchmark.name);
+        object.setProperty("sampleRate", updateSampleRate);
+        object.setProperty("nsPerCall", nanosPerCall);
+        object.setProperty("cyclesPerCall", cyclesPerCall);
+        object.setProperty("allocationsPerCall", allocationsPerCall);
+
+        std::cout << benchmark.name.paddedRight(' ', 20)
+                  << juce::String(nanosPerCall, 1).paddedLeft(' ', 11)
+                  << juce::String(cyclesPerCall, 1).paddedLeft(' ', 13)
+                  << juce::String(allocationsPerCall, 2).paddedLeft(' ', 13) << std::endl;
+    }
+
+    //==============================================================================
+    // mono tracks that all have settings of their own, the way a mixing
+    // engine runs them: one cascade per track against lanes of a register
+    constexpr int numTracks = 64, trackBlockSize = 512;
+    auto numTrackBlocks = numPasses * passLength / trackBlockSize;
+
+    std::cout << std::endl << numTracks << " mono tracks with different settings, "
+              << updateSampleRate << " Hz, " << trackBlockSize << " samples" << std::endl;
+
+    auto trackInput = makeNoise(numTracks, trackBlockSize);
+    juce::AudioBuffer<float> trackBuffer(numTracks, trackBlockSize);
+
+    std::vector<juce::dsp::AudioBlock<float>> trackBlocks;
+
+    for (int track = 0; track < numTracks; ++track)
+        trackBlocks.push_back(juce::dsp::AudioBlock<float>(trackBuffer).getSingleChannelBlock((size_t) track));
+
+    std::vector<SosCascade<float>> perTrack((size_t) numTracks);
+    MultiTrackCascade<float> batched;
+    batched.prepare(updateSampleRate, std::vector<int>((size_t) numTracks, 1), trackBlockSize);
+
+    auto service = CoefficientService::getInstance();
+
+    for (int track = 0; track < numTracks; ++track)
+    {
+        auto set = service->getDesign({ updateSampleRate, makeTrackSettings(track) });
+
+        perTrack[(size_t) track].prepare(1);
+        perTrack[(size_t) track].setCoefficients(*set);
+        batched.setCoefficients(track, *set);
+    }
+
+    Section tracks(report, "multiTrack", "engine", numTrackBlocks, double(trackBlockSize) * numTracks, [&]
+    {
+        for (int track = 0; track < numTracks; ++track)
+            trackBuffer.copyFrom(track, 0, trackInput, track, 0, trackBlockSize);
+    });
+
+    double perTrackNanos = 0.0;
+
+    Budget speedup { "speedup", [&](const BenchmarkResult& result)
+                     {
+                         return (perTrackNanos > 0.0 ? perTrackNanos : result.nanosPerSample) / result.nanosPerSample;
+                     }, formatRatio };
+
+    const juce::NamedValueSet trackProperties { { "tracks", numTracks }, { "lanes", (int) MultiTrackCascade<float>::numLanes } };
+
+    perTrackNanos = tracks.runCase("per track", [&]
+    {
+        for (int track = 0; track < numTracks; ++track)
+            perTrack[(size_t) track].process(trackBuffer.getWritePointer(track), (size_t) trackBlockSize, 0);
+    }, speedup, trackProperties).nanosPerSample;
+
+    tracks.runCase("batched", [&] { batched.process(trackBlocks.data(), numTracks); }, speedup, trackProperties);
+
+    //==============================================================================
+    // the peak band alone, static against dynamic, on a stereo block. The
+    // dynamic band listens once to itself and once to a stereo sidechain
+    constexpr int peakBlockSize = 512;
+    auto numPeakBlocks = numPasses * passLength / peakBlockSize;
+
+    std::cout << std::endl << "peak band, stereo, " << updateSampleRate << " Hz, " << peakBlockSize << " samples" << std::endl;
+
+    DynamicPeakSettings dynamicSettings;
+    dynamicSettings.enabled = true;
+    dynamicSettings.peakFreq = 2000.f;
+    dynamicSettings.peakGainInDecibles = -12.f;
+    dynamicSettings.peakQuality = 2.f;
+
+    ChainSettings staticSettings;
+    staticSettings.peakFreq = dynamicSettings.peakFreq;
+    staticSettings.peakGainInDecibles = dynamicSettings.peakGainInDecibles;
+    staticSettings.peakQuality = dynamicSettings.peakQuality;
+
+    // only the peak section, the cuts are left out
+    auto peakOnly = *service->getDesign({ updateSampleRate, staticSettings });
+    peakOnly.lowCut.active = peakOnly.highCut.active = false;
+
+    SosCascade<float> staticPeak;
+    staticPeak.prepare(2);
+    staticPeak.setCoefficients(peakOnly);
+
+    DynamicPeak<float> selfKeyed, sidechained;
+    selfKeyed.prepare(updateSampleRate, 2, 0);
+    selfKeyed.setSettings(dynamicSettings);
+    sidechained.prepare(updateSampleRate, 2, 2);
+    sidechained.setSettings(dynamicSettings);
+
+    auto peakInput = makeNoise(2, peakBlockSize);
+    auto sidechainInput = makeNoise(2, peakBlockSize);
+    juce::AudioBuffer<float> peakBuffer(2, peakBlockSize);
+    juce::dsp::AudioBlock<float> peakBlock(peakBuffer);
+    juce::dsp::AudioBlock<float> sidechainBlock(sidechainInput);
+
+    Section peaks(report, "dynamicPeak", "peak", numPeakBlocks, double(peakBlockSize) * 2, [&]
+    {
+        peakBuffer.makeCopyOf(peakInput, true);
+    });
+
+    double staticPeakNanos = 0.0;
+
+    Budget peakCost { "cost", [&](const BenchmarkResult& result)
+                      {
+                          return result.nanosPerSample / (staticPeakNanos > 0.0 ? staticPeakNanos : result.nanosPerSample);
+                      }, formatRatio, DynamicPeak<float>::maxCostRatio };
+
+    staticPeakNanos = peaks.runCase("static", [&]
+    {
+        for (int channel = 0; channel < 2; ++channel)
+            staticPeak.process(peakBuffer.getWritePointer(channel), (size_t) peakBlockSize, channel);
+    }, peakCost).nanosPerSample;
+
+    peaks.runCase("dynamic", [&] { selfKeyed.process(peakBlock, nullptr); }, peakCost);
+    peaks.runCase("sidechain", [&] { sidechained.process(peakBlock, &sidechainBlock); }, peakCost);
+
+    //==============================================================================
+    // the filter bank with 0 to 24 of its 24 bands live, the rest bypassed.
+    // The cost per live band should stay flat, i.e. grow linearly in total
+    constexpr int bankBands = 24, bankBlockSize = 512;
+    auto numBankBlocks = numPasses * passLength / bankBlockSize;
+
+    std::cout << std::endl << "filter bank, " << bankBands << " bands, stereo, "
+              << updateSampleRate << " Hz, " << bankBlockSize << " samples" << std::endl;
+
+    auto bankInput = makeNoise(2, bankBlockSize);
+    juce::AudioBuffer<float> bankBuffer(2, bankBlockSize);
+    juce::dsp::AudioBlock<float> bankBlock(bankBuffer);
+
+    Section bankSection(report, "filterBank", "liveBands", numBankBlocks, double(bankBlockSize) * 2, [&]
+    {
+        bankBuffer.makeCopyOf(bankInput, true);
+    });
+
+    double bypassedBankNanos = 0.0;
+
+    for (auto numLiveBands : { 0, 1, 2, 4, 8, 12, 16, 20, 24 })
+    {
+        FilterBank<float> bank;
+        bank.prepare(bankBands, 2);
+
+        // bells spread over the spectrum, with alternating gains
+        for (int band = 0; band < numLiveBands; ++band)
+        {
+            BandSettings settings;
+            settings.bypassed = false;
+            settings.freq = (float) juce::mapToLog10((band + 0.5) / bankBands, 20.0, 20000.0);
+            settings.gainInDecibels = band % 2 == 0 ? 6.f : -6.f;
+
+            bank.setBand(band, CoefficientDesigner::designBand(settings, updateSampleRate));
+        }
+
+        // what each live band adds on top of a fully bypassed bank
+        Budget nanosPerBand { "nsPerBand", [&](const BenchmarkResult& result)
+                              {
+                                  return numLiveBands > 0 ? (result.nanosPerSample - bypassedBankNanos) / numLiveBands : 0.0;
+                              }, [](double nanos) { return juce::String(nanos, 3); } };
+
+        auto result = bankSection.runCase(numLiveBands, [&] { bank.process(bankBlock); }, nanosPerBand, { { "bands", bankBands } });
+
+        if (numLiveBands == 0)
+            bypassedBankNanos = result.nanosPerSample;
+    }
+
+    //==============================================================================
+    // every slope as a low cut on its own through the fused cascade, at
+    // 30 Hz where the poles sit closest to z = 1, at sample rates up to
+    // 384 kHz. The cost per section should stay flat across slopes and
+    // rates, i.e. grow linearly with the order and not with the rate, and
+    // every slope has to stay finite and ring out, in float and double.
+    // The error is the float cascade's against the double one
+    constexpr int cutOrderBlockSize = 512;
+    constexpr float cutOrderFrequency = 30.f;
+    auto numCutOrderBlocks = numPasses * passLength / cutOrderBlockSize;
+
+    std::cout << std::endl << "cut slopes, fused cascade, low cut at " << cutOrderFrequency << " Hz, stereo, "
+              << cutOrderBlockSize << " samples" << std::endl;
+    std::cout << "rate     slope  sections  bits  ns/sample  cycles/sample  allocs/call  ns/section  error dB  stable" << std::endl;
+
+    auto cutOrderInput = makeNoise(2, cutOrderBlockSize);
+
+    for (auto sampleRate : { 48000.0, 96000.0, 192000.0, 384000.0 })
+    {
+        auto table = CutCoefficientTable::getFor(sampleRate);
+
+        for (int slope = 0; slope < numSlopes; ++slope)
+        {
+            auto set = makeCutOrderSet(*table, (Slope) slope, cutOrderFrequency);
+            auto numSections = set.lowCut.getNumSections();
+            auto accuracy = measureCutAccuracy(set, options.quick ? 1 << 16 : 1 << 18);
+
+            for (auto doublePrecision : { false, true })
+            {
+                auto result = doublePrecision ? measureCascade<double>(set, cutOrderInput, numCutOrderBlocks)
+                                              : measureCascade<float>(set, cutOrderInput, numCutOrderBlocks);
+                auto nanosPerSection = result.nanosPerSample / numSections;
+
+                auto& object = report.addCase("cutSlopes");
+                object.setProperty("sampleRate", sampleRate);
+                object.setProperty("slope", slopeNames[slope]);
+                object.setProperty("sections", numSections);
+                object.setProperty("precision", doublePrecision ? "double" : "float");
+                object.setProperty("nsPerSample", result.nanosPerSample);
+                object.setProperty("cyclesPerSample", result.cyclesPerSample);
+                object.setProperty("allocationsPerCall", result.allocationsPerCall);
+                object.setProperty("nsPerSection", nanosPerSection);
+                object.setProperty("errorDecibels", doublePrecision ? 0.0 : accuracy.errorInDecibels);
+                object.setProperty("stable", accuracy.stable);
+
+                auto what = "cut slope " + slopeNames[slope] + " at " + juce::String(sampleRate / 1000.0, 1)
+                            + " kHz" + (doublePrecision ? " 64" : " 32") + " bit";
+                report.checkAllocations(what, result.allocationsPerCall);
+
+                if (! accuracy.stable)
+                    report.fail(what + " is not stable");
+
+                std::cout << juce::String(sampleRate / 1000.0, 1).paddedRight(' ', 9)
+                          << slopeNames[slope].paddedRight(' ', 7)
+                          << juce::String(numSections).paddedRight(' ', 10)
+                          << juce::String(doublePrecision ? "64" : "32").paddedRight(' ', 4)
+                          << juce::String(result.nanosPerSample, 2).paddedLeft(' ', 11)
+                          << juce::String(result.cyclesPerSample, 2).paddedLeft(' ', 15)
+                          << juce::String(result.allocationsPerCall, 2).paddedLeft(' ', 13)
+                          << juce::String(nanosPerSection, 3).paddedLeft(' ', 12)
+                          << (doublePrecision ? juce::String("-") : juce::String(accuracy.errorInDecibels, 1)).paddedLeft(' ', 10)
+                          << juce::String(accuracy.stable ? "yes" : "NO").paddedLeft(' ', 8) << std::endl;
+            }
+        }
+    }
+
+    //==============================================================================
+    // the linear phase engine at several kernel lengths, as the share of
+    // one core a stereo instance at 48 kHz takes
+    constexpr int linearBlockSize = 512;
+    constexpr double linearSampleRate = 48000.0;
+    auto numLinearBlocks = numPasses * passLength / linearBlockSize;
+
+    std::cout << std::endl << "linear phase, stereo, " << linearSampleRate << " Hz, "
+              << linearBlockSize << " samples" << std::endl;
+
+    // the baseline setting, every band does something
+    ChainSettings linearSettings;
+    linearSettings.lowCutFreq = 80.f;
+    linearSettings.highCutFreq = 12000.f;
+    linearSettings.peakFreq = 1000.f;
+    linearSettings.peakGainInDecibles = 6.f;
+    linearSettings.lowCutSlope = linearSettings.highCutSlope = Slope_48;
+
+    auto linearSet = *service->getDesign({ linearSampleRate, linearSettings });
+    auto linearInput = makeNoise(2, linearBlockSize);
+    juce::AudioBuffer<float> linearBuffer(2, linearBlockSize);
+    juce::dsp::AudioBlock<float> linearBlock(linearBuffer);
+
+    Section linearSection(report, "linearPhase", "taps", numLinearBlocks, double(linearBlockSize) * 2, [&]
+    {
+        linearBuffer.makeCopyOf(linearInput, true);
+    });
+
+    // two channels of linearSampleRate samples in every second
+    auto coreShare = [&](const BenchmarkResult& result) { return result.nanosPerSample * 1.0e-9 * 2.0 * linearSampleRate; };
+
+    for (auto numTaps : { 1024, 4096, 16384, 32768 })
+    {
+        LinearPhaseEngine linearPhase;
+        linearPhase.setKernelLength(numTaps);
+        linearPhase.prepare(linearSampleRate, 2, linearSet);
+
+        linearSection.runCase(numTaps, [&] { linearPhase.process(linearBlock); },
+                              { "coreShare", coreShare, formatShare, LinearPhaseEngine::getCpuBudget(numTaps) },
+                              { { "latency", linearPhase.getLatencyInSamples() } });
+
+        linearPhase.release();
+    }
+
+    //==============================================================================
+    // restoring a session, in the formats of earlier releases and in the
+    // compact one, against recalling the same settings from the preset
+    // bank. The two settings alternate so every restore moves parameters,
+    // and the bank holds their sets so none of them is designed twice
+    processor.setEngine(Engine::SimdCascade);
+    processor.prepareToPlay(48000.0, 512);
+
+    struct StateFormat
+    {
+        juce::String name;
+        std::array<juce::MemoryBlock, 2> states;
+    };
+
+    std::vector<StateFormat> stateFormats { { "valuetree", {} }, { "xml", {} }, { "compact", {} } };
+
+    for (size_t setting = 0; setting < 2; ++setting)
+    {
+        setBaselineParameters(processor);
+
+        if (setting == 1)
+        {
+            setParameter(processor, "Peak Freq", 3000.f);
+            setParameter(processor, "Peak Gain", -6.f);
+            setParameter(processor, "LowCut Slope", (float) Slope_24);
+        }
+
+        juce::MemoryOutputStream treeStream(stateFormats[0].states[setting], false);
+        processor.apvts.copyState().writeToStream(treeStream);
+
+        if (auto xml = processor.apvts.copyState().createXml())
+            juce::AudioProcessor::copyXmlToBinary(*xml, stateFormats[1].states[setting]);
+
+        processor.getStateInformation(stateFormats[2].states[setting]);
+        processor.storePreset("setting " + juce::String(setting));
+    }
+
+    auto numRestores = options.quick ? 100 : 1000;
+
+    std::cout << std::endl << "state restore, " << numRestores << " restores alternating two settings" << std::endl;
+    std::cout << "format           bytes  us/restore  allocs/restore" << std::endl;
+
+    auto reportRestore = [&](const juce::String& name, size_t numBytes, const Measurement& measurement)
+    {
+        auto microsPerRestore = measurement.getNanoseconds() * 1.0e-3 / numRestores;
+        auto allocationsPerRestore = double(measurement.allocations) / numRestores;
+
+        auto& object = report.addCase("stateRestore");
+        object.setProperty("format", name);
+        object.setProperty("bytes", (int) numBytes);
+        object.setProperty("usPerRestore", microsPerRestore);
+        object.setProperty("allocationsPerRestore", allocationsPerRestore);
+
+        std::cout << name.paddedRight(' ', 12)
+                  << juce::String((int) numBytes).paddedLeft(' ', 10)
+                  << juce::String(microsPerRestore, 2).paddedLeft(' ', 12)
+                  << juce::String(allocationsPerRestore, 1).paddedLeft(' ', 16) << std::endl;
+    };
+
+    for (const auto& format : stateFormats)
+    {
+        Measurement measurement;
+
+        for (int i = 0; i < numRestores; ++i)
+        {
+            const auto& state = format.states[(size_t) i % 2];
+
+            measurement.start();
+            processor.setStateInformation(state.getData(), (int) state.getSize());
+            measurement.stop();
+        }
+
+        reportRestore(format.name, format.states[0].getSize(), measurement);
+    }
+
+    // the bank keeps the settings as values, there is nothing to parse
+    {
+        Measurement measurement;
+
+        for (int i = 0; i < numRestores; ++i)
+        {
+            measurement.start();
+            processor.recallPreset(i % 2);
+            measurement.stop();
+        }
+
+        reportRestore("preset", 0, measurement);
+    }
+
+    processor.getPresetBank().clear();
+    processor.releaseResources();
+
+    //==============================================================================
+    if (! report.write(options.jsonFile))
+    {
+        std::cout << "could not write " << options.jsonFile.getFullPathName() << std::endl;
+        return 1;
+    }
+
+    std::cout << std::endl << "results written to " << options.jsonFile.getFullPathName() << std::endl;
+
+    if (report.getFailures().isEmpty())
+        return 0;
+
+    std::cout << std::endl << report.getFailures().size() << " failed:" << std::endl;
+
+    for (const auto& failure : report.getFailures())
+        std::cout << "  " << failure << std::endl;
+
+    return 1;
+}
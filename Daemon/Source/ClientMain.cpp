@@ -0,0 +1,265 @@
+/*
+  ==============================================================================
+
+    This file contains the basic startup code for the SimpleEQ daemon's
+    test client.
+
+    Opens a stream on a running simple-eq-daemon, pushes a test signal
+    through it and reports what came back:
+
+      simple-eq-client [--socket <path>] [--stream <name>] [--channels 2]
+                       [--block-size 256] [--sample-rate 48000] [--slots 8]
+                       [--seconds 10] [--flood] [--state <preset file>]
+                       [--engine <name>] [--set "<parameter id>=<value>"]...
+
+    Blocks are handed over at the pace of real time, or as fast as the
+    daemon takes them with --flood. It prints the round trip latency of
+    the blocks (from handing one over to getting it back), the daemon's
+    own statistics and how far the output is from the input, which is
+    0 (-inf dB) with the default parameters, where every band is off.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "ControlChannel.h"
+#include "SharedStream.h"
+
+namespace
+{
+    void printUsage()
+    {
+        std::cout << "usage: simple-eq-client [--socket <path>] [--stream <name>] [--channels <n>]" << std::endl
+                  << "                        [--block-size <n>] [--sample-rate <hz>] [--slots <n>] [--seconds <s>]" << std::endl
+                  << "                        [--flood] [--state <preset file>] [--engine <name>]" << std::endl
+                  << "                        [--set \"<parameter id>=<value>\"]..." << std::endl
+                  << std::endl
+                  << "  --flood   hand blocks over as fast as the daemon takes them instead of in real time" << std::endl
+                  << "  --set     e.g. --set \"Peak Gain=6\", may be given more than once" << std::endl;
+    }
+
+    // a command that has to succeed, false after printing the daemon's complaint
+    bool sendCommand(ControlConnection& connection, const juce::String& command, juce::String& reply)
+    {
+        reply = connection.send(command);
+
+        if (reply.startsWith("ok"))
+            return true;
+
+        std::cerr << command << ": " << (reply.isEmpty() ? juce::String("no reply from the daemon") : reply) << std::endl;
+        return false;
+    }
+
+    // a 1 kHz sine at -6 dBFS on top of -40 dB noise, different on every channel
+    struct TestSignal
+    {
+        void fill(float* samples, int numSamples, int channel, double sampleRate, juce::uint64 startSample)
+        {
+            auto increment = juce::MathConstants<double>::twoPi * 1000.0 / sampleRate;
+
+            for (int i = 0; i < numSamples; ++i)
+            {
+                auto phase = increment * (double) (startSample + (juce::uint64) i) + channel;
+                samples[i] = (float) (0.5 * std::sin(phase)) + 0.01f * (random.nextFloat() * 2.f - 1.f);
+            }
+        }
+
+        juce::Random random { 42 };
+    };
+
+    double getPercentile(std::vector<double> values, double percentile)
+    {
+        if (values.empty())
+            return 0.0;
+
+        auto index = (size_t) juce::jlimit(0.0, (double) values.size() - 1.0, percentile / 100.0 * (double) values.size());
+        std::nth_element(values.begin(), values.begin() + (std::ptrdiff_t) index, values.end());
+        return values[index];
+    }
+}
+
+//==============================================================================
+int main (int argc, char* argv[])
+{
+    juce::String socketPath(ControlServer::defaultSocketPath), streamName("client");
+    juce::String stateFile, engineName;
+    juce::StringArray parameterChanges;
+    SharedStream::Format format;
+    double seconds = 10.0;
+    bool flood = false;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        juce::String argument(argv[i]);
+        auto hasValue = i + 1 < argc;
+
+        if (argument == "--socket" && hasValue)
+            socketPath = argv[++i];
+        else if (argument == "--stream" && hasValue)
+            streamName = argv[++i];
+        else if (argument == "--channels" && hasValue)
+            format.numChannels = juce::String(argv[++i]).getIntValue();
+        else if (argument == "--block-size" && hasValue)
+            format.blockSize = juce::String(argv[++i]).getIntValue();
+        else if (argument == "--sample-rate" && hasValue)
+            format.sampleRate = juce::String(argv[++i]).getDoubleValue();
+        else if (argument == "--slots" && hasValue)
+            format.numSlots = juce::String(argv[++i]).getIntValue();
+        else if (argument == "--seconds" && hasValue)
+            seconds = juce::String(argv[++i]).getDoubleValue();
+        else if (argument == "--flood")
+            flood = true;
+        else if (argument == "--state" && hasValue)
+            stateFile = juce::File::getCurrentWorkingDirectory().getChildFile(argv[++i]).getFullPathName();
+        else if (argument == "--engine" && hasValue)
+            engineName = argv[++i];
+        else if (argument == "--set" && hasValue && juce::String(argv[i + 1]).contains("="))
+            parameterChanges.add(argv[++i]);
+        else
+        {
+            printUsage();
+            return 1;
+        }
+    }
+
+    //==============================================================================
+    ControlConnection connection;
+    juce::String error, reply;
+
+    if (! connection.connect(socketPath, error))
+    {
+        std::cerr << error << std::endl;
+        return 1;
+    }
+
+    if (! sendCommand(connection, "open " + streamName + " " + juce::String(format.numChannels) + " "
+                                      + juce::String(format.blockSize) + " " + juce::String(format.sampleRate) + " "
+                                      + juce::String(format.numSlots), reply))
+        return 1;
+
+    // "ok <shm object> latency <samples>"
+    auto stream = SharedStream::open(reply.fromFirstOccurrenceOf("ok ", false, false).upToFirstOccurrenceOf(" ", false, false), error);
+
+    if (stream == nullptr)
+    {
+        std::cerr << error << std::endl;
+        return 1;
+    }
+
+    auto succeeded = (stateFile.isEmpty() || sendCommand(connection, "state " + streamName + " " + stateFile, reply))
+                  && (engineName.isEmpty() || sendCommand(connection, "engine " + streamName + " " + engineName, reply));
+
+    for (const auto& change : parameterChanges)
+        succeeded = succeeded && sendCommand(connection, "set " + streamName + " " + change.fromLastOccurrenceOf("=", false, false).trim()
+                                                         + " " + change.upToLastOccurrenceOf("=", false, false).trim(), reply);
+
+    if (! succeeded)
+    {
+        connection.send("close " + streamName);
+        return 1;
+    }
+
+    //==============================================================================
+    auto& header = stream->getHeader();
+    auto numChannels = stream->getNumChannels();
+    auto blockSize = stream->getBlockSize();
+    auto numSlots = stream->getNumSlots();
+    auto totalBlocks = (juce::uint64) juce::jmax(1.0, seconds * format.sampleRate / blockSize);
+    auto blockNs = 1.0e9 * blockSize / format.sampleRate;
+
+    // what went into every slot, to compare with what comes back
+    juce::AudioBuffer<float> inputs(numChannels * numSlots, blockSize);
+    TestSignal signal;
+
+    std::vector<double> roundTripMicros;
+    roundTripMicros.reserve((size_t) totalBlocks);
+
+    double maxDeviation = 0.0;
+    bool allFinite = true;
+
+    juce::uint64 written = 0, consumed = 0;
+    auto startNs = SharedStream::now();
+    auto lastProgressNs = startNs;
+
+    while (consumed < totalBlocks)
+    {
+        auto now = SharedStream::now();
+        auto didWork = false;
+
+        // hand over blocks while there are free slots and they are due
+        while (written < totalBlocks && written - consumed < (juce::uint64) numSlots
+               && (flood || (double) (now - startNs) >= (double) written * blockNs))
+        {
+            for (int channel = 0; channel < numChannels; ++channel)
+            {
+                auto* samples = stream->getChannel(written, channel);
+                signal.fill(samples, blockSize, channel, format.sampleRate, written * (juce::uint64) blockSize);
+                inputs.copyFrom((int) (written % (juce::uint64) numSlots) * numChannels + channel, 0, samples, blockSize);
+            }
+
+            stream->getSlot(written).submittedNs = SharedStream::now();
+            header.written.store(++written, std::memory_order_release);
+            didWork = true;
+        }
+
+        // take back whatever the daemon has filtered
+        auto processed = header.processed.load(std::memory_order_acquire);
+
+        for (; consumed < processed; ++consumed)
+        {
+            auto& slot = stream->getSlot(consumed);
+            roundTripMicros.push_back((double) (SharedStream::now() - slot.submittedNs) * 1.0e-3);
+
+            for (int channel = 0; channel < numChannels; ++channel)
+            {
+                const auto* output = stream->getChannel(consumed, channel);
+                const auto* input = inputs.getReadPointer((int) (consumed % (juce::uint64) numSlots) * numChannels + channel);
+
+                for (int i = 0; i < blockSize; ++i)
+                {
+                    allFinite = allFinite && std::isfinite(output[i]);
+                    maxDeviation = juce::jmax(maxDeviation, (double) std::abs(output[i] - input[i]));
+                }
+            }
+
+            header.consumed.store(consumed + 1, std::memory_order_release);
+            didWork = true;
+        }
+
+        if (didWork)
+        {
+            lastProgressNs = now;
+        }
+        else
+        {
+            if (header.open.load() == 0 || now - lastProgressNs > 2000000000ull)
+            {
+                std::cerr << "the daemon stopped serving the stream after " << (juce::int64) consumed << " blocks" << std::endl;
+                return 1;
+            }
+
+            std::this_thread::sleep_for(std::chrono::microseconds(20));
+        }
+    }
+
+    auto wallSeconds = (double) (SharedStream::now() - startNs) * 1.0e-9;
+    auto audioSeconds = (double) totalBlocks * blockSize / format.sampleRate;
+
+    //==============================================================================
+    std::cout << (juce::int64) totalBlocks << " blocks of " << blockSize << " samples, " << numChannels << " channels, "
+              << juce::String(audioSeconds, 1) << " s audio in " << juce::String(wallSeconds, 2) << " s ("
+              << juce::String(wallSeconds > 0.0 ? audioSeconds / wallSeconds : 0.0, 1) << "x realtime)" << std::endl
+              << "round trip us: p50 " << juce::String(getPercentile(roundTripMicros, 50.0), 1)
+              << "  p99 " << juce::String(getPercentile(roundTripMicros, 99.0), 1)
+              << "  max " << juce::String(getPercentile(roundTripMicros, 100.0), 1)
+              << "  (one block is " << juce::String(blockNs * 1.0e-3, 1) << " us)" << std::endl
+              << "processor latency: " << header.latencySamples.load() << " samples" << std::endl
+              << "max difference to the input: " << juce::String(juce::Decibels::gainToDecibels(maxDeviation, -300.0), 1) << " dB"
+              << (allFinite ? "" : ", NOT FINITE") << std::endl;
+
+    if (sendCommand(connection, "stats " + streamName, reply))
+        std::cout << "daemon: " << reply.fromFirstOccurrenceOf("ok ", false, false) << std::endl;
+
+    sendCommand(connection, "close " + streamName, reply);
+    return allFinite ? 0 : 1;
+}
@@ -0,0 +1,245 @@
+/*
+  ==============================================================================
+
+    ControlChannel.cpp
+
+  ==============================================================================
+*/
+
+#include "ControlChannel.h"
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace
+{
+    // the longest command we accept, anything longer drops the connection
+    constexpr size_t maxLineLength = 4096;
+
+    // how often the control thread checks whether it should stop
+    constexpr int pollTimeoutMs = 100;
+
+    bool makeAddress(const juce::String& socketPath, sockaddr_un& address, juce::String& error)
+    {
+        address = {};
+        address.sun_family = AF_UNIX;
+
+        auto length = socketPath.getNumBytesAsUTF8();
+
+        if (length == 0 || length >= sizeof(address.sun_path))
+        {
+            error = "invalid socket path: " + socketPath;
+            return false;
+        }
+
+        std::memcpy(address.sun_path, socketPath.toRawUTF8(), length);
+        return true;
+    }
+
+    bool writeAll(int fd, const juce::String& text)
+    {
+        auto* data = text.toRawUTF8();
+        auto remaining = text.getNumBytesAsUTF8();
+
+        while (remaining > 0)
+        {
+            auto numWritten = ::send(fd, data, remaining, MSG_NOSIGNAL);
+
+            if (numWritten < 0 && errno == EINTR)
+                continue;
+
+            if (numWritten <= 0)
+                return false;
+
+            data += numWritten;
+            remaining -= (size_t) numWritten;
+        }
+
+        return true;
+    }
+
+    // takes the first line out of the buffer, false if there is none yet
+    bool takeLine(juce::MemoryBlock& pending, juce::String& line)
+    {
+        auto* data = static_cast<const char*>(pending.getData());
+        auto* end = data + pending.getSize();
+        auto* newline = std::find(data, end, '\n');
+
+        if (newline == end)
+            return false;
+
+        line = juce::String::fromUTF8(data, (int) (newline - data)).trimEnd();
+        pending.removeSection(0, (size_t) (newline - data) + 1);
+        return true;
+    }
+}
+
+//==============================================================================
+ControlServer::ControlServer(Handler handlerToUse)
+    : juce::Thread("SimpleEQ daemon control"),
+      handler(std::move(handlerToUse))
+{
+}
+
+ControlServer::~ControlServer()
+{
+    stop();
+}
+
+bool ControlServer::start(const juce::String& socketPath, juce::String& error)
+{
+    sockaddr_un address;
+
+    if (! makeAddress(socketPath, address, error))
+        return false;
+
+    listener = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+    if (listener < 0)
+    {
+        error = "could not create socket: " + juce::String(std::strerror(errno));
+        return false;
+    }
+
+    // a daemon that was killed leaves its socket file behind
+    unlink(socketPath.toRawUTF8());
+
+    if (bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(listener, 16) != 0)
+    {
+        error = "could not listen on " + socketPath + ": " + juce::String(std::strerror(errno));
+        close(listener);
+        listener = -1;
+        return false;
+    }
+
+    path = socketPath;
+    startThread();
+    return true;
+}
+
+void ControlServer::stop()
+{
+    stopThread(2000);
+
+    for (auto& connection : connections)
+        close(connection.fd);
+
+    connections.clear();
+
+    if (listener >= 0)
+    {
+        close(listener);
+        unlink(path.toRawUTF8());
+        listener = -1;
+    }
+}
+
+void ControlServer::run()
+{
+    std::vector<pollfd> fds;
+
+    while (! threadShouldExit())
+    {
+        fds.clear();
+        fds.push_back({ listener, POLLIN, 0 });
+
+        for (const auto& connection : connections)
+            fds.push_back({ connection.fd, POLLIN, 0 });
+
+        if (poll(fds.data(), (nfds_t) fds.size(), pollTimeoutMs) <= 0)
+            continue;
+
+        // the connections first, accepting may add to them
+        for (size_t i = fds.size() - 1; i > 0; --i)
+        {
+            if (fds[i].revents == 0)
+                continue;
+
+            auto& connection = connections[i - 1];
+
+            if (! serve(connection))
+            {
+                close(connection.fd);
+                connections.erase(connections.begin() + (std::ptrdiff_t) (i - 1));
+            }
+        }
+
+        if ((fds[0].revents & POLLIN) != 0)
+        {
+            auto fd = accept4(listener, nullptr, nullptr, SOCK_CLOEXEC);
+
+            if (fd >= 0)
+                connections.push_back({ fd, {} });
+        }
+    }
+}
+
+bool ControlServer::serve(Connection& connection)
+{
+    char buffer[1024];
+    auto numRead = recv(connection.fd, buffer, sizeof(buffer), 0);
+
+    if (numRead <= 0)
+        return numRead < 0 && errno == EINTR;
+
+    connection.pending.append(buffer, (size_t) numRead);
+
+    juce::String command;
+
+    while (takeLine(connection.pending, command))
+        if (command.isNotEmpty() && ! writeAll(connection.fd, handler(command) + "\n"))
+            return false;
+
+    return connection.pending.getSize() <= maxLineLength;
+}
+
+//==============================================================================
+ControlConnection::~ControlConnection()
+{
+    if (fd >= 0)
+        close(fd);
+}
+
+bool ControlConnection::connect(const juce::String& socketPath, juce::String& error)
+{
+    sockaddr_un address;
+
+    if (! makeAddress(socketPath, address, error))
+        return false;
+
+    fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+    if (fd < 0 || ::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0)
+    {
+        error = "could not connect to " + socketPath + ": " + juce::String(std::strerror(errno));
+        return false;
+    }
+
+    return true;
+}
+
+juce::String ControlConnection::send(const juce::String& command)
+{
+    if (fd < 0 || ! writeAll(fd, command + "\n"))
+        return {};
+
+    juce::String reply;
+
+    while (! takeLine(pending, reply))
+    {
+        char buffer[1024];
+        auto numRead = recv(fd, buffer, sizeof(buffer), 0);
+
+        if (numRead < 0 && errno == EINTR)
+            continue;
+
+        if (numRead <= 0)
+            return {};
+
+        pending.append(buffer, (size_t) numRead);
+    }
+
+    return reply;
+}
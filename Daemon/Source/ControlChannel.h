@@ -0,0 +1,73 @@
+/*
+  ==============================================================================
+
+    ControlChannel.h
+
+    The daemon's control channel: a Unix domain socket with one command
+    per line and one reply line per command, "ok ..." or "error ...". It
+    only carries commands and statistics, the audio goes through the
+    SharedStreams. See EqDaemon.h for the commands.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+// daemon side: accepts any number of local connections and answers their
+// commands one at a time on its own thread
+class ControlServer : private juce::Thread
+{
+public:
+    // runs on the control thread, returns the reply without the newline
+    using Handler = std::function<juce::String(const juce::String& command)>;
+
+    explicit ControlServer(Handler handler);
+    ~ControlServer() override;
+
+    // binds the socket (replacing a stale one) and starts serving
+    bool start(const juce::String& socketPath, juce::String& error);
+    void stop();
+
+    static constexpr const char* defaultSocketPath = "/tmp/simple-eq-daemon.sock";
+
+private:
+    struct Connection
+    {
+        int fd { -1 };
+        juce::MemoryBlock pending;
+    };
+
+    void run() override;
+
+    // reads what arrived and answers every complete line, false once the
+    // peer is gone
+    bool serve(Connection& connection);
+
+    Handler handler;
+    juce::String path;
+    int listener { -1 };
+    std::vector<Connection> connections;
+
+    JUCE_DECLARE_NON_COPYABLE (ControlServer)
+};
+
+// client side: one blocking connection
+class ControlConnection
+{
+public:
+    ControlConnection() = default;
+    ~ControlConnection();
+
+    bool connect(const juce::String& socketPath, juce::String& error);
+
+    // sends a command and waits for its reply, empty if the daemon is gone
+    juce::String send(const juce::String& command);
+
+private:
+    int fd { -1 };
+    juce::MemoryBlock pending;
+
+    JUCE_DECLARE_NON_COPYABLE (ControlConnection)
+};
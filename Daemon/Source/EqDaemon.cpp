@@ -0,0 +1,438 @@
+/*
+  ==============================================================================
+
+    EqDaemon.cpp
+
+  ==============================================================================
+*/
+
+#include "EqDaemon.h"
+
+#include <pthread.h>
+#include <sched.h>
+
+namespace
+{
+    using Engine = SimpleeqAudioProcessor::Engine;
+
+    const std::vector<std::pair<Engine, juce::String>> engines
+    {
+        { Engine::ProcessorChain, "chain" },
+        { Engine::FusedCascade,   "fused" },
+        { Engine::SimdCascade,    "simd" },
+        { Engine::SmoothedSvf,    "smoothed" },
+        { Engine::LinearPhase,    "linear" }
+    };
+
+    // below the kernel's own threads (which run at 50 by default) it
+    // would be interrupted by interrupt handling, at 99 it would starve it
+    constexpr int realtimePriority = 70;
+
+    bool isValidStreamName(const juce::String& name)
+    {
+        return name.isNotEmpty() && name.length() <= 64
+            && name.containsOnly("abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789-_");
+    }
+
+    juce::String fail(const juce::String& message)
+    {
+        return "error " + message;
+    }
+
+    // the command without its first words, for arguments that may
+    // contain spaces ("Peak Gain", a path)
+    juce::String skipWords(juce::String command, int numWords)
+    {
+        for (int i = 0; i < numWords; ++i)
+            command = command.trim().fromFirstOccurrenceOf(" ", false, false);
+
+        return command.trim();
+    }
+}
+
+//==============================================================================
+class EqDaemon::Worker : public juce::Thread
+{
+public:
+    Worker(int coreToUse, bool shouldBeRealtime)
+        : juce::Thread("SimpleEQ daemon worker " + juce::String(coreToUse)),
+          core(coreToUse),
+          realtime(shouldBeRealtime)
+    {
+    }
+
+    ~Worker() override
+    {
+        stopThread(2000);
+    }
+
+    // control thread: the streams this worker serves from now on. Returns
+    // once the worker no longer touches any stream left out of the list
+    void setStreams(std::vector<Stream*> newStreams)
+    {
+        auto& list = lists.getWriteBuffer();
+        list.streams = std::move(newStreams);
+        list.version = ++publishedVersion;
+        lists.publish();
+
+        while (isThreadRunning() && acknowledgedVersion.load() < publishedVersion)
+            juce::Thread::sleep(1);
+    }
+
+    int getNumStreams() const noexcept { return numStreams; }
+    void setNumStreams(int newNumStreams) noexcept { numStreams = newNumStreams; }
+
+    // false until the thread is running, and then only if it got SCHED_FIFO
+    bool isRealtime() const noexcept { return gotRealtime.load(); }
+    void waitUntilStarted() { started.wait(1000); }
+
+private:
+    struct StreamList
+    {
+        std::vector<Stream*> streams;
+        juce::uint64 version { 0 };
+    };
+
+    void run() override
+    {
+        // one worker per core, it stays there so its streams' processors
+        // stay in that core's caches
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(core, &cpus);
+        pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+
+        if (realtime)
+        {
+            sched_param parameters {};
+            parameters.sched_priority = realtimePriority;
+            gotRealtime.store(pthread_setschedparam(pthread_self(), SCHED_FIFO, &parameters) == 0);
+        }
+
+        started.signal();
+
+        const StreamList* active = nullptr;
+
+        while (! threadShouldExit())
+        {
+            // a new list means the previous one, and every stream that
+            // was only on it, is no longer used
+            if (auto* list = lists.acquire())
+            {
+                active = list;
+                acknowledgedVersion.store(list->version);
+            }
+
+            auto didWork = false;
+
+            if (active != nullptr)
+                for (auto* stream : active->streams)
+                    didWork = stream->processPending() || didWork;
+
+            if (! didWork)
+                std::this_thread::sleep_for(std::chrono::microseconds(idleSleepMicroseconds));
+        }
+    }
+
+    const int core;
+    const bool realtime;
+    std::atomic<bool> gotRealtime { false };
+    juce::WaitableEvent started;
+
+    TripleBuffer<StreamList> lists;
+    juce::uint64 publishedVersion { 0 };
+    std::atomic<juce::uint64> acknowledgedVersion { 0 };
+
+    // control thread only
+    int numStreams { 0 };
+};
+
+//==============================================================================
+bool EqDaemon::Stream::processPending() noexcept
+{
+    auto& header = shared->getHeader();
+    auto written = header.written.load(std::memory_order_acquire);
+    auto processed = header.processed.load(std::memory_order_relaxed);
+
+    // the client owns written, a value behind ours is garbage, not work
+    if (written <= processed)
+        return false;
+
+    // our own copy of the format, not the one in the header the client can write to
+    auto numChannels = shared->getNumChannels();
+    auto blockSize = shared->getBlockSize();
+
+    // at most one ring per pass, so one busy stream cannot hold up the
+    // other streams of the worker
+    auto end = juce::jmin(written, processed + (juce::uint64) shared->getNumSlots());
+
+    for (; processed < end; ++processed)
+    {
+        for (int channel = 0; channel < numChannels; ++channel)
+            channels[(size_t) channel] = shared->getChannel(processed, channel);
+
+        buffer.setDataToReferTo(channels.data(), numChannels, blockSize);
+        processor->processBlock(buffer, midiMessages);
+        midiMessages.clear();
+
+        auto& slot = shared->getSlot(processed);
+        slot.doneNs = SharedStream::now();
+
+        auto latency = slot.doneNs > slot.submittedNs ? slot.doneNs - slot.submittedNs : 0;
+        header.lastLatencyNs.store(latency, std::memory_order_relaxed);
+        header.totalLatencyNs.fetch_add(latency, std::memory_order_relaxed);
+
+        if (latency > header.maxLatencyNs.load(std::memory_order_relaxed))
+            header.maxLatencyNs.store(latency, std::memory_order_relaxed);
+
+        header.processed.store(processed + 1, std::memory_order_release);
+    }
+
+    // the engine, and with it the processor's latency, can change at any block
+    header.latencySamples.store(processor->getLatencySamples(), std::memory_order_relaxed);
+    return true;
+}
+
+//==============================================================================
+EqDaemon::EqDaemon(int numWorkers, bool realtime)
+{
+    for (int i = 0; i < juce::jmax(1, numWorkers); ++i)
+        workers.add(new Worker(i % juce::SystemStats::getNumCpus(), realtime))->startThread();
+
+    for (auto* worker : workers)
+        worker->waitUntilStarted();
+}
+
+EqDaemon::~EqDaemon()
+{
+    // the workers go first, then nothing touches the streams any more
+    workers.clear();
+
+    const juce::ScopedLock sl(streamsLock);
+    streams.clear();
+}
+
+bool EqDaemon::isRealtime() const
+{
+    for (auto* worker : workers)
+        if (! worker->isRealtime())
+            return false;
+
+    return true;
+}
+
+void EqDaemon::publishStreams(int worker)
+{
+    std::vector<Stream*> list;
+
+    for (auto& entry : streams)
+        if (entry.second->worker == worker)
+            list.push_back(entry.second.get());
+
+    workers[worker]->setNumStreams((int) list.size());
+    workers[worker]->setStreams(std::move(list));
+}
+
+//==============================================================================
+juce::String EqDaemon::handleCommand(const juce::String& command)
+{
+    auto arguments = juce::StringArray::fromTokens(command, " ", "");
+    arguments.removeEmptyStrings();
+
+    if (arguments.isEmpty())
+        return fail("empty command");
+
+    const juce::ScopedLock sl(streamsLock);
+
+    const auto& verb = arguments[0];
+
+    if (verb == "list")
+    {
+        juce::String reply("ok");
+
+        for (auto& entry : streams)
+            reply << " " << entry.first;
+
+        return reply;
+    }
+
+    if (verb == "shutdown")
+    {
+        exitRequested.store(true);
+        return "ok";
+    }
+
+    if (verb == "open")
+        return open(arguments);
+
+    if (arguments.size() < 2)
+        return fail("missing stream name");
+
+    if (verb == "close")
+        return close(arguments[1]);
+
+    auto found = streams.find(arguments[1]);
+
+    if (found == streams.end())
+        return fail("no stream " + arguments[1]);
+
+    auto& stream = *found->second;
+
+    if (verb == "set" && arguments.size() >= 4)
+        return setParameter(stream, arguments[2], skipWords(command, 3));
+
+    if (verb == "state" && arguments.size() >= 3)
+        return loadState(stream, skipWords(command, 2));
+
+    if (verb == "engine" && arguments.size() == 3)
+        return setEngine(stream, arguments[2]);
+
+    if (verb == "stats")
+        return getStats(stream);
+
+    return fail("unknown command: " + command);
+}
+
+juce::String EqDaemon::open(const juce::StringArray& arguments)
+{
+    if (arguments.size() < 5)
+        return fail("usage: open <stream> <channels> <block size> <sample rate> [<slots>]");
+
+    auto name = arguments[1];
+
+    if (! isValidStreamName(name))
+        return fail("stream names are letters, digits, - and _");
+
+    if (streams.find(name) != streams.end())
+        return fail("stream " + name + " is already open");
+
+    SharedStream::Format format;
+    format.numChannels = arguments[2].getIntValue();
+    format.blockSize = arguments[3].getIntValue();
+    format.sampleRate = arguments[4].getDoubleValue();
+
+    if (arguments.size() > 5)
+        format.numSlots = arguments[5].getIntValue();
+
+    auto stream = std::make_unique<Stream>();
+    stream->name = name;
+    stream->processor = std::make_unique<SimpleeqAudioProcessor>();
+
+    // as many channels as the client sends, on the main buses, the sidechain stays off
+    auto channelSet = juce::AudioChannelSet::canonicalChannelSet(format.numChannels);
+    auto layout = stream->processor->getBusesLayout();
+    layout.inputBuses.set(0, channelSet);
+    layout.outputBuses.set(0, channelSet);
+
+    for (int bus = 1; bus < layout.inputBuses.size(); ++bus)
+        layout.inputBuses.set(bus, juce::AudioChannelSet::disabled());
+
+    if (format.numChannels < 1 || ! stream->processor->setBusesLayout(layout))
+        return fail("unsupported channel count " + arguments[2]);
+
+    juce::String error;
+    stream->shared = SharedStream::create(name, format, error);
+
+    if (stream->shared == nullptr)
+        return fail(error);
+
+    stream->processor->prepareToPlay(format.sampleRate, format.blockSize);
+    stream->channels.resize((size_t) format.numChannels);
+    stream->shared->getHeader().latencySamples.store(stream->processor->getLatencySamples());
+
+    // the worker with the fewest streams takes it
+    for (int i = 1; i < workers.size(); ++i)
+        if (workers[i]->getNumStreams() < workers[stream->worker]->getNumStreams())
+            stream->worker = i;
+
+    auto worker = stream->worker;
+    streams[name] = std::move(stream);
+    publishStreams(worker);
+
+    const auto& opened = *streams[name];
+    return "ok " + opened.shared->getObjectName() + " latency " + juce::String(opened.processor->getLatencySamples());
+}
+
+juce::String EqDaemon::close(const juce::String& name)
+{
+    auto found = streams.find(name);
+
+    if (found == streams.end())
+        return fail("no stream " + name);
+
+    // the worker lets go of the stream before it is destroyed
+    auto stream = std::move(found->second);
+    streams.erase(found);
+    publishStreams(stream->worker);
+
+    stream->processor->releaseResources();
+    return "ok";
+}
+
+juce::String EqDaemon::setParameter(Stream& stream, const juce::String& value, const juce::String& parameterID)
+{
+    auto* parameter = stream.processor->apvts.getParameter(parameterID);
+
+    if (parameter == nullptr)
+        return fail("no parameter " + parameterID);
+
+    // like a host on its message thread, the worker picks the change up on its next block
+    parameter->setValueNotifyingHost(parameter->convertTo0to1(value.getFloatValue()));
+    return "ok";
+}
+
+juce::String EqDaemon::loadState(Stream& stream, const juce::String& path)
+{
+    juce::MemoryBlock state;
+    auto file = juce::File::getCurrentWorkingDirectory().getChildFile(path);
+
+    if (! file.loadFileAsData(state))
+        return fail("could not read " + file.getFullPathName());
+
+    PluginState::Values values;
+
+    if (! stream.processor->getPluginState().read(state.getData(), state.getSize(), values))
+        return fail(file.getFullPathName() + " is not a SimpleEQ state");
+
+    stream.processor->setStateInformation(state.getData(), (int) state.getSize());
+    return "ok";
+}
+
+juce::String EqDaemon::setEngine(Stream& stream, const juce::String& engineName)
+{
+    for (const auto& engine : engines)
+    {
+        if (engine.second == engineName)
+        {
+            stream.processor->setEngine(engine.first);
+            return "ok latency " + juce::String(stream.processor->getLatencySamples());
+        }
+    }
+
+    return fail("unknown engine " + engineName);
+}
+
+juce::String EqDaemon::getStats(const Stream& stream) const
+{
+    const auto& header = stream.shared->getHeader();
+    auto blocks = header.processed.load();
+    auto toMicros = [](juce::uint64 nanos) { return juce::String((double) nanos * 1.0e-3, 1); };
+
+    return "ok blocks " + juce::String((juce::int64) blocks)
+         + " latency_us last " + toMicros(header.lastLatencyNs.load())
+         + " mean " + toMicros(blocks > 0 ? header.totalLatencyNs.load() / blocks : 0)
+         + " max " + toMicros(header.maxLatencyNs.load())
+         + " processor_latency " + juce::String(header.latencySamples.load());
+}
+
+juce::StringArray EqDaemon::getReport()
+{
+    const juce::ScopedLock sl(streamsLock);
+    juce::StringArray report;
+
+    for (auto& entry : streams)
+        report.add(entry.first + " (worker " + juce::String(entry.second->worker) + "): "
+                   + getStats(*entry.second).fromFirstOccurrenceOf("ok ", false, false));
+
+    return report;
+}
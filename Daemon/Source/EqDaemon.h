@@ -0,0 +1,105 @@
+/*
+  ==============================================================================
+
+    EqDaemon.h
+
+    Runs SimpleeqAudioProcessors for other processes, outside any plugin
+    host. Every stream a client opens gets its own processor and its own
+    SharedStream, and is served by one of the workers: one thread per
+    core, pinned to it and scheduled SCHED_FIFO when the system allows.
+    A worker goes over its streams and filters every block that is
+    waiting, in place in shared memory. A worker with nothing to do
+    sleeps idleSleepMicroseconds, which is the most a block waits for it.
+
+    The streams are owned by the control thread (see ControlChannel.h),
+    which hands every worker its list of streams through a TripleBuffer
+    and only destroys a stream once its worker has moved on to a list
+    without it, so the workers never lock.
+
+    Commands, one per line:
+
+        open <stream> <channels> <block size> <sample rate> [<slots>]
+                                       ok <shm object> latency <samples>
+        close <stream>                 ok
+        set <stream> <value> <parameter id>
+                                       ok, e.g. "set vox 6 Peak Gain"
+        state <stream> <preset file>   ok, any format setStateInformation reads
+        engine <stream> chain|fused|simd|smoothed|linear
+                                       ok latency <samples>
+        stats <stream>                 ok blocks <n> latency_us last <t> mean <t> max <t> processor_latency <samples>
+        list                           ok <stream>...
+        shutdown                       ok
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "../../Source/PluginProcessor.h"
+#include "../../Source/TripleBuffer.h"
+#include "SharedStream.h"
+
+class EqDaemon
+{
+public:
+    // what a worker sleeps when none of its streams has a block waiting
+    static constexpr int idleSleepMicroseconds = 50;
+
+    // one worker per core by default. Without realtime the workers keep
+    // the default scheduling, e.g. for running without the rights for it
+    EqDaemon(int numWorkers, bool realtime);
+    ~EqDaemon();
+
+    // control thread: runs one command and returns its reply line
+    juce::String handleCommand(const juce::String& command);
+
+    // set by the shutdown command
+    bool shouldExit() const noexcept { return exitRequested.load(); }
+
+    // one line per stream with its statistics
+    juce::StringArray getReport();
+
+    // whether every worker got the realtime scheduling it asked for
+    bool isRealtime() const;
+
+private:
+    struct Stream
+    {
+        juce::String name;
+        std::unique_ptr<SharedStream> shared;
+        std::unique_ptr<SimpleeqAudioProcessor> processor;
+        int worker { 0 };
+
+        // worker: refers to the slot being filtered, never allocates
+        juce::AudioBuffer<float> buffer;
+        std::vector<float*> channels;
+        juce::MidiBuffer midiMessages;
+
+        // filters the blocks waiting in the ring, false if there were none
+        bool processPending() noexcept;
+    };
+
+    class Worker;
+
+    juce::String open(const juce::StringArray& arguments);
+    juce::String close(const juce::String& name);
+    juce::String setParameter(Stream& stream, const juce::String& value, const juce::String& parameterID);
+    juce::String loadState(Stream& stream, const juce::String& path);
+    juce::String setEngine(Stream& stream, const juce::String& engineName);
+    juce::String getStats(const Stream& stream) const;
+
+    // hands a worker the current list of its streams and waits until it
+    // no longer uses the previous one
+    void publishStreams(int worker);
+
+    // the control thread changes them, the report reads them. The
+    // workers never take this lock, they see their lists only
+    juce::CriticalSection streamsLock;
+    std::map<juce::String, std::unique_ptr<Stream>> streams;
+    juce::OwnedArray<Worker> workers;
+
+    std::atomic<bool> exitRequested { false };
+
+    JUCE_DECLARE_NON_COPYABLE (EqDaemon)
+};
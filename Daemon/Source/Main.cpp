@@ -0,0 +1,128 @@
+/*
+  ==============================================================================
+
+    This file contains the basic startup code for the SimpleEQ daemon.
+
+    Runs the eq for other processes on the same machine, outside any
+    plugin host, e.g. in a broadcast chain:
+
+      simple-eq-daemon [--socket /tmp/simple-eq-daemon.sock] [--workers <n>]
+                       [--no-realtime] [--report <seconds>]
+
+    Clients open streams over the control socket and exchange audio with
+    the daemon through shared memory (see EqDaemon.h, SharedStream.h and
+    simple-eq-client for an example). It runs until SIGINT, SIGTERM or
+    the shutdown command.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "ControlChannel.h"
+#include "EqDaemon.h"
+
+#include <csignal>
+#include <sys/mman.h>
+
+namespace
+{
+    void printUsage()
+    {
+        std::cout << "usage: simple-eq-daemon [--socket <path>] [--workers <n>] [--no-realtime] [--report <seconds>]" << std::endl
+                  << std::endl
+                  << "  --socket       the control socket, default " << ControlServer::defaultSocketPath << std::endl
+                  << "  --workers      processing threads, default one per core" << std::endl
+                  << "  --no-realtime  keep the default scheduling instead of SCHED_FIFO" << std::endl
+                  << "  --report       print the latency of every stream this often, default 10, 0 for never" << std::endl;
+    }
+
+    volatile std::sig_atomic_t signalled = 0;
+
+    void handleSignal(int)
+    {
+        signalled = 1;
+    }
+}
+
+//==============================================================================
+int main (int argc, char* argv[])
+{
+    // the apvts needs a message manager to exist
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    juce::String socketPath(ControlServer::defaultSocketPath);
+    int numWorkers = juce::SystemStats::getNumCpus();
+    bool realtime = true;
+    double reportSeconds = 10.0;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        juce::String argument(argv[i]);
+        auto hasValue = i + 1 < argc;
+
+        if (argument == "--socket" && hasValue)
+            socketPath = argv[++i];
+        else if (argument == "--workers" && hasValue)
+            numWorkers = juce::String(argv[++i]).getIntValue();
+        else if (argument == "--no-realtime")
+            realtime = false;
+        else if (argument == "--report" && hasValue)
+            reportSeconds = juce::String(argv[++i]).getDoubleValue();
+        else
+        {
+            printUsage();
+            return 1;
+        }
+    }
+
+    if (numWorkers < 1)
+    {
+        printUsage();
+        return 1;
+    }
+
+    // no page fault on the audio path: everything mapped so far and
+    // everything allocated from now on stays in memory
+    if (realtime && mlockall(MCL_CURRENT | MCL_FUTURE) != 0)
+        std::cerr << "could not lock the memory of the daemon: " << std::strerror(errno) << std::endl;
+
+    EqDaemon daemon(numWorkers, realtime);
+
+    if (realtime && ! daemon.isRealtime())
+        std::cerr << "the workers run without SCHED_FIFO, allow it with rtprio in limits.conf "
+                     "or CAP_SYS_NICE, or pass --no-realtime" << std::endl;
+
+    ControlServer server([&daemon](const juce::String& command) { return daemon.handleCommand(command); });
+    juce::String error;
+
+    if (! server.start(socketPath, error))
+    {
+        std::cerr << error << std::endl;
+        return 1;
+    }
+
+    std::signal(SIGINT, handleSignal);
+    std::signal(SIGTERM, handleSignal);
+
+    std::cout << "simple-eq-daemon: " << numWorkers << " workers, control socket " << socketPath << std::endl;
+
+    auto nextReport = juce::Time::getMillisecondCounterHiRes() + reportSeconds * 1000.0;
+
+    while (signalled == 0 && ! daemon.shouldExit())
+    {
+        juce::Thread::sleep(100);
+
+        if (reportSeconds > 0.0 && juce::Time::getMillisecondCounterHiRes() >= nextReport)
+        {
+            for (const auto& line : daemon.getReport())
+                std::cout << line << std::endl;
+
+            nextReport += reportSeconds * 1000.0;
+        }
+    }
+
+    // no new commands, then the workers stop and the streams go
+    server.stop();
+    std::cout << "simple-eq-daemon: shutting down" << std::endl;
+    return 0;
+}
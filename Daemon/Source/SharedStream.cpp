@@ -0,0 +1,208 @@
+/*
+  ==============================================================================
+
+    SharedStream.cpp
+
+  ==============================================================================
+*/
+
+#include "SharedStream.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace
+{
+    size_t alignToCacheLine(size_t size) noexcept
+    {
+        return (size + SharedStream::cacheLineSize - 1) & ~(SharedStream::cacheLineSize - 1);
+    }
+
+    juce::String getSystemError()
+    {
+        return juce::String(std::strerror(errno));
+    }
+}
+
+//==============================================================================
+bool SharedStream::isSupported(juce::uint32 channels, juce::uint32 samples, juce::uint32 slotCount) noexcept
+{
+    return channels >= 1 && channels <= 64 && samples >= 1 && samples <= 8192 && slotCount >= 2 && slotCount <= 1024;
+}
+
+size_t SharedStream::getSlotSize(juce::uint32 channels, juce::uint32 samples) noexcept
+{
+    return sizeof(SlotHeader) + alignToCacheLine(sizeof(float) * samples) * channels;
+}
+
+size_t SharedStream::getMappingSize(juce::uint32 channels, juce::uint32 samples, juce::uint32 slotCount) noexcept
+{
+    return alignToCacheLine(sizeof(Header)) + getSlotSize(channels, samples) * slotCount;
+}
+
+juce::uint64 SharedStream::now() noexcept
+{
+    timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (juce::uint64) time.tv_sec * 1000000000ull + (juce::uint64) time.tv_nsec;
+}
+
+//==============================================================================
+std::unique_ptr<SharedStream> SharedStream::create(const juce::String& name, const Format& format, juce::String& error)
+{
+    if (format.numChannels < 1 || format.blockSize < 1 || format.numSlots < 1 || format.sampleRate <= 0.0
+        || ! isSupported((juce::uint32) format.numChannels, (juce::uint32) format.blockSize, (juce::uint32) format.numSlots))
+    {
+        error = "unsupported stream format";
+        return {};
+    }
+
+    auto channels = (juce::uint32) format.numChannels;
+    auto samples = (juce::uint32) format.blockSize;
+    auto slotCount = (juce::uint32) format.numSlots;
+
+    auto objectName = "/simple-eq-" + juce::String((int) getpid()) + "-" + name;
+    auto size = getMappingSize(channels, samples, slotCount);
+
+    auto fd = shm_open(objectName.toRawUTF8(), O_CREAT | O_EXCL | O_RDWR, 0600);
+
+    // the name has our pid in it and the daemon never opens a stream
+    // twice, so this is left behind by a killed daemon that had our pid
+    if (fd < 0 && errno == EEXIST)
+    {
+        shm_unlink(objectName.toRawUTF8());
+        fd = shm_open(objectName.toRawUTF8(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    }
+
+    if (fd < 0)
+    {
+        error = "could not create " + objectName + ": " + getSystemError();
+        return {};
+    }
+
+    if (ftruncate(fd, (off_t) size) != 0)
+    {
+        error = "could not size " + objectName + ": " + getSystemError();
+        close(fd);
+        shm_unlink(objectName.toRawUTF8());
+        return {};
+    }
+
+    auto* mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (mapping == MAP_FAILED)
+    {
+        error = "could not map " + objectName + ": " + getSystemError();
+        shm_unlink(objectName.toRawUTF8());
+        return {};
+    }
+
+    // the workers touch these pages on every block, they must never be
+    // paged out. Without the rights for it the stream still works
+    mlock(mapping, size);
+
+    auto* header = new (mapping) Header {};
+    header->version = currentVersion;
+    header->numChannels = channels;
+    header->blockSize = samples;
+    header->numSlots = slotCount;
+    header->sampleRate = format.sampleRate;
+    header->open.store(1);
+
+    // the magic goes in last, a client that sees it sees the rest
+    header->magic.store(magic, std::memory_order_release);
+
+    return std::unique_ptr<SharedStream>(new SharedStream(objectName, mapping, size, true, channels, samples, slotCount));
+}
+
+std::unique_ptr<SharedStream> SharedStream::open(const juce::String& objectName, juce::String& error)
+{
+    auto fd = shm_open(objectName.toRawUTF8(), O_RDWR, 0600);
+
+    if (fd < 0)
+    {
+        error = "could not open " + objectName + ": " + getSystemError();
+        return {};
+    }
+
+    struct stat status;
+
+    if (fstat(fd, &status) != 0 || (size_t) status.st_size < sizeof(Header))
+    {
+        error = objectName + " is not a stream";
+        close(fd);
+        return {};
+    }
+
+    auto size = (size_t) status.st_size;
+    auto* mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (mapping == MAP_FAILED)
+    {
+        error = "could not map " + objectName + ": " + getSystemError();
+        return {};
+    }
+
+    const auto& header = *static_cast<const Header*>(mapping);
+
+    // pairs with the release store in create(), the format is complete once the magic is there
+    auto isStream = header.magic.load(std::memory_order_acquire) == magic && header.version == currentVersion;
+    auto channels = header.numChannels, samples = header.blockSize, slotCount = header.numSlots;
+
+    if (! isStream || ! isSupported(channels, samples, slotCount) || size < getMappingSize(channels, samples, slotCount))
+    {
+        error = objectName + " is not a stream of this version";
+        munmap(mapping, size);
+        return {};
+    }
+
+    return std::unique_ptr<SharedStream>(new SharedStream(objectName, mapping, size, false, channels, samples, slotCount));
+}
+
+SharedStream::SharedStream(const juce::String& name, void* mappingToUse, size_t size, bool isOwner,
+                           juce::uint32 channels, juce::uint32 samples, juce::uint32 slotCount)
+    : objectName(name),
+      mapping(mappingToUse),
+      mappingSize(size),
+      header(static_cast<Header*>(mappingToUse)),
+      slots(static_cast<char*>(mappingToUse) + alignToCacheLine(sizeof(Header))),
+      numChannels(channels),
+      blockSize(samples),
+      numSlots(slotCount),
+      slotSize(getSlotSize(channels, samples)),
+      channelSize(alignToCacheLine(sizeof(float) * samples)),
+      owner(isOwner)
+{
+}
+
+SharedStream::~SharedStream()
+{
+    // a client still holding the mapping keeps the memory, but sees the
+    // stream closed and can no longer open it again
+    if (owner)
+    {
+        header->open.store(0);
+        shm_unlink(objectName.toRawUTF8());
+    }
+
+    munmap(mapping, mappingSize);
+}
+
+//==============================================================================
+SharedStream::SlotHeader& SharedStream::getSlot(juce::uint64 block) const noexcept
+{
+    return *reinterpret_cast<SlotHeader*>(slots + slotSize * (size_t) (block % numSlots));
+}
+
+float* SharedStream::getChannel(juce::uint64 block, int channel) const noexcept
+{
+    jassert(juce::isPositiveAndBelow(channel, (int) numChannels));
+    auto* slot = slots + slotSize * (size_t) (block % numSlots);
+
+    return reinterpret_cast<float*>(slot + sizeof(SlotHeader) + channelSize * (size_t) channel);
+}
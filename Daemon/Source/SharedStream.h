@@ -0,0 +1,144 @@
+/*
+  ==============================================================================
+
+    SharedStream.h
+
+    One audio stream between a client process and the daemon, in POSIX
+    shared memory. The audio is never copied between the two: the client
+    writes a block straight into a slot of the ring, the daemon filters it
+    there in place and the client reads the result back out of the same
+    slot.
+
+    Layout: a Header, then numSlots slots of one SlotHeader and the
+    channels of one block each, channel after channel (planar float32),
+    every part aligned to a cache line.
+
+    The ring is driven by three counters that only ever grow, each
+    written by one side only:
+
+        written    client: blocks filled        (slot free while written - consumed < numSlots)
+        processed  daemon: blocks filtered      (slot pending while processed < written)
+        consumed   client: blocks read back     (slot ready while consumed < processed)
+
+    so both sides work without locks or system calls. The slot of block
+    n is n % numSlots.
+
+    The format in the header is only for the client. Both sides keep
+    their own copy of it from when the stream was created or opened and
+    index the ring with that, so a client that scribbles over the header
+    cannot make the daemon reach past the mapping or its buffers.
+
+    Every daemon names its objects after its pid, so two daemons on one
+    machine (each with its own control socket) never touch each other's
+    streams. The name is part of the reply to the open command.
+
+    Latency: the client stamps every block when it hands it over, the
+    daemon when it is done with it. The daemon keeps the last, mean and
+    worst of the difference in the header, next to the latency of the
+    processor itself (the linear phase engine has some), so both sides
+    can report them.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+class SharedStream
+{
+public:
+    static constexpr juce::uint32 magic = 0x44514553; // "SEQD" in memory
+    static constexpr juce::uint32 currentVersion = 1;
+    static constexpr size_t cacheLineSize = 64;
+
+    // what the client asks for when it opens a stream
+    struct Format
+    {
+        int numChannels { 2 };
+        int blockSize { 256 };
+        int numSlots { 8 };
+        double sampleRate { 48000.0 };
+    };
+
+    struct alignas(cacheLineSize) Header
+    {
+        // written last by the daemon, with release semantics
+        std::atomic<juce::uint32> magic;
+        juce::uint32 version;
+        juce::uint32 numChannels, blockSize, numSlots;
+        double sampleRate;
+
+        // set by the daemon: the processor's own latency in samples, and
+        // whether it is still serving the stream
+        std::atomic<juce::int32> latencySamples;
+        std::atomic<juce::uint32> open;
+
+        alignas(cacheLineSize) std::atomic<juce::uint64> written;
+        alignas(cacheLineSize) std::atomic<juce::uint64> processed;
+        alignas(cacheLineSize) std::atomic<juce::uint64> consumed;
+
+        // daemon statistics, in nanoseconds from hand over to done
+        alignas(cacheLineSize) std::atomic<juce::uint64> lastLatencyNs;
+        std::atomic<juce::uint64> maxLatencyNs;
+        std::atomic<juce::uint64> totalLatencyNs;
+    };
+
+    struct alignas(cacheLineSize) SlotHeader
+    {
+        // CLOCK_MONOTONIC, the same clock in every process of the machine
+        juce::uint64 submittedNs, doneNs;
+    };
+
+    // the counters live in memory another process maps, they must not
+    // fall back to a lock
+    static_assert(std::atomic<juce::uint64>::is_always_lock_free, "shared counters need lock free 64 bit atomics");
+
+    // daemon: creates and initialises the shared memory object, which is
+    // removed again when the stream is destroyed
+    static std::unique_ptr<SharedStream> create(const juce::String& name, const Format& format, juce::String& error);
+
+    // client: maps a stream the daemon created, given its object name
+    static std::unique_ptr<SharedStream> open(const juce::String& objectName, juce::String& error);
+
+    ~SharedStream();
+
+    // "/simple-eq-<daemon pid>-<stream name>", what shm_open() gets
+    const juce::String& getObjectName() const noexcept { return objectName; }
+
+    // the format as it was when the stream was created or opened,
+    // whatever the header says now
+    Header& getHeader() const noexcept { return *header; }
+    int getNumChannels() const noexcept { return (int) numChannels; }
+    int getBlockSize() const noexcept { return (int) blockSize; }
+    int getNumSlots() const noexcept { return (int) numSlots; }
+
+    // the slot of a block, and its channels
+    SlotHeader& getSlot(juce::uint64 block) const noexcept;
+    float* getChannel(juce::uint64 block, int channel) const noexcept;
+
+    // nanoseconds on CLOCK_MONOTONIC
+    static juce::uint64 now() noexcept;
+
+private:
+    SharedStream(const juce::String& objectName, void* mapping, size_t size, bool owner,
+                 juce::uint32 channels, juce::uint32 samples, juce::uint32 slotCount);
+
+    // the limits of a format either side accepts
+    static bool isSupported(juce::uint32 channels, juce::uint32 samples, juce::uint32 slotCount) noexcept;
+
+    // the size of the mapping and of one slot for a format
+    static size_t getSlotSize(juce::uint32 channels, juce::uint32 samples) noexcept;
+    static size_t getMappingSize(juce::uint32 channels, juce::uint32 samples, juce::uint32 slotCount) noexcept;
+
+    juce::String objectName;
+    void* mapping { nullptr };
+    size_t mappingSize { 0 };
+    Header* header { nullptr };
+    char* slots { nullptr };
+    juce::uint32 numChannels { 0 }, blockSize { 0 }, numSlots { 0 };
+    size_t slotSize { 0 }, channelSize { 0 };
+    bool owner { false };
+
+    JUCE_DECLARE_NON_COPYABLE (SharedStream)
+};
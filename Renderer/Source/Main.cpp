@@ -0,0 +1,307 @@
+/*
+  ==============================================================================
+
+    This file contains the basic startup code for the SimpleEQ renderer.
+
+    Renders audio files through the eq offline, without a plugin host:
+
+      simple-eq-render --preset preset.xml --output-dir out [--threads 8]
+                       [--block-size 1024] [--format flac] [--double]
+                       [--split [--tolerance -120] [--verify]]
+                       [--profile trace.json] files...
+
+    Files are spread over a pool of worker threads, each with its own
+    SimpleeqAudioProcessor. With --split, the files are rendered one
+    after another instead, each one cut into segments that are rendered
+    on all threads (see SegmentedRenderer.h). With --profile, every
+    processBlock is timed stage by stage: the statistics are printed and
+    the first blocks of every thread are written as a Chrome trace.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "OfflineRenderer.h"
+#include "SegmentedRenderer.h"
+
+namespace
+{
+    void printUsage()
+    {
+        std::cout << "usage: simple-eq-render --preset <file> --output-dir <dir> [--threads <n>]" << std::endl
+                  << "                        [--block-size <n>] [--format wav|flac|aiff] [--double]" << std::endl
+                  << "                        [--split [--tolerance <dB>] [--verify]] [--profile <trace.json>]" << std::endl
+                  << "                        <input files...>" << std::endl
+                  << std::endl
+                  << "  --double     run the eq in double precision" << std::endl
+                  << "  --split      render each file in parallel segments with a filter pre-roll" << std::endl
+                  << "  --tolerance  how close the segments must get to a serial render, default -120 dB" << std::endl
+                  << "  --verify     also render serially and fail if the difference exceeds the tolerance" << std::endl
+                  << "  --profile    time the stages of processBlock and write a Chrome trace" << std::endl;
+    }
+    
+    // serialises the output of the worker threads
+    juce::CriticalSection consoleLock;
+    
+    void printResult(const RenderResult& result)
+    {
+        const juce::ScopedLock sl(consoleLock);
+        
+        if (! result.succeeded)
+        {
+            std::cerr << "FAILED " << result.input.getFileName() << ": " << result.error << std::endl;
+            return;
+        }
+        
+        std::cout << result.input.getFileName() << " -> " << result.output.getFileName()
+                  << "  " << juce::String(result.audioSeconds, 1) << " s audio"
+                  << "  " << juce::String(result.getRealtimeFactor(), 1) << "x realtime";
+        
+        if (result.numSegments > 1)
+            std::cout << "  " << result.numSegments << " segments, pre-roll " << result.preRollSamples << " samples";
+        
+        if (result.verified)
+            std::cout << "  null test max deviation " << juce::String(juce::Decibels::gainToDecibels(result.maxDeviation, -300.0), 1) << " dB";
+        
+        std::cout << std::endl;
+    }
+    
+    // the stage statistics of all threads, in cycles and microseconds
+    void printProfile(const StageProfiler::Report& report)
+    {
+        auto cyclesPerMicro = report.getCyclesPerSecond() / 1.0e6;
+        
+        auto format = [cyclesPerMicro](double cycles)
+        {
+            return (juce::String(cycles, 0) + " / " + juce::String(cyclesPerMicro > 0.0 ? cycles / cyclesPerMicro : 0.0, 1))
+                       .paddedLeft(' ', 18);
+        };
+        
+        std::cout << std::endl << "processBlock stages, cycles / us per block" << std::endl
+                  << "stage                          mean               p50               p90               p99               max" << std::endl;
+        
+        for (int stage = 0; stage <= StageProfiler::numStages; ++stage)
+        {
+            const auto& histogram = report.histograms[(size_t) stage];
+            
+            if (histogram.count == 0)
+                continue;
+            
+            std::cout << StageProfiler::getStageName(stage).paddedRight(' ', 20)
+                      << format(histogram.getMean())
+                      << format(histogram.getPercentile(50.0))
+                      << format(histogram.getPercentile(90.0))
+                      << format(histogram.getPercentile(99.0))
+                      << format((double) histogram.max) << std::endl;
+        }
+        
+        std::cout << report.numDeadlineMisses << " of " << report.numBlocks << " blocks took longer than their real-time period"
+                  << ", peak load " << juce::String(report.maxLoad * 100.0, 1) << "%";
+        
+        if (report.numDroppedBlocks > 0)
+            std::cout << ", " << report.numDroppedBlocks << " blocks not collected";
+        
+        std::cout << std::endl;
+    }
+    
+    // one processor per worker, the workers pull the next file until none are left
+    class RenderWorker : public juce::Thread
+    {
+    public:
+        RenderWorker(const RenderOptions& options,
+                     const juce::Array<juce::File>& filesToRender,
+                     std::atomic<int>& nextFileIndex,
+                     std::vector<RenderResult>& resultsToFill)
+            : juce::Thread("SimpleEQ render worker"),
+              renderer(options),
+              files(filesToRender),
+              nextFile(nextFileIndex),
+              results(resultsToFill)
+        {
+        }
+        
+        const OfflineRenderer& getRenderer() const noexcept { return renderer; }
+        
+        void run() override
+        {
+            while (! threadShouldExit())
+            {
+                auto index = nextFile++;
+                
+                if (index >= files.size())
+                    return;
+                
+                // every index is written by exactly one worker
+                results[(size_t) index] = renderer.render(files.getReference(index));
+                printResult(results[(size_t) index]);
+            }
+        }
+        
+    private:
+        OfflineRenderer renderer;
+        const juce::Array<juce::File>& files;
+        std::atomic<int>& nextFile;
+        std::vector<RenderResult>& results;
+    };
+}
+
+//==============================================================================
+int main (int argc, char* argv[])
+{
+    // the apvts needs a message manager to exist
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+    
+    RenderOptions options;
+    juce::File presetFile;
+    juce::Array<juce::File> files;
+    int numThreads = juce::SystemStats::getNumCpus();
+    bool split = false, verify = false;
+    juce::File traceFile;
+    double toleranceDecibels = juce::Decibels::gainToDecibels(SegmentedRenderer::defaultTolerance, -300.0);
+    
+    for (int i = 1; i < argc; ++i)
+    {
+        juce::String argument(argv[i]);
+        auto hasValue = i + 1 < argc;
+        
+        if (argument == "--preset" && hasValue)
+            presetFile = juce::File::getCurrentWorkingDirectory().getChildFile(argv[++i]);
+        else if (argument == "--output-dir" && hasValue)
+            options.outputDirectory = juce::File::getCurrentWorkingDirectory().getChildFile(argv[++i]);
+        else if (argument == "--threads" && hasValue)
+            numThreads = juce::String(argv[++i]).getIntValue();
+        else if (argument == "--block-size" && hasValue)
+            options.blockSize = juce::String(argv[++i]).getIntValue();
+        else if (argument == "--format" && hasValue)
+            options.outputFormat = argv[++i];
+        else if (argument == "--double")
+            options.doublePrecision = true;
+        else if (argument == "--split")
+            split = true;
+        else if (argument == "--tolerance" && hasValue)
+            toleranceDecibels = juce::String(argv[++i]).getDoubleValue();
+        else if (argument == "--verify")
+            verify = true;
+        else if (argument == "--profile" && hasValue)
+            traceFile = juce::File::getCurrentWorkingDirectory().getChildFile(argv[++i]);
+        else if (argument.startsWith("--"))
+        {
+            printUsage();
+            return 1;
+        }
+        else
+            files.add(juce::File::getCurrentWorkingDirectory().getChildFile(argument));
+    }
+    
+    if (files.isEmpty() || options.outputDirectory == juce::File() || numThreads < 1 || options.blockSize < 1)
+    {
+        printUsage();
+        return 1;
+    }
+    
+    // without a preset the files are rendered with the default parameters
+    if (presetFile != juce::File())
+    {
+        juce::String error;
+        
+        if (! loadPreset(presetFile, options.presetState, error))
+        {
+            std::cerr << error << std::endl;
+            return 1;
+        }
+    }
+    
+    if (! options.outputDirectory.createDirectory())
+    {
+        std::cerr << "could not create " << options.outputDirectory.getFullPathName() << std::endl;
+        return 1;
+    }
+    
+    options.profile = traceFile != juce::File();
+    
+    std::vector<RenderResult> results((size_t) files.size());
+    
+    // the profiles of every renderer, one trace thread per renderer
+    StageProfiler::Report profileReport;
+    juce::Array<juce::var> traceEvents;
+    
+    auto addProfile = [&](const OfflineRenderer& renderer, int threadId)
+    {
+        profileReport.merge(renderer.getProfiler().getReport());
+        renderer.getProfiler().addTraceEvents(traceEvents, threadId);
+    };
+    
+    auto startTicks = juce::Time::getHighResolutionTicks();
+    
+    if (split)
+    {
+        // one file at a time, every file on all threads
+        SegmentedRenderer renderer(options, numThreads, juce::Decibels::decibelsToGain(toleranceDecibels, -300.0), verify);
+        
+        for (int i = 0; i < files.size(); ++i)
+        {
+            results[(size_t) i] = renderer.render(files.getReference(i));
+            printResult(results[(size_t) i]);
+        }
+        
+        if (options.profile)
+            for (int i = 0; i < renderer.getRenderers().size(); ++i)
+                addProfile(*renderer.getRenderers()[i], i);
+    }
+    else
+    {
+        numThreads = juce::jmin(numThreads, files.size());
+        
+        std::atomic<int> nextFile { 0 };
+        juce::OwnedArray<RenderWorker> workers;
+        
+        for (int i = 0; i < numThreads; ++i)
+            workers.add(new RenderWorker(options, files, nextFile, results))->startThread();
+        
+        for (auto* worker : workers)
+            worker->waitForThreadToExit(-1);
+        
+        if (options.profile)
+            for (int i = 0; i < workers.size(); ++i)
+                addProfile(workers[i]->getRenderer(), i);
+    }
+    
+    auto wallSeconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - startTicks);
+    
+    // throughput: audio seconds per wall second, overall and per core
+    double audioSeconds = 0.0, processingSeconds = 0.0;
+    int numFailed = 0;
+    
+    for (const auto& result : results)
+    {
+        audioSeconds += result.audioSeconds;
+        processingSeconds += result.processingSeconds;
+        numFailed += result.succeeded ? 0 : 1;
+    }
+    
+    auto realtimeFactor = wallSeconds > 0.0 ? audioSeconds / wallSeconds : 0.0;
+    
+    std::cout << std::endl
+              << files.size() - numFailed << " of " << files.size() << " files, "
+              << juce::String(audioSeconds, 1) << " s audio in " << juce::String(wallSeconds, 2) << " s on "
+              << numThreads << " threads" << std::endl
+              << "realtime factor: " << juce::String(realtimeFactor, 1) << "x total, "
+              << juce::String(realtimeFactor / numThreads, 1) << "x per core"
+              << " (processBlock alone: " << juce::String(processingSeconds > 0.0 ? audioSeconds / processingSeconds : 0.0, 1)
+              << "x per core)" << std::endl;
+    
+    if (options.profile)
+    {
+        printProfile(profileReport);
+        
+        if (! StageProfiler::writeChromeTrace(traceFile, traceEvents))
+        {
+            std::cerr << "could not write " << traceFile.getFullPathName() << std::endl;
+            return 1;
+        }
+        
+        std::cout << "trace written to " << traceFile.getFullPathName() << std::endl;
+    }
+    
+    return numFailed == 0 ? 0 : 1;
+}
@@ -0,0 +1,324 @@
+/*
+  ==============================================================================
+
+    OfflineRenderer.cpp
+
+  ==============================================================================
+*/
+
+#include "OfflineRenderer.h"
+
+bool loadPreset(const juce::File& presetFile, juce::MemoryBlock& stateToFill, juce::String& error)
+{
+    if (! presetFile.existsAsFile())
+    {
+        error = "preset not found: " + presetFile.getFullPathName();
+        return false;
+    }
+    
+    // presets saved as XML are turned into the binary form setStateInformation() expects
+    if (auto xml = juce::XmlDocument::parse(presetFile))
+    {
+        auto tree = juce::ValueTree::fromXml(*xml);
+        
+        if (! tree.isValid())
+        {
+            error = "preset is not a SimpleEQ state: " + presetFile.getFullPathName();
+            return false;
+        }
+        
+        stateToFill.reset();
+        juce::MemoryOutputStream memoryOutputStream(stateToFill, false);
+        tree.writeToStream(memoryOutputStream);
+        return true;
+    }
+    
+    // binary presets are either compact states (see PluginState.h) or the
+    // apvts tree of earlier releases
+    if (! presetFile.loadFileAsData(stateToFill)
+        || ! (PluginState::isCompact(stateToFill.getData(), stateToFill.getSize())
+              || juce::ValueTree::readFromData(stateToFill.getData(), stateToFill.getSize()).isValid()))
+    {
+        error = "could not read preset: " + presetFile.getFullPathName();
+        return false;
+    }
+    
+    return true;
+}
+
+std::unique_ptr<juce::AudioFormatWriter> createWriterFor(const juce::File& output,
+                                                         juce::AudioFormatManager& formatManager,
+                                                         double sampleRate,
+                                                         int numChannels,
+                                                         int preferredBitsPerSample,
+                                                         const juce::StringPairArray& metadata,
+                                                         juce::String& error)
+{
+    auto* format = formatManager.findFormatForFileExtension(output.getFileExtension());
+    
+    if (format == nullptr)
+    {
+        error = "unknown output format " + output.getFileExtension();
+        return {};
+    }
+    
+    // keep the bit depth of the source if the output format can store it
+    auto bitDepths = format->getPossibleBitDepths();
+    auto bitsPerSample = bitDepths.contains(preferredBitsPerSample) ? preferredBitsPerSample
+                                                                   : bitDepths[bitDepths.size() - 1];
+    
+    output.deleteFile();
+    std::unique_ptr<juce::OutputStream> outputStream(output.createOutputStream());
+    
+    if (outputStream == nullptr)
+    {
+        error = "could not write " + output.getFullPathName();
+        return {};
+    }
+    
+    std::unique_ptr<juce::AudioFormatWriter> writer(format->createWriterFor(outputStream.get(),
+                                                                            sampleRate,
+                                                                            (unsigned int) numChannels,
+                                                                            bitsPerSample,
+                                                                            metadata,
+                                                                            0));
+    
+    if (writer == nullptr)
+    {
+        error = "could not create a " + format->getFormatName() + " writer";
+        return {};
+    }
+    
+    // the writer owns the stream now
+    outputStream.release();
+    return writer;
+}
+
+//==============================================================================
+OfflineRenderer::OfflineRenderer(const RenderOptions& renderOptions)
+    : options(renderOptions)
+{
+    // wav, aiff, flac (and ogg if enabled)
+    formatManager.registerBasicFormats();
+    
+    // we are not in a real-time context, the processor may take its time
+    processor.setNonRealtime(true);
+}
+
+juce::File OfflineRenderer::getOutputFileFor(const juce::File& input) const
+{
+    auto extension = options.outputFormat.isNotEmpty() ? "." + options.outputFormat.trimCharactersAtStart(".")
+                                                       : input.getFileExtension();
+    
+    return options.outputDirectory.getChildFile(input.getFileNameWithoutExtension() + extension);
+}
+
+bool OfflineRenderer::prepareProcessor(const juce::AudioFormatReader& reader, juce::String& error)
+{
+    // run the processor with exactly as many channels as the file has
+    auto channelSet = juce::AudioChannelSet::canonicalChannelSet((int) reader.numChannels);
+    
+    // on the main buses, the sidechain stays off
+    auto layout = processor.getBusesLayout();
+    layout.inputBuses.set(0, channelSet);
+    layout.outputBuses.set(0, channelSet);
+    
+    for (int bus = 1; bus < layout.inputBuses.size(); ++bus)
+        layout.inputBuses.set(bus, juce::AudioChannelSet::disabled());
+    
+    if (! processor.setBusesLayout(layout))
+    {
+        error = "unsupported channel count: " + juce::String(reader.numChannels);
+        return false;
+    }
+    
+    // the state has to be in place before prepareToPlay designs the filters
+    if (! options.presetState.isEmpty())
+        processor.setStateInformation(options.presetState.getData(), (int) options.presetState.getSize());
+    
+    processor.setProcessingPrecision(options.doublePrecision ? juce::AudioProcessor::doublePrecision
+                                                             : juce::AudioProcessor::singlePrecision);
+    processor.getProfiler().setEnabled(options.profile);
+    processor.prepareToPlay(reader.sampleRate, options.blockSize);
+    return true;
+}
+
+bool OfflineRenderer::renderRange(juce::AudioFormatReader& reader, juce::AudioFormatWriter& writer,
+                                  juce::int64 start, juce::int64 length, juce::int64 preRoll,
+                                  RenderResult& result)
+{
+    juce::AudioBuffer<float> buffer((int) reader.numChannels, options.blockSize);
+    juce::AudioBuffer<double> doubleBuffer((int) reader.numChannels, options.blockSize);
+    juce::MidiBuffer midiMessages;
+    juce::int64 processingTicks = 0;
+    
+    auto end = start + length;
+    
+    for (auto position = start - preRoll; position < end; )
+    {
+        // never let a block straddle start, so everything we write was
+        // processed after the pre-roll
+        auto blockEnd = position < start ? juce::jmin(start, position + options.blockSize)
+                                         : juce::jmin(end, position + options.blockSize);
+        auto numSamples = (int) (blockEnd - position);
+        
+        // the last block is usually shorter, processBlock gets exactly what we read
+        buffer.setSize((int) reader.numChannels, numSamples, false, false, true);
+        reader.read(&buffer, 0, numSamples, position, true, true);
+        
+        if (options.doublePrecision)
+        {
+            // readers and writers work in float, so we convert around the
+            // processor; only processBlock itself is timed
+            doubleBuffer.makeCopyOf(buffer, true);
+            
+            auto processStart = juce::Time::getHighResolutionTicks();
+            processor.processBlock(doubleBuffer, midiMessages);
+            processingTicks += juce::Time::getHighResolutionTicks() - processStart;
+            
+            buffer.makeCopyOf(doubleBuffer, true);
+        }
+        else
+        {
+            auto processStart = juce::Time::getHighResolutionTicks();
+            processor.processBlock(buffer, midiMessages);
+            processingTicks += juce::Time::getHighResolutionTicks() - processStart;
+        }
+        
+        // empty the profiler's ring before it overflows, outside the timing
+        if (options.profile)
+            processor.getProfiler().collect();
+        
+        if (position >= start && ! writer.writeFromAudioSampleBuffer(buffer, 0, numSamples))
+        {
+            result.error = "write failed for " + result.output.getFullPathName();
+            return false;
+        }
+        
+        position = blockEnd;
+    }
+    
+    processor.releaseResources();
+    
+    result.processingSeconds = juce::Time::highResolutionTicksToSeconds(processingTicks);
+    return true;
+}
+
+RenderResult OfflineRenderer::render(const juce::File& input)
+{
+    RenderResult result;
+    result.input = input;
+    result.output = getOutputFileFor(input);
+    
+    auto startTicks = juce::Time::getHighResolutionTicks();
+    
+    std::unique_ptr<juce::AudioFormatReader> reader(formatManager.createReaderFor(input));
+    
+    if (reader == nullptr)
+    {
+        result.error = "could not open " + input.getFullPathName();
+        return result;
+    }
+    
+    if (! prepareProcessor(*reader, result.error))
+        return result;
+    
+    auto writer = createWriterFor(result.output, formatManager, reader->sampleRate, (int) reader->numChannels,
+                                  (int) reader->bitsPerSample, reader->metadataValues, result.error);
+    
+    if (writer == nullptr || ! renderRange(*reader, *writer, 0, reader->lengthInSamples, 0, result))
+        return result;
+    
+    writer.reset();
+    
+    result.audioSeconds = (double) reader->lengthInSamples / reader->sampleRate;
+    result.totalSeconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - startTicks);
+    result.succeeded = true;
+    return result;
+}
+
+RenderResult OfflineRenderer::renderSegment(const juce::File& input, juce::int64 start, juce::int64 length,
+                                            juce::int64 preRoll, const juce::File& floatOutput)
+{
+    RenderResult result;
+    result.input = input;
+    result.output = floatOutput;
+    
+    auto startTicks = juce::Time::getHighResolutionTicks();
+    
+    std::unique_ptr<juce::AudioFormatReader> reader(formatManager.createReaderFor(input));
+    
+    if (reader == nullptr)
+    {
+        result.error = "could not open " + input.getFullPathName();
+        return result;
+    }
+    
+    if (! prepareProcessor(*reader, result.error))
+        return result;
+    
+    // segments are stitched afterwards, so they are kept as 32 bit float
+    auto writer = createWriterFor(floatOutput, formatManager, reader->sampleRate, (int) reader->numChannels,
+                                  32, {}, result.error);
+    
+    preRoll = juce::jmin(preRoll, start);
+    
+    if (writer == nullptr || ! renderRange(*reader, *writer, start, length, preRoll, result))
+        return result;
+    
+    result.audioSeconds = (double) length / reader->sampleRate;
+    result.preRollSamples = preRoll;
+    result.totalSeconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - startTicks);
+    result.succeeded = true;
+    return result;
+}
+
+bool OfflineRenderer::getDecayLength(const juce::File& input, double tolerance,
+                                     juce::int64& decayLength, juce::String& error)
+{
+    std::unique_ptr<juce::AudioFormatReader> reader(formatManager.createReaderFor(input));
+    
+    if (reader == nullptr)
+    {
+        error = "could not open " + input.getFullPathName();
+        return false;
+    }
+    
+    if (! prepareProcessor(*reader, error))
+        return false;
+    
+    // the first block picks up what prepareToPlay leaves to the audio
+    // thread: the stereo mode with its second set, the dynamic peak and
+    // the bank's bands. After it the processor's tail covers all of them
+    juce::MidiBuffer midiMessages;
+    
+    if (options.doublePrecision)
+    {
+        juce::AudioBuffer<double> silence((int) reader->numChannels, options.blockSize);
+        silence.clear();
+        processor.processBlock(silence, midiMessages);
+    }
+    else
+    {
+        juce::AudioBuffer<float> silence((int) reader->numChannels, options.blockSize);
+        silence.clear();
+        processor.processBlock(silence, midiMessages);
+    }
+    
+    // the tail is where the filters have rung out below the processor's
+    // silence threshold, the decay is exponential so it scales with the
+    // logarithm of the tolerance
+    auto tailSeconds = processor.getTailLengthSeconds()
+                         * std::log(tolerance) / std::log(SimpleeqAudioProcessor::silenceThreshold);
+    
+    // the dynamic peak's detector forgets where it started at its release
+    // rate, the gain follows it
+    auto dynamicPeak = getDynamicPeakSettings(processor.apvts);
+    
+    if (dynamicPeak.enabled)
+        tailSeconds += (double) dynamicPeak.releaseMs * 0.001 * std::log(1.0 / tolerance);
+    
+    decayLength = (juce::int64) std::ceil(tailSeconds * reader->sampleRate);
+    processor.releaseResources();
+    return true;
+}
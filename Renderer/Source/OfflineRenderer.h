@@ -0,0 +1,112 @@
+/*
+  ==============================================================================
+
+    OfflineRenderer.h
+
+    Streams audio files through a SimpleeqAudioProcessor without a host or
+    an editor. Only one block of audio is held in memory at a time, so the
+    memory use does not depend on the length of the file.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "../../Source/PluginProcessor.h"
+
+// what every worker needs to know to render a file
+struct RenderOptions
+{
+    // processor state as written by getStateInformation(), see loadPreset()
+    juce::MemoryBlock presetState;
+    
+    int blockSize { 1024 };
+    juce::File outputDirectory;
+    
+    // "wav", "flac", "aiff"... or empty to keep the input format
+    juce::String outputFormat;
+    
+    // runs processBlock on double buffers, for 64 bit masters or very
+    // low cutoffs at high sample rates
+    bool doublePrecision { false };
+    
+    // times the stages of every processBlock, see StageProfiler.h
+    bool profile { false };
+};
+
+struct RenderResult
+{
+    juce::File input, output;
+    bool succeeded { false };
+    juce::String error;
+    
+    double audioSeconds { 0.0 };
+    // wall time of the whole file including reading and writing,
+    // and the part of it spent inside processBlock
+    double totalSeconds { 0.0 }, processingSeconds { 0.0 };
+    
+    // segmented renders only (see SegmentedRenderer.h)
+    int numSegments { 1 };
+    juce::int64 preRollSamples { 0 };
+    bool verified { false };
+    double maxDeviation { 0.0 };
+    
+    // how many seconds of audio one core renders per second
+    double getRealtimeFactor() const noexcept { return totalSeconds > 0.0 ? audioSeconds / totalSeconds : 0.0; }
+};
+
+// reads a preset file: either the binary state written by
+// getStateInformation() or the same tree saved as XML
+bool loadPreset(const juce::File& presetFile, juce::MemoryBlock& stateToFill, juce::String& error);
+
+// creates a writer for the format matching the file extension, keeping
+// the preferred bit depth if the format can store it
+std::unique_ptr<juce::AudioFormatWriter> createWriterFor(const juce::File& output,
+                                                         juce::AudioFormatManager& formatManager,
+                                                         double sampleRate,
+                                                         int numChannels,
+                                                         int preferredBitsPerSample,
+                                                         const juce::StringPairArray& metadata,
+                                                         juce::String& error);
+
+class OfflineRenderer
+{
+public:
+    explicit OfflineRenderer(const RenderOptions& options);
+    
+    // renders one file into the output directory, not thread safe:
+    // use one renderer (and so one processor) per worker thread
+    RenderResult render(const juce::File& input);
+    
+    // renders [start, start + length) of the input into a 32 bit float wav.
+    // The preRoll samples before start are run through the processor first
+    // and thrown away, so its filters have settled by the time we get to start.
+    RenderResult renderSegment(const juce::File& input, juce::int64 start, juce::int64 length,
+                               juce::int64 preRoll, const juce::File& floatOutput);
+    
+    // how long the preset rings at the file's sample rate until it is
+    // below tolerance, which is the pre-roll a segment needs: the
+    // processor's whole tail, and the dynamic peak's release if it is on
+    bool getDecayLength(const juce::File& input, double tolerance, juce::int64& decayLength, juce::String& error);
+    
+    juce::File getOutputFileFor(const juce::File& input) const;
+    juce::AudioFormatManager& getFormatManager() noexcept { return formatManager; }
+    
+    // what the processor's profiler collected over all files rendered so far
+    const StageProfiler& getProfiler() const noexcept { return processor.getProfiler(); }
+    
+private:
+    bool prepareProcessor(const juce::AudioFormatReader& reader, juce::String& error);
+    
+    // runs [start - preRoll, start + length) through the processor and
+    // writes everything from start on
+    bool renderRange(juce::AudioFormatReader& reader, juce::AudioFormatWriter& writer,
+                     juce::int64 start, juce::int64 length, juce::int64 preRoll, RenderResult& result);
+    
+    const RenderOptions& options;
+    juce::AudioFormatManager formatManager;
+    SimpleeqAudioProcessor processor;
+    
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (OfflineRenderer)
+};
@@ -0,0 +1,252 @@
+/*
+  ==============================================================================
+
+    SegmentedRenderer.cpp
+
+  ==============================================================================
+*/
+
+#include "SegmentedRenderer.h"
+
+namespace
+{
+    // renders the segments handed out by a shared counter with its own renderer
+    class SegmentWorker : public juce::Thread
+    {
+    public:
+        SegmentWorker(OfflineRenderer& rendererToUse, const juce::File& inputFile,
+                      std::function<void (OfflineRenderer&, const juce::File&)> workToDo)
+            : juce::Thread("SimpleEQ segment worker"),
+              renderer(rendererToUse),
+              input(inputFile),
+              work(std::move(workToDo))
+        {
+        }
+        
+        void run() override { work(renderer, input); }
+        
+    private:
+        OfflineRenderer& renderer;
+        juce::File input;
+        std::function<void (OfflineRenderer&, const juce::File&)> work;
+    };
+    
+    // segments must be long enough that the pre-roll does not dominate
+    constexpr int minSegmentToPreRollRatio = 4;
+}
+
+SegmentedRenderer::SegmentedRenderer(const RenderOptions& renderOptions, int numThreads,
+                                     double toleranceToUse, bool verifyAgainstSerialRender)
+    : options(renderOptions),
+      tolerance(toleranceToUse),
+      verify(verifyAgainstSerialRender)
+{
+    for (int i = 0; i < juce::jmax(1, numThreads); ++i)
+        renderers.add(new OfflineRenderer(options));
+}
+
+void SegmentedRenderer::renderSegments(const juce::File& input, std::vector<Segment>& segments, juce::int64 preRoll)
+{
+    std::atomic<size_t> nextSegment { 0 };
+    juce::OwnedArray<SegmentWorker> workers;
+    
+    for (auto* renderer : renderers)
+    {
+        workers.add(new SegmentWorker(*renderer, input, [&segments, &nextSegment, preRoll](OfflineRenderer& r, const juce::File& file)
+        {
+            for (auto index = nextSegment++; index < segments.size(); index = nextSegment++)
+            {
+                auto& segment = segments[index];
+                segment.result = r.renderSegment(file, segment.start, segment.length, preRoll, segment.file);
+            }
+        }))->startThread();
+    }
+    
+    for (auto* worker : workers)
+        worker->waitForThreadToExit(-1);
+}
+
+bool SegmentedRenderer::stitch(const std::vector<Segment>& segments, const juce::AudioFormatReader& source, RenderResult& result)
+{
+    auto& formatManager = renderers.getFirst()->getFormatManager();
+    
+    auto writer = createWriterFor(result.output, formatManager, source.sampleRate, (int) source.numChannels,
+                                  (int) source.bitsPerSample, source.metadataValues, result.error);
+    
+    if (writer == nullptr)
+        return false;
+    
+    juce::AudioBuffer<float> buffer((int) source.numChannels, options.blockSize);
+    
+    for (const auto& segment : segments)
+    {
+        std::unique_ptr<juce::AudioFormatReader> reader(formatManager.createReaderFor(segment.file));
+        
+        if (reader == nullptr || reader->lengthInSamples != segment.length)
+        {
+            result.error = "could not read back segment " + segment.file.getFullPathName();
+            return false;
+        }
+        
+        for (juce::int64 position = 0; position < segment.length; position += options.blockSize)
+        {
+            auto numSamples = (int) juce::jmin((juce::int64) options.blockSize, segment.length - position);
+            reader->read(&buffer, 0, numSamples, position, true, true);
+            
+            if (! writer->writeFromAudioSampleBuffer(buffer, 0, numSamples))
+            {
+                result.error = "write failed for " + result.output.getFullPathName();
+                return false;
+            }
+        }
+    }
+    
+    return true;
+}
+
+bool SegmentedRenderer::nullTest(const std::vector<Segment>& segments, const juce::File& serialRender, RenderResult& result)
+{
+    auto& formatManager = renderers.getFirst()->getFormatManager();
+    std::unique_ptr<juce::AudioFormatReader> serial(formatManager.createReaderFor(serialRender));
+    
+    if (serial == nullptr)
+    {
+        result.error = "could not read back the serial render";
+        return false;
+    }
+    
+    juce::AudioBuffer<float> expected((int) serial->numChannels, options.blockSize);
+    juce::AudioBuffer<float> actual((int) serial->numChannels, options.blockSize);
+    double maxDeviation = 0.0;
+    juce::int64 serialPosition = 0;
+    
+    for (const auto& segment : segments)
+    {
+        std::unique_ptr<juce::AudioFormatReader> reader(formatManager.createReaderFor(segment.file));
+        
+        if (reader == nullptr)
+            return false;
+        
+        for (juce::int64 position = 0; position < segment.length; position += options.blockSize)
+        {
+            auto numSamples = (int) juce::jmin((juce::int64) options.blockSize, segment.length - position);
+            reader->read(&actual, 0, numSamples, position, true, true);
+            serial->read(&expected, 0, numSamples, serialPosition + position, true, true);
+            
+            for (int channel = 0; channel < actual.getNumChannels(); ++channel)
+            {
+                auto* a = actual.getReadPointer(channel);
+                auto* e = expected.getReadPointer(channel);
+                
+                for (int i = 0; i < numSamples; ++i)
+                    maxDeviation = juce::jmax(maxDeviation, (double) std::abs(a[i] - e[i]));
+            }
+        }
+        
+        serialPosition += segment.length;
+    }
+    
+    result.verified = true;
+    result.maxDeviation = maxDeviation;
+    
+    if (maxDeviation > tolerance)
+    {
+        result.error = "null test failed: segmented render differs by " + juce::String(maxDeviation)
+                     + ", tolerance " + juce::String(tolerance);
+        return false;
+    }
+    
+    return true;
+}
+
+RenderResult SegmentedRenderer::render(const juce::File& input)
+{
+    auto& mainRenderer = *renderers.getFirst();
+    
+    RenderResult result;
+    result.input = input;
+    result.output = mainRenderer.getOutputFileFor(input);
+    
+    auto startTicks = juce::Time::getHighResolutionTicks();
+    
+    std::unique_ptr<juce::AudioFormatReader> source(mainRenderer.getFormatManager().createReaderFor(input));
+    
+    if (source == nullptr)
+    {
+        result.error = "could not open " + input.getFullPathName();
+        return result;
+    }
+    
+    juce::int64 preRoll = 0;
+    
+    if (! mainRenderer.getDecayLength(input, tolerance, preRoll, result.error))
+        return result;
+    
+    preRoll = juce::jmin(preRoll, (juce::int64) (maxPreRollSeconds * source->sampleRate));
+    
+    // as many segments as threads, unless the file is too short to be
+    // worth it compared to the pre-roll each segment has to pay for
+    auto length = source->lengthInSamples;
+    auto maxSegments = juce::jmax((juce::int64) 1, length / juce::jmax((juce::int64) 1, preRoll * minSegmentToPreRollRatio));
+    auto numSegments = (int) juce::jmin((juce::int64) renderers.size(), maxSegments);
+    
+    if (numSegments < 2 && ! verify)
+        return mainRenderer.render(input);
+    
+    std::vector<Segment> segments((size_t) numSegments);
+    
+    for (int i = 0; i < numSegments; ++i)
+    {
+        auto& segment = segments[(size_t) i];
+        segment.start = length * i / numSegments;
+        segment.length = length * (i + 1) / numSegments - segment.start;
+        segment.file = result.output.getSiblingFile(result.output.getFileNameWithoutExtension()
+                                                    + ".segment" + juce::String(i) + ".tmp.wav");
+    }
+    
+    renderSegments(input, segments, preRoll);
+    
+    auto succeeded = true;
+    
+    for (const auto& segment : segments)
+    {
+        result.processingSeconds += segment.result.processingSeconds;
+        
+        if (! segment.result.succeeded)
+        {
+            result.error = segment.result.error;
+            succeeded = false;
+        }
+    }
+    
+    succeeded = succeeded && stitch(segments, *source, result);
+    
+    // the wall time of the render itself, the null test is extra work
+    auto renderTicks = juce::Time::getHighResolutionTicks() - startTicks;
+    
+    if (succeeded && verify)
+    {
+        auto serialFile = result.output.getSiblingFile(result.output.getFileNameWithoutExtension() + ".serial.tmp.wav");
+        auto serial = mainRenderer.renderSegment(input, 0, length, 0, serialFile);
+        
+        if (! serial.succeeded)
+        {
+            result.error = serial.error;
+            succeeded = false;
+        }
+        else
+            succeeded = nullTest(segments, serialFile, result);
+        
+        serialFile.deleteFile();
+    }
+    
+    for (const auto& segment : segments)
+        segment.file.deleteFile();
+    
+    result.numSegments = numSegments;
+    result.preRollSamples = preRoll;
+    result.audioSeconds = (double) length / source->sampleRate;
+    result.totalSeconds = juce::Time::highResolutionTicksToSeconds(renderTicks);
+    result.succeeded = succeeded;
+    return result;
+}
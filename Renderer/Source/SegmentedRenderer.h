@@ -0,0 +1,67 @@
+/*
+  ==============================================================================
+
+    SegmentedRenderer.h
+
+    Renders one long file on several cores. The file is cut into segments
+    that are rendered in parallel, each by its own processor. A segment
+    starts with a pre-roll: the audio right before it is run through the
+    filters first and thrown away, so the filter state has converged to
+    what a serial render would have by the time the segment starts.
+
+    The pre-roll length comes from the processor's tail length, which
+    covers the fixed bands, both sets of the dual stereo modes and the
+    filter bank, plus the release of the dynamic peak when it is on (see
+    OfflineRenderer::getDecayLength()): after it, whatever state the
+    filters started from has decayed below the tolerance. The segments do
+    not overlap and are stitched back one after another, so the output has
+    exactly the samples of the input.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "OfflineRenderer.h"
+
+class SegmentedRenderer
+{
+public:
+    // -120 dB relative to full scale
+    static constexpr double defaultTolerance = 1.0e-6;
+    
+    // never pre-roll more than this, e.g. for a low cut so close to 0 Hz
+    // that it practically never decays
+    static constexpr double maxPreRollSeconds = 30.0;
+    
+    SegmentedRenderer(const RenderOptions& options, int numThreads, double tolerance, bool verifyAgainstSerialRender);
+    
+    // renders the file on all threads. With verification on, the file is
+    // also rendered serially and the largest difference is reported
+    // (a null test); the result fails if it exceeds the tolerance.
+    RenderResult render(const juce::File& input);
+    
+    const juce::OwnedArray<OfflineRenderer>& getRenderers() const noexcept { return renderers; }
+    
+private:
+    struct Segment
+    {
+        juce::int64 start, length;
+        juce::File file;
+        RenderResult result;
+    };
+    
+    void renderSegments(const juce::File& input, std::vector<Segment>& segments, juce::int64 preRoll);
+    bool stitch(const std::vector<Segment>& segments, const juce::AudioFormatReader& source, RenderResult& result);
+    bool nullTest(const std::vector<Segment>& segments, const juce::File& serialRender, RenderResult& result);
+    
+    const RenderOptions& options;
+    double tolerance;
+    bool verify;
+    
+    // one renderer, and so one processor, per thread
+    juce::OwnedArray<OfflineRenderer> renderers;
+    
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SegmentedRenderer)
+};
@@ -0,0 +1,88 @@
+/*
+  ==============================================================================
+
+    BandParameters.cpp
+
+  ==============================================================================
+*/
+
+#include "BandParameters.h"
+
+BandParameters::BandParameters(juce::AudioProcessorValueTreeState& apvts, int numBands)
+{
+    jassert(numBands <= maxBankBands);
+
+    for (int band = 0; band < juce::jmin(numBands, maxBankBands); ++band)
+    {
+        Parameters p;
+        p.type = apvts.getRawParameterValue(getParameterID(band, "Type"));
+        p.freq = apvts.getRawParameterValue(getParameterID(band, "Freq"));
+        p.gain = apvts.getRawParameterValue(getParameterID(band, "Gain"));
+        p.quality = apvts.getRawParameterValue(getParameterID(band, "Quality"));
+        p.bypass = apvts.getRawParameterValue(getParameterID(band, "Bypass"));
+
+        // every parameter must exist in createParameterLayout()
+        jassert(p.type != nullptr && p.freq != nullptr && p.gain != nullptr
+                && p.quality != nullptr && p.bypass != nullptr);
+
+        parameters.push_back(p);
+    }
+
+    settings.resize(parameters.size());
+}
+
+juce::String BandParameters::getParameterID(int band, const juce::String& name)
+{
+    return "Band " + juce::String(band + 1) + " " + name;
+}
+
+juce::StringArray BandParameters::getTypeNames()
+{
+    return { "Bell", "Low Shelf", "High Shelf", "Notch", "Tilt", "Band Pass", "Low Cut", "High Cut" };
+}
+
+void BandParameters::addParameters(juce::AudioProcessorValueTreeState::ParameterLayout& layout, int numBands)
+{
+    // the same ranges as the peak band, spread over the spectrum so
+    // every band starts somewhere else. They all start bypassed
+    for (int band = 0; band < numBands; ++band)
+    {
+        auto defaultFreq = (float) juce::mapToLog10((band + 0.5) / numBands, 20.0, 20000.0);
+        
+        layout.add(std::make_unique<juce::AudioParameterChoice>(getParameterID(band, "Type"), getParameterID(band, "Type"), getTypeNames(), 0));
+        layout.add(std::make_unique<juce::AudioParameterFloat>(getParameterID(band, "Freq"), getParameterID(band, "Freq"), juce::NormalisableRange<float>(20.f, 20000.f, 1.f, 0.25f), std::round(defaultFreq)));
+        layout.add(std::make_unique<juce::AudioParameterFloat>(getParameterID(band, "Gain"), getParameterID(band, "Gain"), juce::NormalisableRange<float>(-24.f, 24.f, 0.5f, 1.f), 0.f));
+        layout.add(std::make_unique<juce::AudioParameterFloat>(getParameterID(band, "Quality"), getParameterID(band, "Quality"), juce::NormalisableRange<float>(0.1f, 10.f, 0.05f, 1.f), 1.f));
+        layout.add(std::make_unique<juce::AudioParameterBool>(getParameterID(band, "Bypass"), getParameterID(band, "Bypass"), true));
+    }
+}
+
+juce::uint32 BandParameters::update() noexcept
+{
+    juce::uint32 changedBands = 0;
+    auto forceAll = forceAllBands.exchange(false);
+
+    for (size_t band = 0; band < parameters.size(); ++band)
+    {
+        const auto& p = parameters[band];
+
+        BandSettings latest;
+        latest.type = static_cast<BandType>((int) p.type->load());
+        latest.freq = p.freq->load();
+        latest.gainInDecibels = p.gain->load();
+        latest.quality = p.quality->load();
+        latest.bypassed = p.bypass->load() > 0.5f;
+
+        auto& current = settings[band];
+
+        // exact comparison is intended, as in ParameterSnapshot
+        if (forceAll || latest.type != current.type || latest.freq != current.freq
+            || latest.gainInDecibels != current.gainInDecibels || latest.quality != current.quality
+            || latest.bypassed != current.bypassed)
+            changedBands |= juce::uint32 (1) << band;
+
+        current = latest;
+    }
+
+    return changedBands;
+}
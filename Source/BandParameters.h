@@ -0,0 +1,63 @@
+/*
+  ==============================================================================
+
+    BandParameters.h
+
+    The parameters of the filter bank's bands (see FilterBank.h). Every
+    band gets the same five parameters, "Band <n> Type", "Band <n> Freq",
+    "Band <n> Gain", "Band <n> Quality" and "Band <n> Bypass", generated
+    by createParameterLayout(). Like ParameterSnapshot, the raw parameter
+    pointers are looked up once and update() reports which bands moved,
+    so only those are redesigned.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "ChainSettings.h"
+
+class BandParameters
+{
+public:
+    // looks up the parameters of numBands bands by their string IDs once
+    BandParameters(juce::AudioProcessorValueTreeState& apvts, int numBands);
+
+    // "Band 3 Freq" for band 2 (bands count from 0, their names from 1)
+    static juce::String getParameterID(int band, const juce::String& name);
+
+    // the choices of the type parameter, in the order of BandType
+    static juce::StringArray getTypeNames();
+
+    // adds the parameters of numBands bands to the layout
+    static void addParameters(juce::AudioProcessorValueTreeState::ParameterLayout& layout, int numBands);
+
+    // reads the cached parameters and returns one bit per band whose
+    // values differ from the previous call (0 if no knob has moved)
+    juce::uint32 update() noexcept;
+
+    // forces the next update() to report every band as changed
+    void invalidate() noexcept { forceAllBands.store(true); }
+
+    int getNumBands() const noexcept { return (int) settings.size(); }
+
+    // settings read by the last update()
+    const BandSettings& getSettings(int band) const noexcept { return settings[(size_t) band]; }
+
+private:
+    struct Parameters
+    {
+        std::atomic<float>* type { nullptr };
+        std::atomic<float>* freq { nullptr };
+        std::atomic<float>* gain { nullptr };
+        std::atomic<float>* quality { nullptr };
+        std::atomic<float>* bypass { nullptr };
+    };
+
+    std::vector<Parameters> parameters;
+    std::vector<BandSettings> settings;
+    std::atomic<bool> forceAllBands { true };
+
+    JUCE_DECLARE_NON_COPYABLE (BandParameters)
+};
@@ -0,0 +1,93 @@
+/*
+  ==============================================================================
+
+    ChainSettings.h
+
+    Plain data describing the state of the three eq bands, shared between
+    the processor, the editor and the parameter snapshot.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+// Cut filter slope dB/oct names. Butterworth up to 96 dB/oct, then the
+// Linkwitz-Riley alignments, a butterworth of half the order run twice:
+// -6 dB at the cutoff, so a low and a high cut at the same frequency sum
+// flat, as in a crossover
+enum Slope {
+    Slope_12,
+    Slope_24,
+    Slope_36,
+    Slope_48,
+    Slope_72,
+    Slope_96,
+    Slope_LR24,
+    Slope_LR48
+};
+
+static constexpr int numSlopes = Slope_LR48 + 1;
+
+// extract params values from AudioProcessorValueTreeState using data structure
+struct ChainSettings
+{
+    float peakFreq { 0 }, peakGainInDecibles { 0 }, peakQuality { 1.f };
+    float lowCutFreq { 0 }, highCutFreq { 0 };
+    Slope lowCutSlope { Slope::Slope_12 }, highCutSlope { Slope::Slope_12 };
+};
+
+// helper function that will pass params into the data structure
+ChainSettings getChainSettings(juce::AudioProcessorValueTreeState& apvts);
+
+// how the three fixed bands treat a stereo signal
+// * Linked: every channel runs the same settings
+// * LeftRight: the left channel the main settings, the right one a second set
+// * MidSide: the mid the main settings, the side a second set
+enum class StereoMode
+{
+    Linked,
+    LeftRight,
+    MidSide
+};
+
+// the parameter IDs of the second set start with this, "Right/Side LowCut Freq"...
+static constexpr const char* rightSideParameterPrefix = "Right/Side ";
+
+// the peak band as a dynamic eq (see DynamicPeak.h). Frequency and
+// quality are the peak's own, its gain becomes the range: the most the
+// band boosts (> 0) or cuts (< 0) once the detector is far enough above
+// the threshold
+struct DynamicPeakSettings
+{
+    bool enabled { false };
+    float peakFreq { 1000.f }, peakGainInDecibles { 0 }, peakQuality { 1.f };
+    float thresholdInDecibels { -24.f }, ratio { 4.f };
+    float attackMs { 5.f }, releaseMs { 100.f };
+};
+
+DynamicPeakSettings getDynamicPeakSettings(juce::AudioProcessorValueTreeState& apvts);
+
+// the filter bank's bands (see FilterBank.h), each one biquad
+enum class BandType
+{
+    Bell,
+    LowShelf,
+    HighShelf,
+    Notch,
+    Tilt,       // a shelf that tilts by -gain / 2 below and +gain / 2 above its frequency
+    BandPass,
+    LowCut,     // 12 dB/oct, the quality shapes the knee
+    HighCut
+};
+
+// the most bands a bank can have, one bit each in a mask of changed bands
+static constexpr int maxBankBands = 32;
+
+struct BandSettings
+{
+    BandType type { BandType::Bell };
+    float freq { 1000.f }, gainInDecibels { 0 }, quality { 1.f };
+    bool bypassed { true };
+};
@@ -0,0 +1,294 @@
+/*
+  ==============================================================================
+
+    CoefficientDesigner.cpp
+
+  ==============================================================================
+*/
+
+#include "CoefficientDesigner.h"
+
+namespace
+{
+    // normalises a biquad to a0 = 1
+    BiquadCoefficients normalise(double b0, double b1, double b2, double a0, double a1, double a2) noexcept
+    {
+        auto a0inv = 1.0 / a0;
+        return { b0 * a0inv, b1 * a0inv, b2 * a0inv, a1 * a0inv, a2 * a0inv };
+    }
+    
+    // designed in double, see BiquadCoefficients, step by step as in
+    // IIR::Coefficients::makePeakFilter so both give the same filter
+    BiquadCoefficients makeBell(double frequency, double gainInDecibels, double quality, double sampleRate) noexcept
+    {
+        auto gainFactor = juce::Decibels::decibelsToGain(gainInDecibels);
+        auto A = juce::jmax(0.0, std::sqrt(gainFactor));
+        auto omega = (juce::MathConstants<double>::twoPi * juce::jmax(frequency, 2.0)) / sampleRate;
+        auto alpha = std::sin(omega) / (quality * 2.0);
+        auto c2 = -2.0 * std::cos(omega);
+        auto alphaTimesA = alpha * A;
+        auto alphaOverA = alpha / A;
+        
+        return normalise(1.0 + alphaTimesA, c2, 1.0 - alphaTimesA, 1.0 + alphaOverA, c2, 1.0 - alphaOverA);
+    }
+}
+
+CoefficientDesigner::CoefficientDesigner(juce::AudioProcessorValueTreeState& apvts, const juce::String& parameterPrefix)
+    : parameterSnapshot(apvts, parameterPrefix)
+{
+}
+
+CoefficientDesigner::~CoefficientDesigner()
+{
+    release();
+}
+
+void CoefficientDesigner::prepare(double newSampleRate)
+{
+    release();
+    
+    // building a table takes a moment, so do it before taking the lock
+    auto table = CutCoefficientTable::getFor(newSampleRate);
+    
+    {
+        const juce::ScopedLock sl(designLock);
+        sampleRate = newSampleRate;
+        cutTable = std::move(table);
+    }
+    
+    // the sample rate may have changed, so every band must be redesigned
+    parameterSnapshot.invalidate();
+    designChangedBands();
+    
+    service->addClient(this);
+}
+
+void CoefficientDesigner::release()
+{
+    service->removeClient(this);
+}
+
+void CoefficientDesigner::designChangedBands()
+{
+    const juce::ScopedLock sl(designLock);
+    
+    if (sampleRate <= 0.0)
+        return;
+    
+    auto changedBands = parameterSnapshot.update();
+    
+    if (changedBands == 0)
+        return;
+    
+    unpublishedBands |= changedBands;
+    
+    // designed right here, or straight from the cache if another
+    // instance already uses the same settings. Only the bands that
+    // moved are designed, the others are taken from the current set
+    awaitingDesign = false;
+    publish(service->getDesign({ sampleRate, parameterSnapshot.getSettings() }, current.get(), unpublishedBands));
+}
+
+bool CoefficientDesigner::pollParameters(CoefficientService::DesignRequest& request)
+{
+    const juce::ScopedLock sl(designLock);
+    
+    if (sampleRate <= 0.0)
+        return false;
+    
+    auto changedBands = parameterSnapshot.update();
+    
+    if (changedBands == 0)
+        return false;
+    
+    // a design still on its way is replaced by this one, so its bands
+    // have to be designed again too
+    unpublishedBands |= changedBands;
+    
+    request = { { sampleRate, parameterSnapshot.getSettings() }, current, unpublishedBands };
+    awaitedKey = request.key;
+    awaitingDesign = true;
+    return true;
+}
+
+void CoefficientDesigner::receive(const CoefficientService::DesignKey& key, const std::shared_ptr<const CoefficientSet>& set)
+{
+    const juce::ScopedLock sl(designLock);
+    
+    // a set for settings we have moved on from in the meantime is dropped
+    if (! awaitingDesign || ! (key == awaitedKey))
+        return;
+    
+    awaitingDesign = false;
+    publish(set);
+}
+
+void CoefficientDesigner::publish(std::shared_ptr<const CoefficientSet> set)
+{
+    // the shared set is immutable, the audio thread gets its own copy
+    current = std::move(set);
+    unpublishedBands = 0;
+    exchange.getWriteBuffer() = *current;
+    exchange.publish();
+}
+
+CoefficientSet CoefficientDesigner::getCurrentCoefficients() const
+{
+    const juce::ScopedLock sl(designLock);
+    return *current;
+}
+
+CoefficientSet CoefficientDesigner::designNow(const ChainSettings& chainSettings) const noexcept
+{
+    // no lock: only prepare() replaces the table, and never while we process
+    jassert(cutTable != nullptr);
+    return designSet(chainSettings, *cutTable);
+}
+
+//==============================================================================
+BiquadCoefficients CoefficientDesigner::toBiquad(const juce::dsp::IIR::Coefficients<double>& coefficients)
+{
+    // every filter we design is second order: b0, b1, b2, a1, a2
+    jassert(coefficients.getFilterOrder() == 2);
+    
+    auto* raw = coefficients.coefficients.begin();
+    return { raw[0], raw[1], raw[2], raw[3], raw[4] };
+}
+
+CoefficientSet CoefficientDesigner::designSet(const ChainSettings& chainSettings, const CutCoefficientTable& table) noexcept
+{
+    CoefficientSet coefficientSet;
+    designBands(coefficientSet, chainSettings, table, AllBands);
+    return coefficientSet;
+}
+
+void CoefficientDesigner::designBands(CoefficientSet& coefficientSet, const ChainSettings& chainSettings,
+                                      const CutCoefficientTable& table, int changedBands) noexcept
+{
+    coefficientSet.sampleRate = table.getSampleRate();
+    
+    if ((changedBands & LowCutBand) != 0)
+        coefficientSet.lowCut = designLowCut(chainSettings, table);
+    
+    if ((changedBands & PeakBand) != 0)
+        coefficientSet.peak = designPeak(chainSettings, table.getSampleRate());
+    
+    if ((changedBands & HighCutBand) != 0)
+        coefficientSet.highCut = designHighCut(chainSettings, table);
+}
+
+BiquadCoefficients CoefficientDesigner::designPeak(const ChainSettings& chainSettings, double sampleRate) noexcept
+{
+    // a peak at 0 dB does nothing, the engines drop identity sections
+    if (chainSettings.peakGainInDecibles == 0.f)
+        return {};
+    
+    // the quality range starts at 0, which would make every coefficient NaN
+    return makeBell(chainSettings.peakFreq, chainSettings.peakGainInDecibles,
+                    juce::jmax(0.025, (double) chainSettings.peakQuality), sampleRate);
+}
+
+BiquadCoefficients CoefficientDesigner::designDynamicPeak(const DynamicPeakSettings& settings, double gainInDecibels, double sampleRate) noexcept
+{
+    if (gainInDecibels == 0.0)
+        return {};
+    
+    // the bilinear transform of the state variable bell
+    // (s^2 + G k s + 1) / (s^2 + k s + 1), prewarped and clamped as in
+    // DynamicPeak::setSettings, not the cookbook bell of designPeak
+    auto g = std::tan(juce::MathConstants<double>::pi * juce::jmin((double) settings.peakFreq, 0.49 * sampleRate) / sampleRate);
+    auto k = 1.0 / juce::jmax(0.025, (double) settings.peakQuality);
+    auto gk = juce::Decibels::decibelsToGain(gainInDecibels, -200.0) * k * g;
+    auto g2 = g * g;
+    
+    return normalise(1.0 + gk + g2, 2.0 * (g2 - 1.0), 1.0 - gk + g2, 1.0 + k * g + g2, 2.0 * (g2 - 1.0), 1.0 - k * g + g2);
+}
+
+BiquadCoefficients CoefficientDesigner::designBand(const BandSettings& band, double sampleRate) noexcept
+{
+    auto hasGain = band.type == BandType::Bell || band.type == BandType::LowShelf
+                || band.type == BandType::HighShelf || band.type == BandType::Tilt;
+    
+    // bands that do nothing are left out by the bank, like the peak at 0 dB
+    if (band.bypassed || (hasGain && band.gainInDecibels == 0.f))
+        return {};
+    
+    auto frequency = juce::jlimit(2.0, 0.49 * sampleRate, (double) band.freq);
+    auto quality = juce::jmax(0.025, (double) band.quality);
+    
+    if (band.type == BandType::Bell)
+        return makeBell(frequency, band.gainInDecibels, quality, sampleRate);
+    
+    auto omega = juce::MathConstants<double>::twoPi * frequency / sampleRate;
+    auto cosOmega = std::cos(omega);
+    auto alpha = std::sin(omega) / (quality * 2.0);
+    
+    switch (band.type)
+    {
+        case BandType::LowShelf:
+        {
+            auto A = std::pow(10.0, band.gainInDecibels / 40.0);
+            auto beta = 2.0 * std::sqrt(A) * alpha;
+            
+            return normalise(A * ((A + 1.0) - (A - 1.0) * cosOmega + beta),
+                             2.0 * A * ((A - 1.0) - (A + 1.0) * cosOmega),
+                             A * ((A + 1.0) - (A - 1.0) * cosOmega - beta),
+                             (A + 1.0) + (A - 1.0) * cosOmega + beta,
+                             -2.0 * ((A - 1.0) + (A + 1.0) * cosOmega),
+                             (A + 1.0) + (A - 1.0) * cosOmega - beta);
+        }
+        
+        case BandType::HighShelf:
+        case BandType::Tilt:
+        {
+            auto A = std::pow(10.0, band.gainInDecibels / 40.0);
+            auto beta = 2.0 * std::sqrt(A) * alpha;
+            
+            // a tilt is the high shelf pulled down by half its gain, which
+            // is 1 / A on the numerator
+            auto scale = band.type == BandType::Tilt ? 1.0 / A : 1.0;
+            
+            return normalise(scale * A * ((A + 1.0) + (A - 1.0) * cosOmega + beta),
+                             scale * -2.0 * A * ((A - 1.0) + (A + 1.0) * cosOmega),
+                             scale * A * ((A + 1.0) + (A - 1.0) * cosOmega - beta),
+                             (A + 1.0) - (A - 1.0) * cosOmega + beta,
+                             2.0 * ((A - 1.0) - (A + 1.0) * cosOmega),
+                             (A + 1.0) - (A - 1.0) * cosOmega - beta);
+        }
+        
+        case BandType::Notch:
+            return normalise(1.0, -2.0 * cosOmega, 1.0, 1.0 + alpha, -2.0 * cosOmega, 1.0 - alpha);
+        
+        // 0 dB at the centre
+        case BandType::BandPass:
+            return normalise(alpha, 0.0, -alpha, 1.0 + alpha, -2.0 * cosOmega, 1.0 - alpha);
+        
+        case BandType::LowCut:
+            return normalise(0.5 * (1.0 + cosOmega), -(1.0 + cosOmega), 0.5 * (1.0 + cosOmega),
+                             1.0 + alpha, -2.0 * cosOmega, 1.0 - alpha);
+        
+        case BandType::HighCut:
+            return normalise(0.5 * (1.0 - cosOmega), 1.0 - cosOmega, 0.5 * (1.0 - cosOmega),
+                             1.0 + alpha, -2.0 * cosOmega, 1.0 - alpha);
+        
+        case BandType::Bell:
+        default:
+            return {};
+    }
+}
+
+CutCoefficients CoefficientDesigner::designLowCut(const ChainSettings& chainSettings, const CutCoefficientTable& table) noexcept
+{
+    // the bottom of the range means the low cut is off
+    auto cut = table.makeLowCut(chainSettings.lowCutFreq, chainSettings.lowCutSlope);
+    cut.active = chainSettings.lowCutFreq > CutCoefficientTable::minFrequency;
+    return cut;
+}
+
+CutCoefficients CoefficientDesigner::designHighCut(const ChainSettings& chainSettings, const CutCoefficientTable& table) noexcept
+{
+    // and the top of the range means the high cut is off
+    auto cut = table.makeHighCut(chainSettings.highCutFreq, chainSettings.highCutSlope);
+    cut.active = chainSettings.highCutFreq < CutCoefficientTable::maxFrequency;
+    return cut;
+}
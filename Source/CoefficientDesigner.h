@@ -0,0 +1,125 @@
+/*
+  ==============================================================================
+
+    CoefficientDesigner.h
+
+    Gets the filter coefficients of one instance designed off the audio
+    thread and publishes finished CoefficientSets to the audio thread
+    through a TripleBuffer. The audio thread only ever calls acquire(),
+    which never locks or allocates.
+
+    The polling and designing itself is done by the CoefficientService
+    shared by every instance in the process, which designs identical
+    settings only once.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "CoefficientSet.h"
+#include "CoefficientService.h"
+#include "CutCoefficientTable.h"
+#include "ParameterSnapshot.h"
+#include "TripleBuffer.h"
+
+class CoefficientDesigner
+{
+public:
+    // the prefix picks the parameters of the second set, see ParameterSnapshot
+    explicit CoefficientDesigner(juce::AudioProcessorValueTreeState& apvts, const juce::String& parameterPrefix = {});
+    ~CoefficientDesigner();
+
+    // designs every band for the new sample rate, publishes the result
+    // and registers with the service. Not real-time safe.
+    void prepare(double sampleRate);
+
+    // stops the service from polling our parameters
+    void release();
+
+    // if any parameter changed, gets the set for the new settings and
+    // publishes it. The service polls for changes on its own, this is for
+    // the message thread (e.g. after restoring state) to get the new
+    // coefficients out without waiting for the next poll.
+    void designChangedBands();
+
+    // a copy of the last designed set, for analysis on non real-time threads
+    CoefficientSet getCurrentCoefficients() const;
+    
+    // audio thread: the newest CoefficientSet, or nullptr if nothing changed
+    const CoefficientSet* acquire() noexcept { return exchange.acquire(); }
+
+    // audio thread: designs a set right away, for parameter changes that
+    // have to land on an exact sample. Only valid after prepare(), which
+    // never runs at the same time as the audio thread
+    CoefficientSet designNow(const ChainSettings& chainSettings) const noexcept;
+
+    //==============================================================================
+    // the design functions themselves. They neither lock nor allocate, so
+    // they can run on any thread including the audio thread.
+    // Bands that do nothing (a peak at 0 dB, a cut at the edge of its
+    // range) come out as identity sections or inactive cuts
+    static CoefficientSet designSet(const ChainSettings& chainSettings, const CutCoefficientTable& table) noexcept;
+    
+    // redesigns only the bands in changedBands (see BandFlags) of a set
+    // of the table's sample rate and keeps the others
+    static void designBands(CoefficientSet& coefficientSet, const ChainSettings& chainSettings,
+                            const CutCoefficientTable& table, int changedBands) noexcept;
+    
+    // the same RBJ peak as IIR::Coefficients::makePeakFilter, without
+    // allocating the coefficient object
+    static BiquadCoefficients designPeak(const ChainSettings& chainSettings, double sampleRate) noexcept;
+    
+    // the biquad the dynamic peak (see DynamicPeak.h) is equivalent to
+    // while its gain sits at gainInDecibels, e.g. to draw it
+    static BiquadCoefficients designDynamicPeak(const DynamicPeakSettings& settings, double gainInDecibels, double sampleRate) noexcept;
+    
+    // one band of the filter bank, RBJ cookbook biquads. A bypassed band,
+    // or a bell, shelf or tilt at 0 dB, comes out as an identity section
+    static BiquadCoefficients designBand(const BandSettings& band, double sampleRate) noexcept;
+    
+    // the cuts are looked up in the table shared by every instance at this
+    // sample rate, see CutCoefficientTable.h
+    static CutCoefficients designLowCut(const ChainSettings& chainSettings, const CutCoefficientTable& table) noexcept;
+    static CutCoefficients designHighCut(const ChainSettings& chainSettings, const CutCoefficientTable& table) noexcept;
+
+    // converts a juce biquad into our plain representation
+    static BiquadCoefficients toBiquad(const juce::dsp::IIR::Coefficients<double>& coefficients);
+
+private:
+    friend class CoefficientService;
+
+    // service thread: reads the parameters, and if they moved, returns
+    // the settings we now wait for and the bands that changed
+    bool pollParameters(CoefficientService::DesignRequest& request);
+
+    // service threads: a designed set, published if it is the one we wait for
+    void receive(const CoefficientService::DesignKey& key, const std::shared_ptr<const CoefficientSet>& set);
+
+    void publish(std::shared_ptr<const CoefficientSet> set);
+
+    std::shared_ptr<CoefficientService> service { CoefficientService::getInstance() };
+
+    ParameterSnapshot parameterSnapshot;
+
+    // the producer side of the exchange is shared between the service
+    // threads and the message thread, so it is guarded by this lock.
+    // The audio thread never touches it.
+    mutable juce::CriticalSection designLock;
+    std::shared_ptr<const CoefficientSet> current { std::make_shared<const CoefficientSet>() };
+    
+    // the bands whose settings moved since current was designed, also
+    // those of a design that is still on its way
+    int unpublishedBands { AllBands };
+    CoefficientService::DesignKey awaitedKey;
+    bool awaitingDesign { false };
+    double sampleRate { 0.0 };
+
+    // keeps the shared table of our sample rate alive for the service
+    std::shared_ptr<const CutCoefficientTable> cutTable;
+
+    TripleBuffer<CoefficientSet> exchange;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (CoefficientDesigner)
+};
@@ -0,0 +1,203 @@
+/*
+  ==============================================================================
+
+    CoefficientService.cpp
+
+  ==============================================================================
+*/
+
+#include "CoefficientService.h"
+#include "CoefficientDesigner.h"
+
+namespace
+{
+    // a design takes microseconds, a few workers are plenty even for
+    // hundreds of instances changing sample rate at once
+    int getNumWorkersToUse()
+    {
+        return juce::jlimit(1, 4, juce::SystemStats::getNumCpus() / 2);
+    }
+}
+
+std::shared_ptr<CoefficientService> CoefficientService::getInstance()
+{
+    static juce::CriticalSection instanceLock;
+    static std::weak_ptr<CoefficientService> instance;
+
+    const juce::ScopedLock sl(instanceLock);
+
+    if (auto existing = instance.lock())
+        return existing;
+
+    auto service = std::make_shared<CoefficientService>();
+    instance = service;
+    return service;
+}
+
+CoefficientService::CoefficientService()
+    : juce::Thread("SimpleEQ coefficient service"),
+      numWorkers(getNumWorkersToUse()),
+      workers(numWorkers)
+{
+    startThread();
+}
+
+CoefficientService::~CoefficientService()
+{
+    stopThread(1000);
+    workers.removeAllJobs(false, 1000);
+}
+
+bool CoefficientService::DesignKey::operator< (const DesignKey& other) const noexcept
+{
+    const auto& a = settings;
+    const auto& b = other.settings;
+
+    return std::tie(sampleRate, a.lowCutFreq, a.lowCutSlope, a.peakFreq, a.peakGainInDecibles, a.peakQuality, a.highCutFreq, a.highCutSlope)
+         < std::tie(other.sampleRate, b.lowCutFreq, b.lowCutSlope, b.peakFreq, b.peakGainInDecibles, b.peakQuality, b.highCutFreq, b.highCutSlope);
+}
+
+//==============================================================================
+std::shared_ptr<const CoefficientSet> CoefficientService::findCached(const DesignKey& key)
+{
+    const juce::ScopedLock sl(cacheLock);
+
+    auto entry = cache.find(key);
+
+    if (entry == cache.end())
+        return {};
+
+    auto set = entry->second.lock();
+
+    if (set != nullptr)
+        ++numCacheHits;
+
+    return set;
+}
+
+std::shared_ptr<const CoefficientSet> CoefficientService::getDesign(const DesignKey& key, const CoefficientSet* base,
+                                                                   int changedBands)
+{
+    if (auto cached = findCached(key))
+        return cached;
+
+    // designed outside the lock; the cut table is shared per sample rate
+    // and stays alive as long as a designer running at that rate holds it
+    auto cutTable = CutCoefficientTable::getFor(key.sampleRate);
+
+    // the bands that did not move are the base's, which was designed for
+    // the same band settings, so the result equals a full design
+    auto designed = std::make_shared<CoefficientSet>();
+
+    if (base != nullptr && base->sampleRate == key.sampleRate)
+    {
+        *designed = *base;
+        CoefficientDesigner::designBands(*designed, key.settings, *cutTable, changedBands);
+    }
+    else
+    {
+        *designed = CoefficientDesigner::designSet(key.settings, *cutTable);
+    }
+
+    ++numDesigns;
+
+    const juce::ScopedLock sl(cacheLock);
+    auto& entry = cache[key];
+
+    // another thread may have designed the same set in the meantime
+    if (auto existing = entry.lock())
+        return existing;
+
+    std::shared_ptr<const CoefficientSet> set = std::move(designed);
+    entry = set;
+
+    // forget the sets nobody uses any more once the cache has doubled
+    if (cache.size() >= pruneSize)
+    {
+        for (auto it = cache.begin(); it != cache.end();)
+            it = it->second.expired() ? cache.erase(it) : std::next(it);
+
+        pruneSize = juce::jmax((size_t) 64, cache.size() * 2);
+    }
+
+    return set;
+}
+
+int CoefficientService::getNumCachedSets() const
+{
+    const juce::ScopedLock sl(cacheLock);
+
+    return (int) std::count_if(cache.begin(), cache.end(), [](const auto& entry) { return ! entry.second.expired(); });
+}
+
+//==============================================================================
+void CoefficientService::addClient(CoefficientDesigner* client)
+{
+    const juce::ScopedLock sl(clientsLock);
+    clients.addIfNotAlreadyThere(client);
+}
+
+void CoefficientService::removeClient(CoefficientDesigner* client)
+{
+    const juce::ScopedLock sl(clientsLock);
+    clients.removeFirstMatchingValue(client);
+}
+
+void CoefficientService::run()
+{
+    while (! threadShouldExit())
+    {
+        {
+            const juce::ScopedLock sl(clientsLock);
+
+            for (auto* client : clients)
+            {
+                DesignRequest request;
+
+                if (! client->pollParameters(request))
+                    continue;
+
+                // identical settings are usually cached already
+                if (auto set = findCached(request.key))
+                    client->receive(request.key, set);
+                else
+                    scheduleDesign(request);
+            }
+        }
+
+        wait(pollIntervalMs);
+    }
+}
+
+void CoefficientService::scheduleDesign(const DesignRequest& request)
+{
+    {
+        // every client waiting for the same set shares one job, whichever
+        // base it starts from the result is the same
+        const juce::ScopedLock sl(cacheLock);
+
+        if (! designsInFlight.insert(request.key).second)
+            return;
+    }
+
+    workers.addJob([this, request]
+    {
+        auto set = getDesign(request.key, request.base.get(), request.changedBands);
+
+        {
+            const juce::ScopedLock sl(cacheLock);
+            designsInFlight.erase(request.key);
+        }
+
+        deliver(request.key, set);
+    });
+}
+
+void CoefficientService::deliver(const DesignKey& key, const std::shared_ptr<const CoefficientSet>& set)
+{
+    // clients that moved on to other settings in the meantime ignore it
+    const juce::ScopedLock sl(clientsLock);
+
+    for (auto* client : clients)
+        client->receive(key, set);
+}
@@ -0,0 +1,106 @@
+/*
+  ==============================================================================
+
+    CoefficientService.h
+
+    One coefficient design service for every eq instance in the process.
+    Templates load hundreds of instances, and many of them share their
+    settings, so instead of each instance polling its parameters on its
+    own thread and designing its own coefficients:
+
+    - one thread polls the parameters of every registered
+      CoefficientDesigner,
+    - designs are cached by (sample rate, ChainSettings) and handed out as
+      immutable shared CoefficientSets, so identical instances share one
+      set and it is designed once,
+    - the sets that are not cached yet are designed on a small pool of
+      worker threads, so a session load or a sample rate change across
+      many instances is spread over a few cores.
+
+    The service lives as long as any instance holds it, and a cached set
+    lives as long as any instance uses it.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "CoefficientSet.h"
+#include "ParameterSnapshot.h"
+
+class CoefficientDesigner;
+
+class CoefficientService : private juce::Thread
+{
+public:
+    // the instance shared by the whole process, created on first use
+    static std::shared_ptr<CoefficientService> getInstance();
+
+    CoefficientService();
+    ~CoefficientService() override;
+
+    // what a design depends on
+    struct DesignKey
+    {
+        double sampleRate { 0.0 };
+        ChainSettings settings;
+
+        bool operator< (const DesignKey& other) const noexcept;
+        bool operator== (const DesignKey& other) const noexcept { return ! (*this < other) && ! (other < *this); }
+    };
+
+    // what a designer asks for: the settings, and the set it runs now with
+    // the BandFlags of the bands whose settings differ from it
+    struct DesignRequest
+    {
+        DesignKey key;
+        std::shared_ptr<const CoefficientSet> base;
+        int changedBands { AllBands };
+    };
+
+    // the set for these settings, designed on the calling thread if it is
+    // not cached yet. With a base set of the same sample rate only the
+    // changed bands are designed, the others are copied from it.
+    // Not real-time safe
+    std::shared_ptr<const CoefficientSet> getDesign(const DesignKey& key, const CoefficientSet* base = nullptr,
+                                                    int changedBands = AllBands);
+
+    // designers are polled for parameter changes while they are registered.
+    // removeClient() returns once the service no longer touches the client
+    void addClient(CoefficientDesigner* client);
+    void removeClient(CoefficientDesigner* client);
+
+    // how often the parameters of every client are polled
+    static constexpr int pollIntervalMs = 5;
+
+    int getNumWorkers() const noexcept { return numWorkers; }
+    int getNumCachedSets() const;
+    juce::int64 getNumDesigns() const noexcept { return numDesigns.load(); }
+    juce::int64 getNumCacheHits() const noexcept { return numCacheHits.load(); }
+
+private:
+    void run() override;
+
+    std::shared_ptr<const CoefficientSet> findCached(const DesignKey& key);
+    void scheduleDesign(const DesignRequest& request);
+    void deliver(const DesignKey& key, const std::shared_ptr<const CoefficientSet>& set);
+
+    // lock order: clientsLock, then a client's own lock, then cacheLock
+    juce::CriticalSection clientsLock;
+    juce::Array<CoefficientDesigner*> clients;
+
+    mutable juce::CriticalSection cacheLock;
+    std::map<DesignKey, std::weak_ptr<const CoefficientSet>> cache;
+    std::set<DesignKey> designsInFlight;
+    size_t pruneSize { 64 };
+
+    std::atomic<juce::int64> numDesigns { 0 }, numCacheHits { 0 };
+
+    const int numWorkers;
+
+    // declared last so its jobs are finished before anything else goes
+    juce::ThreadPool workers;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (CoefficientService)
+};
@@ -0,0 +1,75 @@
+/*
+  ==============================================================================
+
+    CoefficientSet.cpp
+
+  ==============================================================================
+*/
+
+#include "CoefficientSet.h"
+
+double BiquadCoefficients::getPoleRadius() const noexcept
+{
+    // the poles are the roots of z^2 + a1 z + a2
+    auto discriminant = a1 * a1 - 4.0 * a2;
+    
+    // complex pair: both poles have the magnitude sqrt(a2)
+    if (discriminant < 0.0)
+        return std::sqrt(a2);
+    
+    auto root = std::sqrt(discriminant);
+    return juce::jmax(std::abs((-a1 + root) * 0.5), std::abs((-a1 - root) * 0.5));
+}
+
+int CoefficientSet::getDecayLengthInSamples(double tolerance) const noexcept
+{
+    std::array<double, 2 * maxCutSections + 1> radii;
+    int numSections = 0;
+    
+    radii[(size_t) numSections++] = peak.getPoleRadius();
+    
+    for (const auto* cut : { &lowCut, &highCut })
+        for (int i = 0; i < cut->getNumSections(); ++i)
+            radii[(size_t) numSections++] = cut->sections[(size_t) i].getPoleRadius();
+    
+    return ::getDecayLengthInSamples(radii.data(), numSections, tolerance);
+}
+
+int getDecayLengthInSamples(const double* radii, int numSections, double tolerance) noexcept
+{
+    jassert(tolerance > 0.0 && tolerance < 1.0);
+    
+    // nothing to ring
+    if (numSections <= 0)
+        return 0;
+    
+    auto slowestRadius = *std::max_element(radii, radii + numSections);
+    
+    // an unstable or marginally stable cascade never decays
+    if (slowestRadius >= 1.0)
+        return std::numeric_limits<int>::max();
+    
+    // only zeros left, the response ends after the FIR part
+    if (slowestRadius <= 0.0)
+        return 2 * numSections;
+    
+    // sections that decay at least twice as fast (in dB) as the slowest one
+    // are gone long before it, only the others pile up on the slowest pole
+    int numSlowSections = 0;
+    for (int i = 0; i < numSections; ++i)
+        if (radii[i] >= slowestRadius * slowestRadius)
+            ++numSlowSections;
+    
+    // m cascaded sections sharing a pole of radius r respond with about
+    // n^(m - 1) / (m - 1)! * r^n, so solve
+    // n log(r) + (m - 1) log(n) - log((m - 1)!) = log(tolerance) by iterating on n
+    auto m = numSlowSections;
+    auto logRadius = std::log(slowestRadius);
+    auto logTolerance = std::log(tolerance) + std::lgamma((double) m);
+    auto n = logTolerance / logRadius;
+    
+    for (int i = 0; i < 8; ++i)
+        n = (logTolerance - (m - 1) * std::log(juce::jmax(1.0, n))) / logRadius;
+    
+    return (int) juce::jmin(std::ceil(n), (double) std::numeric_limits<int>::max());
+}
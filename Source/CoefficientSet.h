@@ -0,0 +1,86 @@
+/*
+  ==============================================================================
+
+    CoefficientSet.h
+
+    Plain, allocation-free storage for every filter coefficient the eq needs.
+    A CoefficientSet is designed off the audio thread and then copied into
+    the filters that are already allocated, so the audio thread never has to
+    create reference counted juce::dsp::IIR::Coefficients.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "ChainSettings.h"
+
+// normalised biquad coefficients (a0 == 1), stored in the same order as
+// juce::dsp::IIR::Coefficients: b0, b1, b2, a1, a2.
+// They are designed in double precision; float filters round them when
+// they load them, double filters keep every bit (a 20 Hz low cut at
+// 192 kHz has poles so close to z = 1 that float loses most of it)
+struct BiquadCoefficients
+{
+    double b0 { 1.0 }, b1 { 0.0 }, b2 { 0.0 }, a1 { 0.0 }, a2 { 0.0 };
+    
+    // a section that passes the signal through unchanged (the default),
+    // the engines leave it out instead of running it
+    bool isIdentity() const noexcept { return b0 == 1.0 && b1 == 0.0 && b2 == 0.0 && a1 == 0.0 && a2 == 0.0; }
+    
+    // magnitude of the slowest pole, the closer to 1 the longer it rings
+    double getPoleRadius() const noexcept;
+};
+
+// the cut filters chain up to 8 biquads: a butterworth needs one per
+// 12 dB/oct, a linkwitz-riley twice the ones of its butterworth
+static constexpr int maxCutSections = 8;
+
+// number of biquads a slope chains
+constexpr int getNumCutSections(Slope slope) noexcept
+{
+    switch (slope)
+    {
+        case Slope_12:   return 1;
+        case Slope_24:   return 2;
+        case Slope_36:   return 3;
+        case Slope_48:   return 4;
+        case Slope_72:   return 6;
+        case Slope_96:   return 8;
+        case Slope_LR24: return 2;
+        case Slope_LR48: return 4;
+    }
+
+    return 1;
+}
+
+struct CutCoefficients
+{
+    std::array<BiquadCoefficients, maxCutSections> sections;
+    Slope slope { Slope::Slope_12 };
+    
+    // false when the cut sits at the edge of its range, which means "off",
+    // and none of its sections run
+    bool active { true };
+
+    // number of biquads that are actually in use for this slope
+    int getNumSections() const noexcept { return active ? getNumCutSections(slope) : 0; }
+};
+
+// everything needed by one mono chain (LowCut -> Peak -> HighCut)
+struct CoefficientSet
+{
+    CutCoefficients lowCut, highCut;
+    BiquadCoefficients peak;
+    double sampleRate { 0.0 };
+    
+    // number of samples after which the impulse response of the whole
+    // cascade has decayed below tolerance (relative to the impulse),
+    // estimated from its slowest pole
+    int getDecayLengthInSamples(double tolerance) const noexcept;
+};
+
+// the same estimate for any cascade, given the pole radius of each of its
+// sections (see BiquadCoefficients::getPoleRadius)
+int getDecayLengthInSamples(const double* poleRadii, int numSections, double tolerance) noexcept;
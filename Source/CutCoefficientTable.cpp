@@ -0,0 +1,159 @@
+/*
+  ==============================================================================
+
+    CutCoefficientTable.cpp
+
+  ==============================================================================
+*/
+
+#include "CutCoefficientTable.h"
+
+namespace
+{
+    // one table per sample rate in use. We only keep weak references, so a
+    // table goes away once the last instance using it is gone.
+    struct TableRegistry
+    {
+        juce::CriticalSection lock;
+        std::map<double, std::weak_ptr<const CutCoefficientTable>> tables;
+    };
+
+    TableRegistry& getRegistry()
+    {
+        static TableRegistry registry;
+        return registry;
+    }
+
+    // Q of every section of every slope, computed the same way as
+    // FilterDesign::designIIR...HighOrderButterworthMethod does and
+    // sorted highest first (see CutCoefficientTable.h)
+    const std::array<std::array<double, maxCutSections>, numSlopes>& getSectionQs()
+    {
+        static const auto qs = []
+        {
+            std::array<std::array<double, maxCutSections>, numSlopes> result {};
+
+            for (int slope = 0; slope < numSlopes; ++slope)
+            {
+                auto numSections = getNumCutSections(static_cast<Slope>(slope));
+
+                // a linkwitz-riley is the butterworth of half its order, squared
+                auto isLinkwitzRiley = slope == Slope_LR24 || slope == Slope_LR48;
+                auto order = isLinkwitzRiley ? numSections : 2 * numSections;
+                auto& sectionQs = result[(size_t) slope];
+
+                for (int i = 0; i < numSections; ++i)
+                {
+                    auto pole = isLinkwitzRiley ? i / 2 : i;
+                    sectionQs[(size_t) i] = 1.0 / (2.0 * std::cos((2.0 * pole + 1.0) * juce::MathConstants<double>::pi / (order * 2.0)));
+                }
+
+                std::sort(sectionQs.begin(), sectionQs.begin() + numSections, std::greater<double>());
+            }
+
+            return result;
+        }();
+
+        return qs;
+    }
+}
+
+std::shared_ptr<const CutCoefficientTable> CutCoefficientTable::getFor(double sampleRate)
+{
+    auto& registry = getRegistry();
+    const juce::ScopedLock sl(registry.lock);
+
+    auto& entry = registry.tables[sampleRate];
+
+    if (auto existing = entry.lock())
+        return existing;
+
+    auto table = std::make_shared<const CutCoefficientTable>(sampleRate);
+    entry = table;
+    return table;
+}
+
+CutCoefficientTable::CutCoefficientTable(double newSampleRate)
+    : sampleRate(newSampleRate)
+{
+    jassert(sampleRate > 0);
+
+    auto numSteps = (size_t) (maxFrequency - minFrequency) + 1;
+    prewarped.resize(numSteps);
+
+    for (size_t i = 0; i < numSteps; ++i)
+        prewarped[i] = computePrewarped(minFrequency + (double) i);
+}
+
+double CutCoefficientTable::computePrewarped(double frequency) const noexcept
+{
+    // frequencies at or above nyquist would flip the sign of tan(),
+    // which happens at the top of the range for sample rates below 40 kHz
+    auto limited = juce::jmin(frequency, 0.49 * sampleRate);
+
+    // same arithmetic as IIR::Coefficients<double>::makeHighPass
+    return std::tan(juce::MathConstants<double>::pi * limited / sampleRate);
+}
+
+double CutCoefficientTable::getPrewarped(double frequency) const noexcept
+{
+    auto position = frequency - minFrequency;
+
+    // outside of the parameter range, e.g. a peak or a smoother overshooting
+    if (position < 0.0 || position >= (double) (prewarped.size() - 1))
+        return computePrewarped(juce::jlimit(1.0, (double) maxFrequency, frequency));
+
+    auto index = (size_t) position;
+    auto fraction = position - (double) index;
+
+    if (fraction == 0.0)
+        return prewarped[index];
+
+    return prewarped[index] + fraction * (prewarped[index + 1] - prewarped[index]);
+}
+
+double CutCoefficientTable::getSectionQ(Slope slope, int section) noexcept
+{
+    jassert(juce::isPositiveAndBelow(section, getNumCutSections(slope)));
+    return getSectionQs()[(size_t) slope][(size_t) section];
+}
+
+CutCoefficients CutCoefficientTable::makeLowCut(float frequency, Slope slope) const noexcept
+{
+    // butterworth highpass sections, see IIR::Coefficients::makeHighPass
+    auto n = getPrewarped(frequency);
+    auto nSquared = n * n;
+
+    CutCoefficients cut;
+    cut.slope = slope;
+
+    for (int i = 0; i < cut.getNumSections(); ++i)
+    {
+        auto invQ = 1.0 / getSectionQ(slope, i);
+        auto c1 = 1.0 / (1.0 + invQ * n + nSquared);
+
+        cut.sections[(size_t) i] = { c1, c1 * -2.0, c1, c1 * 2.0 * (nSquared - 1.0), c1 * (1.0 - invQ * n + nSquared) };
+    }
+
+    return cut;
+}
+
+CutCoefficients CutCoefficientTable::makeHighCut(float frequency, Slope slope) const noexcept
+{
+    // butterworth lowpass sections, see IIR::Coefficients::makeLowPass
+    auto n = 1.0 / getPrewarped(frequency);
+    auto nSquared = n * n;
+
+    CutCoefficients cut;
+    cut.slope = slope;
+
+    for (int i = 0; i < cut.getNumSections(); ++i)
+    {
+        auto invQ = 1.0 / getSectionQ(slope, i);
+        auto c1 = 1.0 / (1.0 + invQ * n + nSquared);
+
+        cut.sections[(size_t) i] = { c1, c1 * 2.0, c1, c1 * 2.0 * (1.0 - nSquared), c1 * (1.0 - invQ * n + nSquared) };
+    }
+
+    return cut;
+}
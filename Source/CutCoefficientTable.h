@@ -0,0 +1,69 @@
+/*
+  ==============================================================================
+
+    CutCoefficientTable.h
+
+    "LowCut Freq" and "HighCut Freq" move in 1 Hz steps between 20 Hz and
+    20 kHz, so for a given sample rate there are only 19981 different
+    cutoffs. The only expensive part of a butterworth design is the
+    prewarped tan(pi * f / fs), so we compute it once per step and share
+    the table between every instance running at that sample rate.
+
+    Turning a table entry into the biquads of a slope then costs a few
+    multiplies and a division per section, with no trigonometry and no
+    allocation, and the sections are the same as the double version of
+    juce::dsp::FilterDesign::designIIRHighpass/LowpassHighOrderButterworthMethod
+    (twice over for the linkwitz-riley slopes).
+
+    Every section pairs one pole pair with a double zero at DC (low cut)
+    or nyquist (high cut) and has unity gain in its pass band, so the
+    only choice left is their order. They run with the highest Q first:
+    the rounding noise a section adds is shaped by every section after
+    it, and a resonant section last would lift the noise of all the
+    others around the cutoff. In float, a 96 dB/oct low cut at 30 Hz
+    comes out about 5 to 15 dB closer to the double precision result than in
+    the opposite order, and never further. The price is up to 17 dB more
+    level between the sections, which floating point does not mind.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "CoefficientSet.h"
+
+class CutCoefficientTable
+{
+public:
+    // the table shared by every instance running at this sample rate,
+    // created the first time it is asked for. Not real-time safe, call it
+    // from prepareToPlay and keep the pointer.
+    static std::shared_ptr<const CutCoefficientTable> getFor(double sampleRate);
+
+    explicit CutCoefficientTable(double sampleRate);
+
+    double getSampleRate() const noexcept { return sampleRate; }
+
+    // tan(pi * f / fs); exact on the 1 Hz parameter grid and linearly
+    // interpolated in between (e.g. while a smoother ramps)
+    double getPrewarped(double frequency) const noexcept;
+
+    // Q of the n-th biquad of a cut with the given slope, highest first
+    static double getSectionQ(Slope slope, int section) noexcept;
+
+    // constant time, allocation free butterworth and linkwitz-riley designs
+    CutCoefficients makeLowCut(float frequency, Slope slope) const noexcept;
+    CutCoefficients makeHighCut(float frequency, Slope slope) const noexcept;
+
+    static constexpr float minFrequency = 20.f;
+    static constexpr float maxFrequency = 20000.f;
+
+private:
+    double computePrewarped(double frequency) const noexcept;
+
+    double sampleRate;
+    std::vector<double> prewarped;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (CutCoefficientTable)
+};
@@ -0,0 +1,231 @@
+/*
+  ==============================================================================
+
+    DynamicPeak.h
+
+    The peak band as a dynamic eq: its gain follows an envelope detector
+    listening to the band's own input or to the sidechain bus.
+
+    Redesigning the biquad of the peak (a tan, a sin, a cos, a pow and a
+    division) on every sample would cost many times the filter itself.
+    Instead the band is a TPT state variable bell (see SvfCascade.h) with
+    a fixed damping k = 1 / Q, whose output is
+
+        y = x + (G - 1) * k * bandpass
+
+    so the gain G only scales the bandpass output: following the detector
+    costs one multiply-add per sample and the solver coefficients never
+    change while the gain moves. The bandpass that is there anyway also
+    feeds the detector, only a sidechain needs filters of its own.
+
+    The gain computer (a log and a pow) runs once every controlInterval
+    samples and the gain is ramped linearly in between. Budget: a dynamic
+    band may cost at most maxCostRatio times the static biquad peak,
+    checked by the benchmarks.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "ChainSettings.h"
+
+template <typename SampleType>
+class DynamicPeak
+{
+public:
+    // samples between two runs of the gain computer
+    static constexpr int controlInterval = 16;
+
+    // what a dynamic band may cost compared to the static peak
+    static constexpr double maxCostRatio = 2.0;
+
+    // allocates the filter state, not real-time safe
+    void prepare(double sampleRateToUse, int numChannelsToUse, int numSidechainChannelsToUse)
+    {
+        sampleRate = sampleRateToUse;
+        numChannels = juce::jmax(1, numChannelsToUse);
+        numSidechainChannels = juce::jmax(0, numSidechainChannelsToUse);
+
+        state1.assign((size_t) numChannels, SampleType(0));
+        state2.assign((size_t) numChannels, SampleType(0));
+        sidechainState1.assign((size_t) numSidechainChannels, SampleType(0));
+        sidechainState2.assign((size_t) numSidechainChannels, SampleType(0));
+
+        designed = false;
+        reset();
+    }
+
+    void reset() noexcept
+    {
+        std::fill(state1.begin(), state1.end(), SampleType(0));
+        std::fill(state2.begin(), state2.end(), SampleType(0));
+        std::fill(sidechainState1.begin(), sidechainState1.end(), SampleType(0));
+        std::fill(sidechainState2.begin(), sidechainState2.end(), SampleType(0));
+
+        envelope = SampleType(0);
+        gainMinusOne = gainStep = SampleType(0);
+        samplesUntilUpdate = 0;
+        currentGain.store(0.f);
+    }
+
+    // only redesigns what the new settings change
+    void setSettings(const DynamicPeakSettings& newSettings) noexcept
+    {
+        if (! designed || newSettings.peakFreq != designedSettings.peakFreq || newSettings.peakQuality != designedSettings.peakQuality)
+        {
+            // the peak quality range starts at 0, which would mean k = inf
+            auto g = std::tan(juce::MathConstants<double>::pi * juce::jmin((double) newSettings.peakFreq, 0.49 * sampleRate) / sampleRate);
+            auto k = 1.0 / juce::jmax(0.025, (double) newSettings.peakQuality);
+
+            a1 = static_cast<SampleType>(1.0 / (1.0 + g * (g + k)));
+            a2 = static_cast<SampleType>(g) * a1;
+            a3 = static_cast<SampleType>(g) * a2;
+            damping = static_cast<SampleType>(k);
+        }
+
+        if (! designed || newSettings.attackMs != designedSettings.attackMs || newSettings.releaseMs != designedSettings.releaseMs)
+        {
+            attack = static_cast<SampleType>(std::exp(-1.0 / (juce::jmax(0.01, (double) newSettings.attackMs) * 0.001 * sampleRate)));
+            release = static_cast<SampleType>(std::exp(-1.0 / (juce::jmax(0.01, (double) newSettings.releaseMs) * 0.001 * sampleRate)));
+        }
+
+        designedSettings = newSettings;
+        designed = true;
+    }
+
+    // filters the block in place. The detector listens to the sidechain
+    // if one is given, otherwise to the band itself; either way all
+    // channels are linked and share one gain
+    void process(juce::dsp::AudioBlock<SampleType>& block, const juce::dsp::AudioBlock<SampleType>* sidechain) noexcept
+    {
+        auto channelsToProcess = juce::jmin((int) block.getNumChannels(), numChannels);
+        auto sidechainChannels = sidechain != nullptr ? juce::jmin((int) sidechain->getNumChannels(), numSidechainChannels) : 0;
+        auto numSamples = block.getNumSamples();
+        size_t position = 0;
+
+        // the control grid carries on across blocks
+        while (position < numSamples)
+        {
+            if (samplesUntilUpdate == 0)
+            {
+                updateGain();
+                samplesUntilUpdate = controlInterval;
+            }
+
+            auto chunk = juce::jmin((size_t) samplesUntilUpdate, numSamples - position);
+            std::array<SampleType, controlInterval> detector {};
+
+            for (int channel = 0; channel < channelsToProcess; ++channel)
+                processBell(block.getChannelPointer((size_t) channel) + position, chunk, (size_t) channel,
+                            sidechainChannels == 0 ? detector.data() : nullptr);
+
+            for (int channel = 0; channel < sidechainChannels; ++channel)
+                detectSidechain(sidechain->getChannelPointer((size_t) channel) + position, chunk, (size_t) channel, detector.data());
+
+            gainMinusOne += gainStep * static_cast<SampleType>(chunk);
+
+            // peak envelope of the normalised bandpass, i.e. the level in the band
+            for (size_t i = 0; i < chunk; ++i)
+                envelope = detector[i] + (detector[i] > envelope ? attack : release) * (envelope - detector[i]);
+
+            juce::dsp::util::snapToZero(envelope);
+
+            position += chunk;
+            samplesUntilUpdate -= (int) chunk;
+        }
+    }
+
+    // the gain of the band right now, e.g. for a meter
+    float getGainInDecibels() const noexcept { return currentGain.load(); }
+
+private:
+    // the gain computer: above the threshold the band moves by
+    // (1 - 1 / ratio) dB per dB, up to its range
+    void updateGain() noexcept
+    {
+        const auto& s = designedSettings;
+
+        auto level = juce::Decibels::gainToDecibels((double) envelope, -120.0);
+        auto amount = juce::jmax(0.0, level - (double) s.thresholdInDecibels) * (1.0 - 1.0 / juce::jmax(1.0, (double) s.ratio));
+        auto range = (double) s.peakGainInDecibles;
+        auto gain = range >= 0.0 ? juce::jmin(range, amount) : juce::jmax(range, -amount);
+
+        auto target = static_cast<SampleType>(juce::Decibels::decibelsToGain(gain, -200.0) - 1.0);
+        gainStep = (target - gainMinusOne) / static_cast<SampleType>(controlInterval);
+        currentGain.store((float) gain);
+    }
+
+    // one channel of the bell, with the gain ramping over the chunk
+    void processBell(SampleType* samples, size_t numSamples, size_t channel, SampleType* detector) noexcept
+    {
+        auto ic1eq = state1[channel];
+        auto ic2eq = state2[channel];
+        auto gain = gainMinusOne;
+
+        for (size_t i = 0; i < numSamples; ++i)
+        {
+            auto x = samples[i];
+            auto v3 = x - ic2eq;
+            auto v1 = a1 * ic1eq + a2 * v3;
+            auto v2 = ic2eq + a2 * ic1eq + a3 * v3;
+            ic1eq = SampleType(2) * v1 - ic1eq;
+            ic2eq = SampleType(2) * v2 - ic2eq;
+
+            // the bandpass scaled to unity gain at the centre
+            auto band = damping * v1;
+            samples[i] = x + gain * band;
+            gain += gainStep;
+
+            if (detector != nullptr)
+                detector[i] = juce::jmax(detector[i], std::abs(band));
+        }
+
+        juce::dsp::util::snapToZero(ic1eq);
+        juce::dsp::util::snapToZero(ic2eq);
+        state1[channel] = ic1eq;
+        state2[channel] = ic2eq;
+    }
+
+    // the same bandpass on a sidechain channel, only for the detector
+    void detectSidechain(const SampleType* samples, size_t numSamples, size_t channel, SampleType* detector) noexcept
+    {
+        auto ic1eq = sidechainState1[channel];
+        auto ic2eq = sidechainState2[channel];
+
+        for (size_t i = 0; i < numSamples; ++i)
+        {
+            auto v3 = samples[i] - ic2eq;
+            auto v1 = a1 * ic1eq + a2 * v3;
+            auto v2 = ic2eq + a2 * ic1eq + a3 * v3;
+            ic1eq = SampleType(2) * v1 - ic1eq;
+            ic2eq = SampleType(2) * v2 - ic2eq;
+
+            detector[i] = juce::jmax(detector[i], std::abs(damping * v1));
+        }
+
+        juce::dsp::util::snapToZero(ic1eq);
+        juce::dsp::util::snapToZero(ic2eq);
+        sidechainState1[channel] = ic1eq;
+        sidechainState2[channel] = ic2eq;
+    }
+
+    double sampleRate { 44100.0 };
+    int numChannels { 0 }, numSidechainChannels { 0 };
+    DynamicPeakSettings designedSettings;
+    bool designed { false };
+
+    // solver coefficients of the bell, see SvfCoefficients
+    SampleType a1 { 1 }, a2 { 0 }, a3 { 0 }, damping { 1 };
+    SampleType attack { 0 }, release { 0 };
+
+    std::vector<SampleType> state1, state2, sidechainState1, sidechainState2;
+
+    SampleType envelope { 0 };
+    // G - 1, ramped towards the gain computer's target
+    SampleType gainMinusOne { 0 }, gainStep { 0 };
+    int samplesUntilUpdate { 0 };
+
+    std::atomic<float> currentGain { 0.f };
+};
@@ -0,0 +1,50 @@
+/*
+  ==============================================================================
+
+    DynamicPeakParameters.cpp
+
+  ==============================================================================
+*/
+
+#include "DynamicPeakParameters.h"
+
+DynamicPeakParameters::DynamicPeakParameters(juce::AudioProcessorValueTreeState& apvts)
+    : enabled(apvts.getRawParameterValue("Peak Dynamic")),
+      peakFreq(apvts.getRawParameterValue("Peak Freq")),
+      peakGain(apvts.getRawParameterValue("Peak Gain")),
+      peakQuality(apvts.getRawParameterValue("Peak Quality")),
+      threshold(apvts.getRawParameterValue("Peak Threshold")),
+      ratio(apvts.getRawParameterValue("Peak Ratio")),
+      attack(apvts.getRawParameterValue("Peak Attack")),
+      release(apvts.getRawParameterValue("Peak Release"))
+{
+    // every parameter must exist in createParameterLayout()
+    jassert(enabled != nullptr && peakFreq != nullptr && peakGain != nullptr && peakQuality != nullptr
+            && threshold != nullptr && ratio != nullptr && attack != nullptr && release != nullptr);
+}
+
+bool DynamicPeakParameters::update() noexcept
+{
+    DynamicPeakSettings latest;
+
+    latest.enabled = enabled->load() > 0.5f;
+    latest.peakFreq = peakFreq->load();
+    latest.peakGainInDecibles = peakGain->load();
+    latest.peakQuality = peakQuality->load();
+    latest.thresholdInDecibels = threshold->load();
+    latest.ratio = ratio->load();
+    latest.attackMs = attack->load();
+    latest.releaseMs = release->load();
+
+    auto changed = forceChange.exchange(false);
+
+    // exact comparison is intended, as in ParameterSnapshot
+    if (latest.enabled != settings.enabled || latest.peakFreq != settings.peakFreq
+        || latest.peakGainInDecibles != settings.peakGainInDecibles || latest.peakQuality != settings.peakQuality
+        || latest.thresholdInDecibels != settings.thresholdInDecibels || latest.ratio != settings.ratio
+        || latest.attackMs != settings.attackMs || latest.releaseMs != settings.releaseMs)
+        changed = true;
+
+    settings = latest;
+    return changed;
+}
@@ -0,0 +1,49 @@
+/*
+  ==============================================================================
+
+    DynamicPeakParameters.h
+
+    The parameters of the peak band in dynamic mode (see DynamicPeak.h).
+    Like ParameterSnapshot, the raw parameter pointers are looked up once
+    and update() reports whether any of them moved, so the audio thread
+    neither searches the apvts by string nor redesigns an unchanged band.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "ChainSettings.h"
+
+class DynamicPeakParameters
+{
+public:
+    // looks up every parameter by its string ID once
+    explicit DynamicPeakParameters(juce::AudioProcessorValueTreeState& apvts);
+
+    // reads the cached parameters, true if any value differs from the
+    // previous call
+    bool update() noexcept;
+
+    // forces the next update() to report a change, e.g. after prepareToPlay
+    void invalidate() noexcept { forceChange.store(true); }
+
+    // settings read by the last update()
+    const DynamicPeakSettings& getSettings() const noexcept { return settings; }
+
+private:
+    std::atomic<float>* enabled { nullptr };
+    std::atomic<float>* peakFreq { nullptr };
+    std::atomic<float>* peakGain { nullptr };
+    std::atomic<float>* peakQuality { nullptr };
+    std::atomic<float>* threshold { nullptr };
+    std::atomic<float>* ratio { nullptr };
+    std::atomic<float>* attack { nullptr };
+    std::atomic<float>* release { nullptr };
+
+    DynamicPeakSettings settings;
+    std::atomic<bool> forceChange { true };
+
+    JUCE_DECLARE_NON_COPYABLE (DynamicPeakParameters)
+};
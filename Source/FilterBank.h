@@ -0,0 +1,186 @@
+/*
+  ==============================================================================
+
+    FilterBank.h
+
+    A bank of any number of user bands (bells, shelves, notches, tilts,
+    band-passes and cuts, see BandType), one biquad each, sized when it is
+    prepared instead of fixed at compile time like the ProcessorChain.
+
+    The coefficients and the state of every band sit in preallocated
+    contiguous arrays, indexed by band. Only the bands that do something
+    are listed as live, in band order, so a bypassed band costs nothing:
+    it is simply not in the list.
+
+    The live bands run in passes of up to sectionsPerPass sections. Each
+    pass is a fully unrolled kernel like the ones of SosCascade, which
+    keeps the coefficients and the state of its sections in registers
+    while it walks the block once, so the cost grows linearly with the
+    number of live bands.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "CoefficientSet.h"
+
+template <typename SampleType>
+class FilterBank
+{
+public:
+    // sections one pass over the block runs
+    static constexpr int sectionsPerPass = 4;
+
+    // allocates the coefficients and the state of numBands bands for
+    // numChannels channels, not real-time safe. Every band starts bypassed
+    void prepare(int numBandsToUse, int numChannelsToUse)
+    {
+        jassert(numBandsToUse <= maxBankBands);
+
+        numBands = juce::jlimit(0, maxBankBands, numBandsToUse);
+        numChannels = juce::jmax(1, numChannelsToUse);
+
+        sections.assign((size_t) numBands, {});
+        live.assign((size_t) numBands, false);
+        liveBands.assign((size_t) numBands, 0);
+        numLiveBands = 0;
+
+        state.assign((size_t) (numChannels * numBands), {});
+    }
+
+    void reset() noexcept
+    {
+        std::fill(state.begin(), state.end(), State {});
+    }
+
+    // loads the coefficients of one band, an identity section bypasses it.
+    // A band that comes back starts from silence. Real-time safe
+    void setBand(int band, const BiquadCoefficients& c) noexcept
+    {
+        jassert(juce::isPositiveAndBelow(band, numBands));
+
+        auto isLive = ! c.isIdentity();
+
+        if (isLive)
+            sections[(size_t) band] = { static_cast<SampleType>(c.b0), static_cast<SampleType>(c.b1), static_cast<SampleType>(c.b2),
+                                        static_cast<SampleType>(c.a1), static_cast<SampleType>(c.a2) };
+
+        if (isLive == live[(size_t) band])
+            return;
+
+        live[(size_t) band] = isLive;
+
+        for (int channel = 0; channel < numChannels; ++channel)
+            state[(size_t) (channel * numBands + band)] = {};
+
+        numLiveBands = 0;
+
+        for (int b = 0; b < numBands; ++b)
+            if (live[(size_t) b])
+                liveBands[(size_t) numLiveBands++] = b;
+    }
+
+    int getNumBands() const noexcept { return numBands; }
+    int getNumLiveBands() const noexcept { return numLiveBands; }
+    bool isLive(int band) const noexcept { return live[(size_t) band]; }
+
+    // filters every channel of the block in place
+    void process(juce::dsp::AudioBlock<SampleType>& block) noexcept
+    {
+        auto channelsToProcess = juce::jmin((int) block.getNumChannels(), numChannels);
+
+        for (int channel = 0; channel < channelsToProcess; ++channel)
+        {
+            auto* samples = block.getChannelPointer((size_t) channel);
+            auto* channelState = state.data() + channel * numBands;
+
+            for (int first = 0; first < numLiveBands; first += sectionsPerPass)
+            {
+                auto count = juce::jmin(sectionsPerPass, numLiveBands - first);
+                (this->*getKernel(count))(samples, block.getNumSamples(), channelState, liveBands.data() + first);
+            }
+        }
+    }
+
+private:
+    struct Section
+    {
+        SampleType b0 { 1 }, b1 { 0 }, b2 { 0 }, a1 { 0 }, a2 { 0 };
+    };
+
+    struct State
+    {
+        SampleType z1 { 0 }, z2 { 0 };
+    };
+
+    // transposed direct form II, the same structure as SosCascade
+    static SampleType processSection(SampleType x, const Section& c, State& z) noexcept
+    {
+        auto y = c.b0 * x + z.z1;
+        z.z1 = c.b1 * x - c.a1 * y + z.z2;
+        z.z2 = c.b2 * x - c.a2 * y;
+        return y;
+    }
+
+    // one pass through the bands listed in bands[0 .. sizeof...(Sections))
+    template <size_t... Sections>
+    void processPass(SampleType* samples, size_t numSamples, State* channelState, const int* bands,
+                     std::index_sequence<Sections...>) noexcept
+    {
+        constexpr auto numPassSections = sizeof...(Sections);
+
+        // copied into locals so they stay in registers for the whole block
+        const Section c[numPassSections] { sections[(size_t) bands[Sections]]... };
+        State z[numPassSections] { channelState[bands[Sections]]... };
+
+        for (size_t i = 0; i < numSamples; ++i)
+        {
+            auto x = samples[i];
+            ((x = processSection(x, c[Sections], z[Sections])), ...);
+            samples[i] = x;
+        }
+
+        // flush denormals that could otherwise stay in the state forever
+        ((juce::dsp::util::snapToZero(z[Sections].z1), juce::dsp::util::snapToZero(z[Sections].z2)), ...);
+        ((channelState[bands[Sections]] = z[Sections]), ...);
+    }
+
+    template <size_t NumSections>
+    void processKernel(SampleType* samples, size_t numSamples, State* channelState, const int* bands) noexcept
+    {
+        if constexpr (NumSections == 0)
+            juce::ignoreUnused(samples, numSamples, channelState, bands);
+        else
+            processPass(samples, numSamples, channelState, bands, std::make_index_sequence<NumSections>());
+    }
+
+    using Kernel = void (FilterBank::*)(SampleType*, size_t, State*, const int*) noexcept;
+
+    // kernels[n] runs n sections
+    template <size_t... Counts>
+    static constexpr std::array<Kernel, sizeof...(Counts)> makeKernels(std::index_sequence<Counts...>) noexcept
+    {
+        return { &FilterBank::processKernel<Counts>... };
+    }
+
+    static constexpr Kernel getKernel(int numPassSections) noexcept
+    {
+        constexpr auto kernels = makeKernels(std::make_index_sequence<sectionsPerPass + 1>());
+        return kernels[(size_t) numPassSections];
+    }
+
+    int numBands { 0 }, numChannels { 0 };
+
+    // per band, indexed by band number
+    std::vector<Section> sections;
+    std::vector<bool> live;
+
+    // the live bands in band order, only [0, numLiveBands) is in use
+    std::vector<int> liveBands;
+    int numLiveBands { 0 };
+
+    // numBands values per channel
+    std::vector<State> state;
+};
@@ -0,0 +1,358 @@
+/*
+  ==============================================================================
+
+    LinearPhaseEngine.cpp
+
+  ==============================================================================
+*/
+
+#include "LinearPhaseEngine.h"
+
+//==============================================================================
+// designs the kernels of every instance in the process, one at a time
+class LinearPhaseEngine::DesignThread : private juce::Thread
+{
+public:
+    // how often the instances are polled for new coefficients
+    static constexpr int pollIntervalMs = 5;
+
+    static std::shared_ptr<DesignThread> getInstance()
+    {
+        static juce::CriticalSection instanceLock;
+        static std::weak_ptr<DesignThread> instance;
+
+        const juce::ScopedLock sl(instanceLock);
+
+        if (auto existing = instance.lock())
+            return existing;
+
+        auto thread = std::make_shared<DesignThread>();
+        instance = thread;
+        return thread;
+    }
+
+    DesignThread()
+        : juce::Thread("SimpleEQ linear phase kernels")
+    {
+        startThread();
+    }
+
+    ~DesignThread() override
+    {
+        stopThread(4000);
+    }
+
+    void addClient(LinearPhaseEngine* client)
+    {
+        const juce::ScopedLock sl(clientsLock);
+        clients.addIfNotAlreadyThere(client);
+    }
+
+    // returns once the thread no longer touches the client
+    void removeClient(LinearPhaseEngine* client)
+    {
+        const juce::ScopedLock sl(clientsLock);
+        clients.removeFirstMatchingValue(client);
+    }
+
+private:
+    void run() override
+    {
+        while (! threadShouldExit())
+        {
+            {
+                const juce::ScopedLock sl(clientsLock);
+
+                for (auto* client : clients)
+                    client->designPendingKernel();
+            }
+
+            wait(pollIntervalMs);
+        }
+    }
+
+    juce::CriticalSection clientsLock;
+    juce::Array<LinearPhaseEngine*> clients;
+};
+
+//==============================================================================
+LinearPhaseEngine::LinearPhaseEngine()
+    : designThread(DesignThread::getInstance())
+{
+}
+
+LinearPhaseEngine::~LinearPhaseEngine()
+{
+    release();
+}
+
+void LinearPhaseEngine::setKernelLength(int numTaps) noexcept
+{
+    kernelLength.store(juce::nextPowerOfTwo(juce::jlimit(minKernelLength, maxKernelLength, numTaps)));
+}
+
+void LinearPhaseEngine::prepare(double sampleRate, int numChannels, const CoefficientSet& coefficientSet)
+{
+    release();
+
+    preparedKernelLength = kernelLength.load();
+    numPartitions = preparedKernelLength / partitionSize;
+
+    auto kernelOrder = juce::roundToInt(std::log2(preparedKernelLength));
+    auto partitionOrder = juce::roundToInt(std::log2(2 * partitionSize));
+    kernelFft = std::make_unique<juce::dsp::FFT>(kernelOrder);
+    partitionFft = std::make_unique<juce::dsp::FFT>(partitionOrder);
+
+    // the real-only transforms work in place on twice their size
+    kernelBuffer.assign((size_t) (2 * preparedKernelLength), 0.f);
+    partitionBuffer.assign((size_t) (4 * partitionSize), 0.f);
+    fftBuffer.assign((size_t) (4 * partitionSize), 0.f);
+    spectrumRe.assign((size_t) numBins, 0.f);
+    spectrumIm.assign((size_t) numBins, 0.f);
+
+    // a periodic blackman window, symmetric around the centre tap so the
+    // kernel stays exactly linear phase
+    window.resize((size_t) preparedKernelLength);
+
+    for (size_t n = 0; n < window.size(); ++n)
+    {
+        auto phase = juce::MathConstants<double>::twoPi * (double) n / (double) preparedKernelLength;
+        window[n] = (float) (0.42 - 0.5 * std::cos(phase) + 0.08 * std::cos(2.0 * phase));
+    }
+
+    magnitudeResponse.setBinFrequencies(preparedKernelLength, sampleRate);
+
+    channels.resize((size_t) juce::jmax(1, numChannels));
+
+    for (auto& channel : channels)
+    {
+        channel.input.assign((size_t) (2 * partitionSize), 0.f);
+        channel.output.assign((size_t) partitionSize, 0.f);
+        channel.delayLineRe.assign((size_t) (numPartitions * numBins), 0.f);
+        channel.delayLineIm.assign((size_t) (numPartitions * numBins), 0.f);
+    }
+
+    // drop whatever was left over from before, then start from the
+    // given set without waiting for the design thread
+    while (kernels.acquire() != nullptr || requests.acquire() != nullptr) {}
+
+    designKernel(coefficientSet, activeKernel);
+    pendingKernel = nullptr;
+    reset();
+
+    designThread->addClient(this);
+}
+
+void LinearPhaseEngine::release()
+{
+    designThread->removeClient(this);
+}
+
+void LinearPhaseEngine::reset() noexcept
+{
+    for (auto& channel : channels)
+    {
+        std::fill(channel.input.begin(), channel.input.end(), 0.f);
+        std::fill(channel.output.begin(), channel.output.end(), 0.f);
+        std::fill(channel.delayLineRe.begin(), channel.delayLineRe.end(), 0.f);
+        std::fill(channel.delayLineIm.begin(), channel.delayLineIm.end(), 0.f);
+    }
+
+    fill = 0;
+    delayLineHead = 0;
+}
+
+void LinearPhaseEngine::setCoefficients(const CoefficientSet& coefficientSet) noexcept
+{
+    requests.getWriteBuffer() = coefficientSet;
+    requests.publish();
+}
+
+//==============================================================================
+void LinearPhaseEngine::designPendingKernel()
+{
+    if (auto* coefficientSet = requests.acquire())
+    {
+        auto& kernel = kernels.getWriteBuffer();
+        designKernel(*coefficientSet, kernel);
+        kernels.publish();
+    }
+}
+
+void LinearPhaseEngine::designKernel(const CoefficientSet& coefficientSet, Kernel& kernel)
+{
+    auto size = (size_t) preparedKernelLength;
+
+    // the magnitude with zero phase, in the real-only format of juce::dsp::FFT:
+    // interleaved real and imaginary parts of the bins 0 .. size / 2
+    magnitudeResponse.compute(coefficientSet);
+    const auto& decibels = magnitudeResponse.getDecibels();
+
+    std::fill(kernelBuffer.begin(), kernelBuffer.end(), 0.f);
+
+    for (size_t bin = 0; bin < decibels.size(); ++bin)
+        kernelBuffer[2 * bin] = juce::Decibels::decibelsToGain(decibels[bin], -400.f);
+
+    kernelFft->performRealOnlyInverseTransform(kernelBuffer.data());
+
+    kernel.re.resize((size_t) (numPartitions * numBins));
+    kernel.im.resize((size_t) (numPartitions * numBins));
+
+    for (int partition = 0; partition < numPartitions; ++partition)
+    {
+        std::fill(partitionBuffer.begin(), partitionBuffer.end(), 0.f);
+
+        // the zero phase response is centred on tap 0 and wraps around,
+        // rotating it by half the length puts its centre at size / 2
+        for (size_t i = 0; i < (size_t) partitionSize; ++i)
+        {
+            auto n = (size_t) partition * (size_t) partitionSize + i;
+            partitionBuffer[i] = kernelBuffer[(n + size / 2) % size] * window[n];
+        }
+
+        // zero padded to twice the partition size for overlap-save
+        partitionFft->performRealOnlyForwardTransform(partitionBuffer.data(), true);
+
+        auto* re = kernel.re.data() + partition * numBins;
+        auto* im = kernel.im.data() + partition * numBins;
+
+        for (size_t bin = 0; bin < (size_t) numBins; ++bin)
+        {
+            re[bin] = partitionBuffer[2 * bin];
+            im[bin] = partitionBuffer[2 * bin + 1];
+        }
+    }
+}
+
+//==============================================================================
+void LinearPhaseEngine::process(juce::dsp::AudioBlock<float>& block) noexcept
+{
+    processBlock(block);
+}
+
+void LinearPhaseEngine::process(juce::dsp::AudioBlock<double>& block) noexcept
+{
+    processBlock(block);
+}
+
+template <typename SampleType>
+void LinearPhaseEngine::processBlock(juce::dsp::AudioBlock<SampleType>& block) noexcept
+{
+    auto channelsToProcess = juce::jmin(block.getNumChannels(), channels.size());
+    auto numSamples = block.getNumSamples();
+    size_t position = 0;
+
+    // the partitions carry on across blocks of any size
+    while (position < numSamples)
+    {
+        auto chunk = juce::jmin((size_t) (partitionSize - fill), numSamples - position);
+
+        for (size_t c = 0; c < channelsToProcess; ++c)
+        {
+            auto* samples = block.getChannelPointer(c) + position;
+            auto& channel = channels[c];
+
+            // the new input goes into the second half, the output of the
+            // partition before comes out in its place
+            for (size_t i = 0; i < chunk; ++i)
+            {
+                channel.input[(size_t) (partitionSize + fill) + i] = static_cast<float>(samples[i]);
+                samples[i] = static_cast<SampleType>(channel.output[(size_t) fill + i]);
+            }
+        }
+
+        fill += (int) chunk;
+        position += chunk;
+
+        if (fill == partitionSize)
+        {
+            // a new kernel takes over at a partition boundary
+            if (pendingKernel == nullptr)
+                if (auto* kernel = kernels.acquire())
+                    if (kernel->re.size() == activeKernel.re.size())
+                        pendingKernel = kernel;
+
+            for (size_t c = 0; c < channelsToProcess; ++c)
+                processPartition(channels[c]);
+
+            if (pendingKernel != nullptr)
+            {
+                std::copy(pendingKernel->re.begin(), pendingKernel->re.end(), activeKernel.re.begin());
+                std::copy(pendingKernel->im.begin(), pendingKernel->im.end(), activeKernel.im.begin());
+                pendingKernel = nullptr;
+            }
+
+            delayLineHead = (delayLineHead + 1) % numPartitions;
+            fill = 0;
+        }
+    }
+}
+
+void LinearPhaseEngine::processPartition(Channel& channel) noexcept
+{
+    // the spectrum of the last two input partitions goes into the delay line
+    std::copy(channel.input.begin(), channel.input.end(), fftBuffer.begin());
+    partitionFft->performRealOnlyForwardTransform(fftBuffer.data(), true);
+
+    auto* headRe = channel.delayLineRe.data() + delayLineHead * numBins;
+    auto* headIm = channel.delayLineIm.data() + delayLineHead * numBins;
+
+    for (size_t bin = 0; bin < (size_t) numBins; ++bin)
+    {
+        headRe[bin] = fftBuffer[2 * bin];
+        headIm[bin] = fftBuffer[2 * bin + 1];
+    }
+
+    // overlap-save: the second half of the result is the new output
+    convolve(channel, activeKernel);
+    std::copy(fftBuffer.begin() + partitionSize, fftBuffer.begin() + 2 * partitionSize, channel.output.begin());
+
+    if (pendingKernel != nullptr)
+    {
+        // the new kernel on the same delay line, faded in over the partition
+        convolve(channel, *pendingKernel);
+
+        for (size_t i = 0; i < (size_t) partitionSize; ++i)
+        {
+            auto gain = (float) (i + 1) / (float) partitionSize;
+            channel.output[i] += gain * (fftBuffer[(size_t) partitionSize + i] - channel.output[i]);
+        }
+    }
+
+    // this partition's input is the first half of the next transform
+    std::copy(channel.input.begin() + partitionSize, channel.input.end(), channel.input.begin());
+}
+
+void LinearPhaseEngine::convolve(const Channel& channel, const Kernel& kernel) noexcept
+{
+    std::fill(spectrumRe.begin(), spectrumRe.end(), 0.f);
+    std::fill(spectrumIm.begin(), spectrumIm.end(), 0.f);
+
+    auto* accumulatorRe = spectrumRe.data();
+    auto* accumulatorIm = spectrumIm.data();
+
+    // partition p of the kernel meets the input from p partitions ago
+    for (int partition = 0; partition < numPartitions; ++partition)
+    {
+        auto slot = (delayLineHead + numPartitions - partition) % numPartitions;
+
+        const auto* xRe = channel.delayLineRe.data() + slot * numBins;
+        const auto* xIm = channel.delayLineIm.data() + slot * numBins;
+        const auto* hRe = kernel.re.data() + partition * numBins;
+        const auto* hIm = kernel.im.data() + partition * numBins;
+
+        for (int bin = 0; bin < numBins; ++bin)
+        {
+            accumulatorRe[bin] += xRe[bin] * hRe[bin] - xIm[bin] * hIm[bin];
+            accumulatorIm[bin] += xRe[bin] * hIm[bin] + xIm[bin] * hRe[bin];
+        }
+    }
+
+    for (size_t bin = 0; bin < (size_t) numBins; ++bin)
+    {
+        fftBuffer[2 * bin] = accumulatorRe[bin];
+        fftBuffer[2 * bin + 1] = accumulatorIm[bin];
+    }
+
+    partitionFft->performRealOnlyInverseTransform(fftBuffer.data());
+}
@@ -0,0 +1,150 @@
+/*
+  ==============================================================================
+
+    LinearPhaseEngine.h
+
+    A linear phase version of the eq for mastering: the same magnitude
+    response as the biquad engines, without their phase shift, at the
+    price of latency.
+
+    Kernel design, off the audio thread: the magnitude response of the
+    CoefficientSet at the bins of a kernelLength point FFT (see
+    MagnitudeResponse), with zero phase, is transformed back, centred
+    and windowed into a symmetric FIR kernel of kernelLength taps. The
+    kernels of every instance are designed by one shared thread, which
+    polls the instances for new coefficients like the CoefficientService.
+
+    Convolution, on the audio thread: uniformly partitioned overlap-save.
+    The kernel is cut into partitions of partitionSize taps whose spectra
+    are kept, and every partitionSize input samples one forward FFT goes
+    into a frequency domain delay line, is multiplied with the partitions
+    and transformed back, so a block costs about kernelLength / partitionSize
+    complex multiply-adds per sample plus two FFTs per partition, whatever
+    the host block size.
+
+    Latency: kernelLength / 2 (the centre of the kernel) + partitionSize
+    (the input is collected a partition at a time), reported to the host
+    by the processor.
+
+    A new kernel takes over with a crossfade over one partition, during
+    which the old and the new kernel both run on the same delay line. The
+    audio thread copies kernels into storage it allocated in prepare(),
+    so swapping never allocates.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "CoefficientSet.h"
+#include "MagnitudeResponse.h"
+#include "TripleBuffer.h"
+
+class LinearPhaseEngine
+{
+public:
+    LinearPhaseEngine();
+    ~LinearPhaseEngine();
+
+    // samples per partition, which is also the latency of the partitioning
+    static constexpr int partitionSize = 256;
+
+    // taps of the FIR kernel, a power of two, used by the next prepare()
+    static constexpr int minKernelLength = 1024;
+    static constexpr int maxKernelLength = 32768;
+    static constexpr int defaultKernelLength = 4096;
+    void setKernelLength(int numTaps) noexcept;
+    int getKernelLength() const noexcept { return kernelLength.load(); }
+
+    // the latency of a kernel length, in samples, and of the prepared one
+    static constexpr int getLatencyInSamples(int numTaps) noexcept { return numTaps / 2 + partitionSize; }
+    int getLatencyInSamples() const noexcept { return getLatencyInSamples(preparedKernelLength); }
+
+    // how long the output goes on after the input stops
+    int getTailLengthInSamples() const noexcept { return preparedKernelLength + partitionSize; }
+
+    // CPU budget for a stereo instance at 48 kHz, as a share of one core:
+    // 1% up to 4096 taps, 2.5% up to 16384 taps, checked by the benchmarks
+    static double getCpuBudget(int numTaps) noexcept { return numTaps <= 4096 ? 0.01 : (numTaps <= 16384 ? 0.025 : 0.05); }
+
+    // allocates everything, designs the kernel for the given set right
+    // here and starts following setCoefficients(). Not real-time safe
+    void prepare(double sampleRate, int numChannels, const CoefficientSet& coefficientSet);
+
+    // stops the background design
+    void release();
+
+    void reset() noexcept;
+
+    // audio thread: hands a new set to the background design, the kernel
+    // crossfades over once it is ready. Never locks or allocates
+    void setCoefficients(const CoefficientSet& coefficientSet) noexcept;
+
+    // convolves every channel of the block in place. The arithmetic is
+    // float in both, the double version converts on the way in and out
+    void process(juce::dsp::AudioBlock<float>& block) noexcept;
+    void process(juce::dsp::AudioBlock<double>& block) noexcept;
+
+private:
+    class DesignThread;
+
+    // the spectra of all partitions of a kernel, split into real and
+    // imaginary parts so the multiply-adds vectorise
+    struct Kernel
+    {
+        std::vector<float> re, im;
+    };
+
+    struct Channel
+    {
+        // the last two partitions of input, the last partition of output
+        std::vector<float> input, output;
+        // the spectra of the last numPartitions input partitions
+        std::vector<float> delayLineRe, delayLineIm;
+    };
+
+    template <typename SampleType>
+    void processBlock(juce::dsp::AudioBlock<SampleType>& block) noexcept;
+
+    // convolves one partition of a channel, crossfading if a new kernel is pending
+    void processPartition(Channel& channel) noexcept;
+
+    // accumulates the delay line times the kernel into spectrumRe/Im and
+    // transforms it back into fftBuffer
+    void convolve(const Channel& channel, const Kernel& kernel) noexcept;
+
+    // design thread: designs a kernel if a new set arrived
+    void designPendingKernel();
+    void designKernel(const CoefficientSet& coefficientSet, Kernel& kernel);
+
+    std::atomic<int> kernelLength { defaultKernelLength };
+    int preparedKernelLength { defaultKernelLength };
+    int numPartitions { 0 };
+    static constexpr int numBins = partitionSize + 1;
+
+    //==============================================================================
+    // audio thread
+    std::vector<Channel> channels;
+    Kernel activeKernel;
+    const Kernel* pendingKernel { nullptr };
+    int fill { 0 }, delayLineHead { 0 };
+
+    // 2 * partitionSize point transforms, also used by the design thread
+    // (juce::dsp::FFT keeps no state between calls)
+    std::unique_ptr<juce::dsp::FFT> partitionFft;
+    std::vector<float> fftBuffer, spectrumRe, spectrumIm;
+
+    //==============================================================================
+    // design thread (and prepare(), which never runs at the same time)
+    std::unique_ptr<juce::dsp::FFT> kernelFft;
+    std::vector<float> kernelBuffer, partitionBuffer, window;
+    MagnitudeResponse magnitudeResponse;
+
+    TripleBuffer<CoefficientSet> requests;
+    TripleBuffer<Kernel> kernels;
+
+    std::shared_ptr<DesignThread> designThread;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (LinearPhaseEngine)
+};
@@ -0,0 +1,96 @@
+/*
+  ==============================================================================
+
+    MagnitudeResponse.cpp
+
+  ==============================================================================
+*/
+
+#include "MagnitudeResponse.h"
+
+void MagnitudeResponse::resize(int numPoints)
+{
+    auto size = (size_t) juce::jmax(2, numPoints);
+    phi.resize(size);
+    power.resize(size);
+    decibels.resize(size);
+}
+
+void MagnitudeResponse::setFrequencies(int numPoints, double newSampleRate)
+{
+    jassert(newSampleRate > 0.0);
+    sampleRate = newSampleRate;
+    resize(numPoints);
+
+    auto size = phi.size();
+
+    for (size_t i = 0; i < size; ++i)
+    {
+        auto frequency = juce::mapToLog10((double) i / (double) (size - 1), minFrequency, maxFrequency);
+
+        // above nyquist the response mirrors, show it flat at nyquist instead
+        auto w = juce::MathConstants<double>::twoPi * juce::jmin(frequency, 0.5 * sampleRate) / sampleRate;
+        auto s = std::sin(0.5 * w);
+        phi[i] = s * s;
+    }
+}
+
+void MagnitudeResponse::setBinFrequencies(int fftSize, double newSampleRate)
+{
+    jassert(newSampleRate > 0.0 && fftSize >= 2);
+    sampleRate = newSampleRate;
+    resize(fftSize / 2 + 1);
+
+    for (size_t i = 0; i < phi.size(); ++i)
+    {
+        auto s = std::sin(juce::MathConstants<double>::pi * (double) i / (double) fftSize);
+        phi[i] = s * s;
+    }
+}
+
+void MagnitudeResponse::multiplySection(const BiquadCoefficients& c) noexcept
+{
+    // |b0 + b1 z^-1 + b2 z^-2|^2 on the unit circle, written in phi:
+    // (b0 + b1 + b2)^2 - 4 (b0 b1 + 4 b0 b2 + b1 b2) phi + 16 b0 b2 phi^2,
+    // and the same for 1 + a1 z^-1 + a2 z^-2
+    auto bSum = c.b0 + c.b1 + c.b2;
+    auto bLinear = -4.0 * (c.b0 * c.b1 + 4.0 * c.b0 * c.b2 + c.b1 * c.b2);
+    auto bSquare = 16.0 * c.b0 * c.b2;
+
+    auto aSum = 1.0 + c.a1 + c.a2;
+    auto aLinear = -4.0 * (c.a1 + 4.0 * c.a2 + c.a1 * c.a2);
+    auto aSquare = 16.0 * c.a2;
+
+    auto* p = phi.data();
+    auto* result = power.data();
+
+    for (size_t i = 0; i < power.size(); ++i)
+    {
+        auto numerator = bSum * bSum + (bLinear + bSquare * p[i]) * p[i];
+        auto denominator = aSum * aSum + (aLinear + aSquare * p[i]) * p[i];
+        result[i] *= numerator / denominator;
+    }
+}
+
+void MagnitudeResponse::compute(const CoefficientSet& coefficientSet,
+                                const BiquadCoefficients* extraSections, int numExtraSections) noexcept
+{
+    std::fill(power.begin(), power.end(), 1.0);
+
+    for (int i = 0; i < coefficientSet.lowCut.getNumSections(); ++i)
+        multiplySection(coefficientSet.lowCut.sections[(size_t) i]);
+
+    if (! coefficientSet.peak.isIdentity())
+        multiplySection(coefficientSet.peak);
+
+    for (int i = 0; i < coefficientSet.highCut.getNumSections(); ++i)
+        multiplySection(coefficientSet.highCut.sections[(size_t) i]);
+
+    for (int i = 0; i < numExtraSections; ++i)
+        if (! extraSections[i].isIdentity())
+            multiplySection(extraSections[i]);
+
+    // power, so 10 log10 rather than 20
+    for (size_t i = 0; i < power.size(); ++i)
+        decibels[i] = (float) (10.0 * std::log10(juce::jmax(power[i], 1.0e-30)));
+}
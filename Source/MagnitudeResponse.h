@@ -0,0 +1,58 @@
+/*
+  ==============================================================================
+
+    MagnitudeResponse.h
+
+    The magnitude of a CoefficientSet at a fixed set of log spaced
+    frequencies, e.g. one per pixel column of the response curve.
+
+    Everything that only depends on the frequencies is computed once in
+    setFrequencies(). compute() then runs one tight loop per live section
+    over plain arrays, which the compiler turns into SIMD code, instead
+    of calling getMagnitudeForFrequency (complex maths) for every section
+    at every frequency.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "CoefficientSet.h"
+
+class MagnitudeResponse
+{
+public:
+    // numPoints frequencies from minFrequency to maxFrequency, log spaced.
+    // Allocates, call it when the size or the sample rate change
+    void setFrequencies(int numPoints, double sampleRate);
+
+    // the fftSize / 2 + 1 bin frequencies of an FFT, from 0 Hz to nyquist,
+    // e.g. to turn the response into an FIR kernel. Allocates
+    void setBinFrequencies(int fftSize, double sampleRate);
+
+    // the response of every live section of the set, followed by
+    // numExtraSections more biquads (e.g. the filter bank's bands),
+    // in dB. Identity sections are skipped. No allocation
+    void compute(const CoefficientSet& coefficientSet,
+                 const BiquadCoefficients* extraSections = nullptr, int numExtraSections = 0) noexcept;
+
+    int getNumPoints() const noexcept { return (int) decibels.size(); }
+    double getSampleRate() const noexcept { return sampleRate; }
+    const std::vector<float>& getDecibels() const noexcept { return decibels; }
+
+    static constexpr double minFrequency = 20.0;
+    static constexpr double maxFrequency = 20000.0;
+
+private:
+    void resize(int numPoints);
+
+    // multiplies the power response of one biquad into power
+    void multiplySection(const BiquadCoefficients& section) noexcept;
+
+    // phi = sin^2(w / 2) of every frequency, which keeps the response of
+    // sections with poles and zeros close to z = 1 (low cuts) accurate
+    std::vector<double> phi, power;
+    std::vector<float> decibels;
+    double sampleRate { 0.0 };
+};
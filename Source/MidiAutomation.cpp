@@ -0,0 +1,122 @@
+/*
+  ==============================================================================
+
+    MidiAutomation.cpp
+
+  ==============================================================================
+*/
+
+#include "MidiAutomation.h"
+
+MidiAutomation::MidiAutomation(juce::AudioProcessorValueTreeState& apvts)
+{
+    const char* parameterIDs[numParameters] { "LowCut Freq", "HighCut Freq", "Peak Freq", "Peak Gain",
+                                              "Peak Quality", "LowCut Slope", "HighCut Slope" };
+
+    for (int i = 0; i < numParameters; ++i)
+    {
+        parameters[(size_t) i] = apvts.getParameter(parameterIDs[i]);
+        jassert(parameters[(size_t) i] != nullptr);
+    }
+
+    for (auto& value : pendingValues)
+        value.store(noValue);
+
+    // often enough that a knob on the editor follows a sweep smoothly
+    startTimerHz(30);
+}
+
+MidiAutomation::~MidiAutomation()
+{
+    stopTimer();
+}
+
+void MidiAutomation::reset() noexcept
+{
+    // the posted values are kept, the filters already run with them
+    lastMsb.fill(0);
+    sendsLsb.fill(false);
+}
+
+bool MidiAutomation::handle(const juce::uint8* data, int numBytes, Change& change) noexcept
+{
+    // controller change on any channel: status, controller, value
+    if (numBytes < 3 || (data[0] & 0xf0) != 0xb0)
+        return false;
+
+    auto controller = (int) data[1];
+    auto value = (int) (data[2] & 0x7f);
+
+    if (juce::isPositiveAndBelow(controller - firstController, numParameters))
+    {
+        change.index = controller - firstController;
+        lastMsb[(size_t) change.index] = value;
+
+        // a plain 7 bit controller reaches the ends of the range. Once the
+        // controller has sent an LSB, the MSB goes on the 14 bit scale as
+        // if the LSB were 0, so the LSB that follows refines the value
+        // instead of moving it back
+        change.value = sendsLsb[(size_t) change.index] ? (float) (value * 128) / 16383.f
+                                                       : (float) value / 127.f;
+        return true;
+    }
+
+    if (juce::isPositiveAndBelow(controller - firstController - lsbOffset, numParameters))
+    {
+        change.index = controller - firstController - lsbOffset;
+        sendsLsb[(size_t) change.index] = true;
+        change.value = (float) (lastMsb[(size_t) change.index] * 128 + value) / 16383.f;
+        return true;
+    }
+
+    return false;
+}
+
+void MidiAutomation::apply(const Change& change, ChainSettings& settings) const noexcept
+{
+    // snapped to the parameter's interval like the value it will store
+    auto value = parameters[(size_t) change.index]->convertFrom0to1(change.value);
+
+    switch (change.index)
+    {
+        case 0: settings.lowCutFreq = value; break;
+        case 1: settings.highCutFreq = value; break;
+        case 2: settings.peakFreq = value; break;
+        case 3: settings.peakGainInDecibles = value; break;
+        case 4: settings.peakQuality = value; break;
+        case 5: settings.lowCutSlope = static_cast<Slope>(value); break;
+        case 6: settings.highCutSlope = static_cast<Slope>(value); break;
+        default: jassertfalse; break;
+    }
+}
+
+void MidiAutomation::post(const Change& change) noexcept
+{
+    pendingValues[(size_t) change.index].store(change.value);
+}
+
+bool MidiAutomation::hasPendingChanges() const noexcept
+{
+    for (const auto& value : pendingValues)
+        if (value.load() != noValue)
+            return true;
+
+    return false;
+}
+
+void MidiAutomation::timerCallback()
+{
+    for (size_t i = 0; i < pendingValues.size(); ++i)
+    {
+        auto value = pendingValues[i].load();
+
+        if (value == noValue)
+            continue;
+
+        parameters[i]->setValueNotifyingHost(value);
+
+        // the slot is only emptied once the parameter holds the value, and
+        // not at all if the audio thread posted a newer one meanwhile
+        pendingValues[i].compare_exchange_strong(value, noValue);
+    }
+}
@@ -0,0 +1,89 @@
+/*
+  ==============================================================================
+
+    MidiAutomation.h
+
+    Sample accurate parameter changes from MIDI controllers. JUCE hands
+    host automation to the processor once per block, at its start, so
+    automation is only as fine as the host's buffer size. Controller
+    messages carry their sample position within the block, so the eq
+    also takes its parameters from those and splits the block right
+    where they change:
+
+    - CC 20..26 move the parameters in the order of createParameterLayout()
+      (LowCut Freq, HighCut Freq, Peak Freq, Peak Gain, Peak Quality,
+      LowCut Slope, HighCut Slope) with 7 bit resolution
+    - CC 52..58, the matching LSBs (MSB + 32), refine the last MSB to
+      14 bits, (MSB * 128 + LSB) / 16383. As the MIDI spec asks, a new
+      MSB clears the LSB. An MSB alone maps to MSB / 127, so 127 reaches
+      the top of the range, until its controller sends a first LSB: from
+      then on it maps onto the 14 bit scale too
+
+    The filters follow a change on the audio thread, the parameters only
+    on the message thread: telling the host may lock, so the audio thread
+    just leaves the newest value per parameter in a slot that a timer
+    hands to the parameter.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "ChainSettings.h"
+
+class MidiAutomation : private juce::Timer
+{
+public:
+    // the first parameter's MSB controller
+    static constexpr int firstController = 20;
+    static constexpr int lsbOffset = 32;
+    static constexpr int numParameters = 7;
+
+    // a parameter, in the order of the controllers, and its new normalised value
+    struct Change
+    {
+        int index { 0 };
+        float value { 0.f };
+    };
+
+    // must be created on the message thread, which gets the changes
+    explicit MidiAutomation(juce::AudioProcessorValueTreeState& apvts);
+    ~MidiAutomation() override;
+
+    // forgets the controllers received so far
+    void reset() noexcept;
+
+    // true if the raw message is one of our controllers, with the change
+    // it makes. Real-time safe
+    bool handle(const juce::uint8* data, int numBytes, Change& change) noexcept;
+
+    // moves the change's parameter in the settings, with the value the
+    // parameter will hold. Real-time safe
+    void apply(const Change& change, ChainSettings& settings) const noexcept;
+
+    // queues the change for the parameter, which tells the host, the editor
+    // and the background designer. Only the newest value per parameter is
+    // kept. Real-time safe
+    void post(const Change& change) noexcept;
+
+    // true while posted changes have not reached their parameters
+    bool hasPendingChanges() const noexcept;
+
+private:
+    // hands the posted values to the parameters, message thread
+    void timerCallback() override;
+
+    // in the order of the controllers
+    std::array<juce::RangedAudioParameter*, numParameters> parameters {};
+    std::array<int, numParameters> lastMsb {};
+
+    // the controllers that have sent an LSB since the last reset()
+    std::array<bool, numParameters> sendsLsb {};
+
+    // the posted normalised values, noValue once a parameter has it
+    static constexpr float noValue = -1.f;
+    std::array<std::atomic<float>, numParameters> pendingValues;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MidiAutomation)
+};
@@ -0,0 +1,241 @@
+/*
+  ==============================================================================
+
+    MultiTrackCascade.h
+
+    Runs many independent tracks, each with its own ChainSettings, through
+    the eq in one call, for a mixing engine that hosts the eq on every
+    track of a session.
+
+    MultichannelCascade fills the lanes of a juce::dsp::SIMDRegister with
+    the channels of one eq, which all share the same coefficients, so a
+    mono or stereo track leaves most of the register empty. Here every
+    channel of every track gets a lane of its own, and every lane its own
+    coefficients: 4, 8 or 16 (SSE, AVX, AVX-512) differently set up tracks
+    run through one register at the cost of a single scalar eq.
+
+    A group of lanes runs every section that is live in any of its
+    tracks, so tracks with similar slopes are cheapest when they sit next
+    to each other. Lanes of a track that does not use a section pass
+    through it unchanged.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "SosCascade.h"
+#include "CoefficientService.h"
+
+template <typename SampleType>
+class MultiTrackCascade
+{
+public:
+   #if JUCE_USE_SIMD
+    using LaneGroup = juce::dsp::SIMDRegister<SampleType>;
+    static constexpr size_t numLanes = LaneGroup::size();
+   #else
+    // no SIMD on this target, each channel gets its own group
+    using LaneGroup = SampleType;
+    static constexpr size_t numLanes = 1;
+   #endif
+
+    // one entry per track with its number of channels. Allocates the lane
+    // groups and the interleaving scratch, not real-time safe
+    void prepare(double sampleRateToUse, const std::vector<int>& channelsPerTrack, int maximumBlockSize)
+    {
+        sampleRate = sampleRateToUse;
+        lanes.clear();
+        firstLaneOfTrack.clear();
+
+        for (int track = 0; track < (int) channelsPerTrack.size(); ++track)
+        {
+            firstLaneOfTrack.push_back((int) lanes.size());
+
+            for (int channel = 0; channel < channelsPerTrack[(size_t) track]; ++channel)
+                lanes.push_back({ track, channel });
+        }
+
+        firstLaneOfTrack.push_back((int) lanes.size());
+
+        auto numGroups = juce::jmax((size_t) 1, (lanes.size() + numLanes - 1) / numLanes);
+        groups.assign(numGroups, {});
+
+        for (auto& group : groups)
+            group.prepare(1);
+
+        // tracks pass through until their settings arrive
+        CoefficientSet passThrough;
+        passThrough.lowCut.active = passThrough.highCut.active = false;
+        trackSets.assign(channelsPerTrack.size(), passThrough);
+        interleaved.assign((size_t) juce::jmax(1, maximumBlockSize), LaneGroup(SampleType(0)));
+
+        if (service == nullptr)
+            service = CoefficientService::getInstance();
+
+        for (int group = 0; group < (int) groups.size(); ++group)
+            loadGroup(group);
+    }
+
+    void reset() noexcept
+    {
+        for (auto& group : groups)
+            group.reset();
+    }
+
+    // designs the coefficients of one track. Tracks with the same settings
+    // share one design through the CoefficientService, not real-time safe
+    void setSettings(int track, const ChainSettings& settings)
+    {
+        jassert(sampleRate > 0.0);
+        setCoefficients(track, *service->getDesign({ sampleRate, settings }));
+    }
+
+    // loads coefficients that were designed elsewhere into the lanes of
+    // one track, only its own lane groups are touched
+    void setCoefficients(int track, const CoefficientSet& coefficientSet) noexcept
+    {
+        jassert(juce::isPositiveAndBelow(track, getNumTracks()));
+
+        trackSets[(size_t) track] = coefficientSet;
+
+        auto first = firstLaneOfTrack[(size_t) track];
+        auto end = firstLaneOfTrack[(size_t) track + 1];
+
+        for (int group = first / (int) numLanes; group * (int) numLanes < end; ++group)
+            loadGroup(group);
+    }
+
+    int getNumTracks() const noexcept { return (int) trackSets.size(); }
+    int getNumLanes() const noexcept { return (int) lanes.size(); }
+    int getNumLaneGroups() const noexcept { return (int) groups.size(); }
+
+    // sections the lane group runs, the union of its tracks' live sections
+    int getNumSections(int group) const noexcept { return groups[(size_t) group].getNumSections(); }
+
+    // filters every track in place, tracks[t] holds the channels of track t.
+    // All blocks should have the same length, only the shortest is processed
+    void process(const juce::dsp::AudioBlock<SampleType>* tracks, int numTracks) noexcept
+    {
+        jassert(numTracks == getNumTracks());
+        numTracks = juce::jmin(numTracks, getNumTracks());
+
+        if (numTracks == 0)
+            return;
+
+        auto numSamples = tracks[0].getNumSamples();
+
+        for (int track = 1; track < numTracks; ++track)
+        {
+            jassert(tracks[track].getNumSamples() == numSamples);
+            numSamples = juce::jmin(numSamples, tracks[track].getNumSamples());
+        }
+
+        auto lanesToProcess = firstLaneOfTrack[(size_t) numTracks];
+
+        // blocks bigger than announced are worked through in chunks that
+        // fit the scratch buffer
+        for (size_t start = 0; start < numSamples; start += interleaved.size())
+        {
+            auto chunk = juce::jmin(interleaved.size(), numSamples - start);
+
+            for (int group = 0; group * (int) numLanes < lanesToProcess; ++group)
+            {
+                auto firstLane = group * (int) numLanes;
+                auto groupLanes = juce::jmin((int) numLanes, lanesToProcess - firstLane);
+
+                interleave(tracks, firstLane, groupLanes, start, chunk);
+                groups[(size_t) group].process(interleaved.data(), chunk, 0);
+                deinterleave(tracks, firstLane, groupLanes, start, chunk);
+            }
+        }
+    }
+
+private:
+    struct Lane
+    {
+        int track, channel;
+    };
+
+    void loadGroup(int group) noexcept
+    {
+        std::array<const CoefficientSet*, numLanes> laneSets {};
+
+        for (size_t lane = 0; lane < numLanes; ++lane)
+        {
+            auto index = (size_t) group * numLanes + lane;
+
+            if (index < lanes.size())
+                laneSets[lane] = &trackSets[(size_t) lanes[index].track];
+        }
+
+        groups[(size_t) group].setLaneCoefficients(laneSets.data(), laneSets.size());
+    }
+
+    // the register array seen as plain samples, lane l of sample i is at [i * numLanes + l]
+    SampleType* getInterleavedSamples() noexcept { return reinterpret_cast<SampleType*>(interleaved.data()); }
+
+    SampleType* getLanePointer(const juce::dsp::AudioBlock<SampleType>* tracks, int lane) const noexcept
+    {
+        const auto& l = lanes[(size_t) lane];
+        const auto& block = tracks[l.track];
+
+        // a track may be handed over with fewer channels than it was prepared with
+        return l.channel < (int) block.getNumChannels() ? block.getChannelPointer((size_t) l.channel) : nullptr;
+    }
+
+    void interleave(const juce::dsp::AudioBlock<SampleType>* tracks, int firstLane, int groupLanes,
+                    size_t start, size_t numSamples) noexcept
+    {
+        auto* samples = getInterleavedSamples();
+
+        for (int lane = 0; lane < (int) numLanes; ++lane)
+        {
+            auto* source = lane < groupLanes ? getLanePointer(tracks, firstLane + lane) : nullptr;
+
+            if (source != nullptr)
+            {
+                source += start;
+
+                for (size_t i = 0; i < numSamples; ++i)
+                    samples[i * numLanes + (size_t) lane] = source[i];
+            }
+            else
+            {
+                for (size_t i = 0; i < numSamples; ++i)
+                    samples[i * numLanes + (size_t) lane] = SampleType(0);
+            }
+        }
+    }
+
+    void deinterleave(const juce::dsp::AudioBlock<SampleType>* tracks, int firstLane, int groupLanes,
+                      size_t start, size_t numSamples) noexcept
+    {
+        auto* samples = getInterleavedSamples();
+
+        for (int lane = 0; lane < groupLanes; ++lane)
+        {
+            auto* destination = getLanePointer(tracks, firstLane + lane);
+
+            if (destination == nullptr)
+                continue;
+
+            destination += start;
+
+            for (size_t i = 0; i < numSamples; ++i)
+                destination[i] = samples[i * numLanes + (size_t) lane];
+        }
+    }
+
+    std::shared_ptr<CoefficientService> service;
+    double sampleRate { 0.0 };
+
+    std::vector<Lane> lanes;
+    // lanes of track t are [firstLaneOfTrack[t], firstLaneOfTrack[t + 1])
+    std::vector<int> firstLaneOfTrack;
+    std::vector<CoefficientSet> trackSets;
+
+    std::vector<SosCascade<LaneGroup>> groups;
+    std::vector<LaneGroup> interleaved;
+};
@@ -0,0 +1,126 @@
+/*
+  ==============================================================================
+
+    MultichannelCascade.h
+
+    Runs any number of channels through one SosCascade by packing them into
+    the lanes of a juce::dsp::SIMDRegister (SSE, AVX or NEON, whatever the
+    target maps it to). All channels share the same coefficients, so a
+    group of lanes costs about as much as a single scalar channel and the
+    total cost grows per lane group instead of per channel.
+
+    Mono, stereo, 5.1, 7.1.4 or third order ambisonics (16 channels) all go
+    through the same code, unused lanes of the last group simply carry
+    silence.
+
+    SampleType is float or double; a double register has half as many
+    lanes, so the double path costs about twice as much per channel.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "SosCascade.h"
+
+template <typename SampleType>
+class MultichannelCascade
+{
+public:
+   #if JUCE_USE_SIMD
+    using LaneGroup = juce::dsp::SIMDRegister<SampleType>;
+    static constexpr size_t numLanes = LaneGroup::size();
+   #else
+    // no SIMD on this target, each channel gets its own group
+    using LaneGroup = SampleType;
+    static constexpr size_t numLanes = 1;
+   #endif
+
+    // allocates the state and the interleaving scratch, not real-time safe
+    void prepare(int numChannelsToUse, int maximumBlockSize)
+    {
+        numChannels = juce::jmax(1, numChannelsToUse);
+        numGroups = (numChannels + (int) numLanes - 1) / (int) numLanes;
+
+        cascade.prepare(numGroups);
+        interleaved.assign((size_t) juce::jmax(1, maximumBlockSize), LaneGroup(SampleType(0)));
+    }
+
+    void reset() noexcept { cascade.reset(); }
+
+    void setCoefficients(const CoefficientSet& coefficientSet) noexcept
+    {
+        cascade.setCoefficients(coefficientSet);
+    }
+
+    int getNumLaneGroups() const noexcept { return numGroups; }
+
+    // filters every channel of the block in place
+    void process(juce::dsp::AudioBlock<SampleType>& block) noexcept
+    {
+        auto channelsToProcess = juce::jmin((int) block.getNumChannels(), numChannels);
+        auto numSamples = block.getNumSamples();
+
+        // hosts may send bigger blocks than announced, we then work
+        // through them in chunks that fit the scratch buffer
+        for (size_t start = 0; start < numSamples; start += interleaved.size())
+        {
+            auto chunk = juce::jmin(interleaved.size(), numSamples - start);
+
+            for (int group = 0; group * (int) numLanes < channelsToProcess; ++group)
+            {
+                auto firstChannel = group * (int) numLanes;
+                auto groupChannels = juce::jmin((int) numLanes, channelsToProcess - firstChannel);
+
+                interleave(block, firstChannel, groupChannels, start, chunk);
+                cascade.process(interleaved.data(), chunk, group);
+                deinterleave(block, firstChannel, groupChannels, start, chunk);
+            }
+        }
+    }
+
+private:
+    // the register array seen as plain samples, lane l of sample i is at [i * numLanes + l]
+    SampleType* getInterleavedSamples() noexcept { return reinterpret_cast<SampleType*>(interleaved.data()); }
+
+    void interleave(const juce::dsp::AudioBlock<SampleType>& block, int firstChannel, int groupChannels,
+                    size_t start, size_t numSamples) noexcept
+    {
+        auto* lanes = getInterleavedSamples();
+
+        for (int lane = 0; lane < (int) numLanes; ++lane)
+        {
+            if (lane < groupChannels)
+            {
+                auto* source = block.getChannelPointer((size_t) (firstChannel + lane)) + start;
+
+                for (size_t i = 0; i < numSamples; ++i)
+                    lanes[i * numLanes + (size_t) lane] = source[i];
+            }
+            else
+            {
+                for (size_t i = 0; i < numSamples; ++i)
+                    lanes[i * numLanes + (size_t) lane] = SampleType(0);
+            }
+        }
+    }
+
+    void deinterleave(juce::dsp::AudioBlock<SampleType>& block, int firstChannel, int groupChannels,
+                      size_t start, size_t numSamples) noexcept
+    {
+        auto* lanes = getInterleavedSamples();
+
+        for (int lane = 0; lane < groupChannels; ++lane)
+        {
+            auto* destination = block.getChannelPointer((size_t) (firstChannel + lane)) + start;
+
+            for (size_t i = 0; i < numSamples; ++i)
+                destination[i] = lanes[i * numLanes + (size_t) lane];
+        }
+    }
+
+    SosCascade<LaneGroup> cascade;
+    std::vector<LaneGroup> interleaved;
+    int numChannels { 0 }, numGroups { 0 };
+};
@@ -0,0 +1,55 @@
+/*
+  ==============================================================================
+
+    ParameterSnapshot.cpp
+
+  ==============================================================================
+*/
+
+#include "ParameterSnapshot.h"
+
+ParameterSnapshot::ParameterSnapshot(juce::AudioProcessorValueTreeState& apvts, const juce::String& parameterPrefix)
+    : lowCutFreq(apvts.getRawParameterValue(parameterPrefix + "LowCut Freq")),
+      highCutFreq(apvts.getRawParameterValue(parameterPrefix + "HighCut Freq")),
+      peakFreq(apvts.getRawParameterValue(parameterPrefix + "Peak Freq")),
+      peakGain(apvts.getRawParameterValue(parameterPrefix + "Peak Gain")),
+      peakQuality(apvts.getRawParameterValue(parameterPrefix + "Peak Quality")),
+      lowCutSlope(apvts.getRawParameterValue(parameterPrefix + "LowCut Slope")),
+      highCutSlope(apvts.getRawParameterValue(parameterPrefix + "HighCut Slope"))
+{
+    // every parameter must exist in createParameterLayout()
+    jassert(lowCutFreq != nullptr && highCutFreq != nullptr
+            && peakFreq != nullptr && peakGain != nullptr && peakQuality != nullptr
+            && lowCutSlope != nullptr && highCutSlope != nullptr);
+}
+
+int ParameterSnapshot::update() noexcept
+{
+    ChainSettings latest;
+
+    latest.lowCutFreq = lowCutFreq->load();
+    latest.highCutFreq = highCutFreq->load();
+    latest.peakFreq = peakFreq->load();
+    latest.peakGainInDecibles = peakGain->load();
+    latest.peakQuality = peakQuality->load();
+    latest.lowCutSlope = static_cast<Slope>(lowCutSlope->load());
+    latest.highCutSlope = static_cast<Slope>(highCutSlope->load());
+
+    int dirtyBands = forceAllBands.exchange(false) ? AllBands : 0;
+
+    // exact comparison is intended: we only care whether the host or GUI
+    // wrote a different value, not how close it is
+    if (latest.lowCutFreq != settings.lowCutFreq || latest.lowCutSlope != settings.lowCutSlope)
+        dirtyBands |= LowCutBand;
+
+    if (latest.peakFreq != settings.peakFreq
+        || latest.peakGainInDecibles != settings.peakGainInDecibles
+        || latest.peakQuality != settings.peakQuality)
+        dirtyBands |= PeakBand;
+
+    if (latest.highCutFreq != settings.highCutFreq || latest.highCutSlope != settings.highCutSlope)
+        dirtyBands |= HighCutBand;
+
+    settings = latest;
+    return dirtyBands;
+}
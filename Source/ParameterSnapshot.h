@@ -0,0 +1,58 @@
+/*
+  ==============================================================================
+
+    ParameterSnapshot.h
+
+    Caches the raw parameter pointers of the apvts once and keeps track of
+    which eq bands changed since the filters were last designed, so that
+    untouched bands are never redesigned.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "ChainSettings.h"
+
+// one bit per band of the eq, used to report which bands need a redesign
+enum BandFlags
+{
+    LowCutBand  = 1 << 0,
+    PeakBand    = 1 << 1,
+    HighCutBand = 1 << 2,
+    AllBands    = LowCutBand | PeakBand | HighCutBand
+};
+
+class ParameterSnapshot
+{
+public:
+    // looks up every parameter by its string ID once, the prefix picks
+    // the second set of the dual stereo modes (see StereoMode)
+    explicit ParameterSnapshot(juce::AudioProcessorValueTreeState& apvts, const juce::String& parameterPrefix = {});
+
+    // reads the cached parameters and returns the BandFlags of every band
+    // whose values differ from the previous call (0 if no knob has moved)
+    int update() noexcept;
+
+    // forces the next update() to report every band as dirty,
+    // e.g. after the sample rate changed
+    void invalidate() noexcept { forceAllBands.store(true); }
+
+    // settings read by the last update()
+    const ChainSettings& getSettings() const noexcept { return settings; }
+
+private:
+    std::atomic<float>* lowCutFreq { nullptr };
+    std::atomic<float>* highCutFreq { nullptr };
+    std::atomic<float>* peakFreq { nullptr };
+    std::atomic<float>* peakGain { nullptr };
+    std::atomic<float>* peakQuality { nullptr };
+    std::atomic<float>* lowCutSlope { nullptr };
+    std::atomic<float>* highCutSlope { nullptr };
+
+    ChainSettings settings;
+    std::atomic<bool> forceAllBands { true };
+
+    JUCE_DECLARE_NON_COPYABLE (ParameterSnapshot)
+};
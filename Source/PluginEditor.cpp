@@ -9,6 +9,229 @@
 #include "PluginProcessor.h"
 #include "PluginEditor.h"
 
+//==============================================================================
+ResponseCurveComponent::ResponseCurveComponent(SimpleeqAudioProcessor& p) : audioProcessor(p)
+{
+    // listen to every parameter, any of them changes the curve
+    for (auto* param : audioProcessor.getParameters())
+        param->addListener(this);
+    
+    // nothing shows through, so the editor behind us is not repainted
+    setOpaque(true);
+    
+    // the analyser only runs while we are open
+    audioProcessor.getAnalyser().setActive(true);
+    
+    startTimerHz(30);
+}
+
+ResponseCurveComponent::~ResponseCurveComponent()
+{
+    for (auto* param : audioProcessor.getParameters())
+        param->removeListener(this);
+    
+    audioProcessor.getAnalyser().setActive(false);
+}
+
+void ResponseCurveComponent::parameterValueChanged(int parameterIndex, float newValue)
+{
+    juce::ignoreUnused(parameterIndex, newValue);
+    parametersChanged.set(true);
+}
+
+void ResponseCurveComponent::timerCallback()
+{
+    // the host may prepare the processor at a new rate while we are open
+    auto sampleRateChanged = getDisplaySampleRate() != magnitudeResponse.getSampleRate();
+    
+    // the engine and the bus decide whether a second curve shows, and
+    // the dynamic peak moves without any parameter moving
+    auto stereoModeChanged = audioProcessor.getActiveStereoMode() != shownStereoMode;
+    auto dynamicGainMoved = dynamicPeakParameters.getSettings().enabled
+                         && std::abs(audioProcessor.getDynamicPeakGainInDecibels() - shownDynamicGain) >= 0.1f;
+    
+    if (parametersChanged.compareAndSetBool(false, true) || sampleRateChanged || stereoModeChanged || dynamicGainMoved)
+    {
+        updateResponseCurve();
+        
+        // signal a repaint
+        repaint();
+    }
+    
+    // the analyser thread has already built the paths, we only swap them in
+    if (auto* newSpectrum = audioProcessor.getAnalyser().acquireSpectrum())
+    {
+        spectrum = newSpectrum;
+        repaint();
+    }
+}
+
+double ResponseCurveComponent::getDisplaySampleRate() const
+{
+    auto sampleRate = audioProcessor.getSampleRate();
+    return sampleRate > 0.0 ? sampleRate : 48000.0;
+}
+
+void ResponseCurveComponent::updateResponseCurve()
+{
+    auto width = getLocalBounds().getWidth();
+    
+    if (width <= 0)
+        return;
+    
+    auto sampleRate = getDisplaySampleRate();
+    
+    // every bank band has to be redesigned at a new rate
+    if (magnitudeResponse.getSampleRate() != sampleRate)
+        bandParameters.invalidate();
+    
+    // one point per pixel column
+    if (magnitudeResponse.getNumPoints() != width || magnitudeResponse.getSampleRate() != sampleRate)
+        magnitudeResponse.setFrequencies(width, sampleRate);
+    
+    if (cutTable == nullptr || cutTable->getSampleRate() != sampleRate)
+        cutTable = CutCoefficientTable::getFor(sampleRate);
+    
+    mainParameters.update();
+    rightSideParameters.update();
+    dynamicPeakParameters.update();
+    
+    auto changedBands = bandParameters.update();
+    
+    for (int band = 0; band < bandParameters.getNumBands(); ++band)
+        if ((changedBands >> band) & 1)
+            bankSections[(size_t) band] = CoefficientDesigner::designBand(bandParameters.getSettings(band), sampleRate);
+    
+    shownStereoMode = audioProcessor.getActiveStereoMode();
+    shownDynamicGain = audioProcessor.getDynamicPeakGainInDecibels();
+    
+    buildCurve(responseCurve, mainParameters.getSettings(), sampleRate, true);
+    
+    if (shownStereoMode != StereoMode::Linked)
+        buildCurve(rightSideCurve, rightSideParameters.getSettings(), sampleRate, false);
+    else
+        rightSideCurve.clear();
+}
+
+void ResponseCurveComponent::buildCurve(juce::Path& curve, const ChainSettings& chainSettings, double sampleRate,
+                                        bool hasDynamicPeak)
+{
+    using namespace juce;
+    
+    auto bounds = getLocalBounds();
+    
+    // the same designs the processor runs, so the curve shows what is
+    // heard, including bands that are switched off. The dynamic peak only
+    // replaces the peak of the main set, the bank runs after either set
+    // on every channel, so both curves get it
+    const auto& dynamicPeak = dynamicPeakParameters.getSettings();
+    
+    CoefficientSet coefficientSet;
+    coefficientSet.sampleRate = sampleRate;
+    coefficientSet.lowCut = CoefficientDesigner::designLowCut(chainSettings, *cutTable);
+    coefficientSet.peak = hasDynamicPeak && dynamicPeak.enabled ? CoefficientDesigner::designDynamicPeak(dynamicPeak, shownDynamicGain, sampleRate)
+                                                                : CoefficientDesigner::designPeak(chainSettings, sampleRate);
+    coefficientSet.highCut = CoefficientDesigner::designHighCut(chainSettings, *cutTable);
+    
+    magnitudeResponse.compute(coefficientSet, bankSections.data(), bandParameters.getNumBands());
+    const auto& mags = magnitudeResponse.getDecibels();
+    
+    const double outputMin = bounds.getBottom();
+    const double outputMax = bounds.getY();
+    
+    auto map = [outputMin, outputMax](double input)
+    {
+        return jmap(jlimit(-48.0, 48.0, input), -24.0, 24.0, outputMin, outputMax);
+    };
+    
+    curve.clear();
+    curve.preallocateSpace(3 * (int) mags.size());
+    curve.startNewSubPath((float) bounds.getX(), (float) map(mags.front()));
+    
+    for ( size_t i = 1; i < mags.size(); i++ )
+    {
+        curve.lineTo((float) (bounds.getX() + (int) i), (float) map(mags[i]));
+    }
+}
+
+void ResponseCurveComponent::drawBackground()
+{
+    using namespace juce;
+    
+    auto bounds = getLocalBounds();
+    
+    if (bounds.isEmpty())
+    {
+        background = {};
+        return;
+    }
+    
+    background = Image(Image::RGB, bounds.getWidth(), bounds.getHeight(), true);
+    Graphics g(background);
+    
+    // (Our component is opaque, so we must completely fill the background with a solid colour)
+    g.fillAll(Colours::black);
+    
+    // frequency grid, log spaced like the curve
+    g.setColour(Colours::dimgrey);
+    
+    for (auto freq : { 50.0, 100.0, 200.0, 500.0, 1000.0, 2000.0, 5000.0, 10000.0 })
+    {
+        auto x = bounds.getX() + (float) (mapFromLog10(freq, MagnitudeResponse::minFrequency, MagnitudeResponse::maxFrequency)
+                                          * bounds.getWidth());
+        g.drawVerticalLine(roundToInt(x), (float) bounds.getY(), (float) bounds.getBottom());
+    }
+    
+    // gain grid, every 12 dB
+    for (auto gain : { -12.f, 0.f, 12.f })
+    {
+        auto y = jmap(gain, -24.f, 24.f, (float) bounds.getBottom(), (float) bounds.getY());
+        g.setColour(gain == 0.f ? Colours::grey : Colours::dimgrey);
+        g.drawHorizontalLine(roundToInt(y), (float) bounds.getX(), (float) bounds.getRight());
+    }
+    
+    g.setColour(Colours::orange);
+    g.drawRoundedRectangle(bounds.toFloat(), 4.f, 1.f);
+}
+
+void ResponseCurveComponent::paint(juce::Graphics& g)
+{
+    using namespace juce;
+    
+    // every layer is cached, painting is a blit and a few strokes
+    g.drawImageAt(background, 0, 0);
+    
+    // the spectra come in a unit square, stretch them over the curve area
+    if (spectrum != nullptr)
+    {
+        auto bounds = getLocalBounds().toFloat();
+        auto toBounds = AffineTransform::scale(bounds.getWidth(), bounds.getHeight()).translated(bounds.getX(), bounds.getY());
+        
+        g.setColour(Colours::grey.withAlpha(0.6f));
+        g.strokePath(spectrum->preEq, PathStrokeType(1.f), toBounds);
+        g.setColour(Colours::skyblue.withAlpha(0.8f));
+        g.strokePath(spectrum->postEq, PathStrokeType(1.f), toBounds);
+    }
+    
+    // the right or side channel under the left or mid one
+    if (! rightSideCurve.isEmpty())
+    {
+        g.setColour(Colours::yellow.withAlpha(0.8f));
+        g.strokePath(rightSideCurve, PathStrokeType(2.f));
+    }
+    
+    g.setColour(Colours::white);
+    g.strokePath(responseCurve, PathStrokeType(2.f));
+}
+
+void ResponseCurveComponent::resized()
+{
+    // both layers depend on the size
+    drawBackground();
+    updateResponseCurve();
+}
+
+//==============================================================================
 //==============================================================================
 SimpleeqAudioProcessorEditor::SimpleeqAudioProcessorEditor (SimpleeqAudioProcessor& p)
     : AudioProcessorEditor (&p), audioProcessor (p),
@@ -18,7 +241,8 @@ SimpleeqAudioProcessorEditor::SimpleeqAudioProcessorEditor (SimpleeqAudioProcess
     lowCutFreqSliderAttachment(audioProcessor.apvts, "LowCut Freq", lowCutFreqSlider),
     highCutFreqSliderAttachment(audioProcessor.apvts, "HighCut Freq", highCutFreqSlider),
     lowCutSlopeSliderAttachment(audioProcessor.apvts, "LowCut Slope", lowCutSlopeSlider),
-    highCutSlopeSliderAttachment(audioProcessor.apvts, "HighCut Slope", highCutSlopeSlider)
+    highCutSlopeSliderAttachment(audioProcessor.apvts, "HighCut Slope", highCutSlopeSlider),
+    responseCurveComponent(audioProcessor)
 {
     // Gets components for the editor
     for (auto* comp : getComps())
@@ -40,66 +264,8 @@ void SimpleeqAudioProcessorEditor::paint (juce::Graphics& g)
 {
     using namespace juce;
     // (Our component is opaque, so we must completely fill the background with a solid colour)
+    // the response curve paints itself, see ResponseCurveComponent
     g.fillAll (Colours::black);
-
-    auto bounds = getBounds();
-    auto responseCurveArea = bounds.removeFromTop(bounds.getHeight() * 0.33);
-    auto width = responseCurveArea.getWidth();
-    auto& lowcut = monoChain.get<ChainPositions::LowCut>();
-    auto& peak = monoChain.get<ChainPositions::Peak>();
-    auto& highcut = monoChain.get<ChainPositions::HighCut>();
-    auto sampleRate = audioProcessor.getSampleRate();
-    
-    std::vector<double> mags;
-    mags.resize(width);
-    
-    for ( int i = 0; i < width; i++ )
-    {
-        double mag = 1.f;
-        auto freq = mapToLog10(double(i) / double(width), 20.0, 20000.0);
-        
-        if (! monoChain.isBypassed<ChainPositions::Peak>())
-            mag *= peak.coefficients->getMagnitudeForFrequency(freq, sampleRate);
-        if (! lowcut.isBypassed<0>())
-            mag *= lowcut.get<0>().coefficients->getMagnitudeForFrequency(freq, sampleRate);
-        if (! lowcut.isBypassed<1>())
-            mag *= lowcut.get<1>().coefficients->getMagnitudeForFrequency(freq, sampleRate);
-        if (! lowcut.isBypassed<2>())
-            mag *= lowcut.get<2>().coefficients->getMagnitudeForFrequency(freq, sampleRate);
-        if (! lowcut.isBypassed<3>())
-            mag *= lowcut.get<3>().coefficients->getMagnitudeForFrequency(freq, sampleRate);
-        if (! highcut.isBypassed<0>())
-            mag *= highcut.get<0>().coefficients->getMagnitudeForFrequency(freq, sampleRate);
-        if (! highcut.isBypassed<1>())
-            mag *= highcut.get<1>().coefficients->getMagnitudeForFrequency(freq, sampleRate);
-        if (! highcut.isBypassed<2>())
-            mag *= highcut.get<2>().coefficients->getMagnitudeForFrequency(freq, sampleRate);
-        if (! highcut.isBypassed<3>())
-            mag *= highcut.get<3>().coefficients->getMagnitudeForFrequency(freq, sampleRate);
-        
-        mags[i] = Decibels::gainToDecibels(mag);
-    }
-    
-    Path responseCurve;
-    const double outputMin = responseCurveArea.getBottom();
-    const double outputMax = responseCurveArea.getY();
-    
-    auto map = [outputMin, outputMax](double input)
-    {
-        return jmap(input, -24.0, 24.0, outputMin, outputMax);
-    };
-    
-    responseCurve.startNewSubPath(responseCurveArea.getX(), map(mags.front()));
-    
-    for ( int i = 1; i < mags.size(); i++ )
-    {
-        responseCurve.lineTo(responseCurveArea.getX() + i, map(mags[i]));
-    }
-    
-    g.setColour(Colours::orange);
-    g.drawRoundedRectangle(responseCurveArea.toFloat(), 4.f, 1.f);
-    g.setColour(Colours::white);
-    g.strokePath(responseCurve, PathStrokeType(2.f));
 }
 
 void SimpleeqAudioProcessorEditor::resized()
@@ -112,7 +278,7 @@ void SimpleeqAudioProcessorEditor::resized()
     // retrieve the bounds of GUI
     auto bounds = getBounds();
     // remove 33% of the area from top reserved for the response curve
-    bounds.removeFromTop(bounds.getHeight() * 0.33);
+    responseCurveComponent.setBounds(bounds.removeFromTop(bounds.getHeight() * 0.33));
     // remove 33% of area from left for low cut params
     auto lowCutArea = bounds.removeFromLeft(bounds.getWidth() * 0.33);
     // remove 50% of remaining area (which is 33 of total) for high cut params
@@ -128,20 +294,6 @@ void SimpleeqAudioProcessorEditor::resized()
     peakQualitySlider.setBounds(bounds);
 }
 
-void::SimpleeqAudioProcessorEditor::parameterValueChanged(int parameterIndex, float newValue)
-{
-    parametersChanged.set(true);
-};
-
-void::SimpleeqAudioProcessorEditor::timerCallback()
-{
-    if ( parametersChanged.compareAndSetBool(false, true) )
-    {
-        // update monochain from apvts
-        // signal a repaint
-    }
-};
-
 std::vector<juce::Component*> SimpleeqAudioProcessorEditor::getComps()
 {
     return
@@ -152,6 +304,7 @@ std::vector<juce::Component*> SimpleeqAudioProcessorEditor::getComps()
         &lowCutFreqSlider,
         &highCutFreqSlider,
         &lowCutSlopeSlider,
-        &highCutSlopeSlider
+        &highCutSlopeSlider,
+        &responseCurveComponent
     };
 }
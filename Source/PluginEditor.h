@@ -10,6 +10,7 @@
 
 #include <JuceHeader.h>
 #include "PluginProcessor.h"
+#include "MagnitudeResponse.h"
 
 struct CustomRotarySlider : juce::Slider
 {
@@ -20,12 +21,76 @@ struct CustomRotarySlider : juce::Slider
     }
 };
 
+// Draws the response curve of the current settings: the fixed bands,
+// the dynamic peak at the gain it applies right now and the filter bank,
+// plus a second curve for the right or side channel in the dual stereo
+// modes, with its static peak. The curve is only recomputed when a parameter (or the sample
+// rate, the stereo mode or the dynamic gain) changes: the parameter
+// listener sets a flag and the timer picks it up.
+// The grid is rendered into an image once per size and the curve is
+// kept as a Path, so an idle editor only checks a flag 30 times a second.
+struct ResponseCurveComponent : juce::Component,
+juce::AudioProcessorParameter::Listener,
+juce::Timer
+{
+    ResponseCurveComponent(SimpleeqAudioProcessor&);
+    ~ResponseCurveComponent() override;
+    
+    // can be called from any thread, including the audio thread
+    void parameterValueChanged (int parameterIndex, float newValue) override;
+    void parameterGestureChanged (int parameterIndex, bool gestureIsStarting) override { }
+    void timerCallback() override;
+    
+    void paint (juce::Graphics&) override;
+    void resized() override;
+    
+private:
+    SimpleeqAudioProcessor& audioProcessor;
+    
+    // atomic flag to decide if the curve needs to be updated
+    juce::Atomic<bool> parametersChanged { true };
+    
+    // designs the current settings the same way the processor does and
+    // rebuilds the cached curves
+    void updateResponseCurve();
+    
+    // the curve of one set of fixed bands and the bank, with the dynamic
+    // peak in place of the static one if the set has it
+    void buildCurve(juce::Path& curve, const ChainSettings& chainSettings, double sampleRate, bool hasDynamicPeak);
+    
+    // the static layer: background, grid and frame
+    void drawBackground();
+    
+    // the editor may be open before the host prepared the processor
+    double getDisplaySampleRate() const;
+    
+    MagnitudeResponse magnitudeResponse;
+    std::shared_ptr<const CutCoefficientTable> cutTable;
+    
+    // our own cached pointers, the processor's belong to its threads
+    ParameterSnapshot mainParameters { audioProcessor.apvts };
+    ParameterSnapshot rightSideParameters { audioProcessor.apvts, rightSideParameterPrefix };
+    DynamicPeakParameters dynamicPeakParameters { audioProcessor.apvts };
+    
+    // only the bank bands that moved are redesigned
+    BandParameters bandParameters { audioProcessor.apvts, SimpleeqAudioProcessor::numBankBands };
+    std::array<BiquadCoefficients, maxBankBands> bankSections;
+    
+    // what the curves were drawn for
+    StereoMode shownStereoMode { StereoMode::Linked };
+    float shownDynamicGain { 0.f };
+    
+    juce::Image background;
+    juce::Path responseCurve, rightSideCurve;
+    
+    // owned by the analyser, valid until the next acquireSpectrum()
+    const SpectrumAnalyser::Spectrum* spectrum { nullptr };
+};
+
 //==============================================================================
 /**
 */
-class SimpleeqAudioProcessorEditor  : public juce::AudioProcessorEditor,
-juce::AudioProcessorParameter::Listener,
-juce::Timer
+class SimpleeqAudioProcessorEditor  : public juce::AudioProcessorEditor
 {
 public:
     SimpleeqAudioProcessorEditor (SimpleeqAudioProcessor&);
@@ -34,18 +99,12 @@ public:
     //==============================================================================
     void paint (juce::Graphics&) override;
     void resized() override;
-    void parameterValueChanged (int parameterIndex, float newValue) override;
-    void parameterGestureChanged (int parameterIndex, bool gestureIsStarting) override { }
-    void timerCallback() override;
 
 private:
     // This reference is provided as a quick way for your editor to
     // access the processor object that created it.
     SimpleeqAudioProcessor& audioProcessor;
     
-    // atomic flag to decide if chain and component need to be updated
-    juce::Atomic<bool> parametersChanged { false };
-    
     // Sliders
     CustomRotarySlider peakFreqSlider,
                        peakGainSlider,
@@ -66,10 +125,9 @@ private:
                lowCutSlopeSliderAttachment,
                highCutSlopeSliderAttachment;
 
+    ResponseCurveComponent responseCurveComponent;
     
     std::vector<juce::Component*> getComps();
-    
-    MonoChain monoChain;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SimpleeqAudioProcessorEditor)
 };
@@ -16,12 +16,15 @@ SimpleeqAudioProcessor::SimpleeqAudioProcessor()
                      #if ! JucePlugin_IsMidiEffect
                       #if ! JucePlugin_IsSynth
                        .withInput  ("Input",  juce::AudioChannelSet::stereo(), true)
+                       // optional key input for the dynamic peak band
+                       .withInput  ("Sidechain", juce::AudioChannelSet::stereo(), false)
                       #endif
                        .withOutput ("Output", juce::AudioChannelSet::stereo(), true)
                      #endif
                        )
 #endif
 {
+    smoothedEngine.setProfiler(&profiler);
 }
 
 SimpleeqAudioProcessor::~SimpleeqAudioProcessor()
@@ -63,31 +66,44 @@ bool SimpleeqAudioProcessor::isMidiEffect() const
 
 double SimpleeqAudioProcessor::getTailLengthSeconds() const
 {
-    return 0.0;
+    // how long the current cut and peak designs ring after the input
+    // stops, so hosts can suspend us once it has passed
+    return tailLengthSeconds.load();
 }
 
+float SimpleeqAudioProcessor::getDynamicPeakGainInDecibels() const noexcept
+{
+    // only the engines of the processing precision run
+    return isUsingDoublePrecision() ? doubleEngines.dynamicPeak.getGainInDecibels()
+                                    : floatEngines.dynamicPeak.getGainInDecibels();
+}
+
+// the programs are the presets of the bank, see PresetBank.h
 int SimpleeqAudioProcessor::getNumPrograms()
 {
-    return 1;   // NB: some hosts don't cope very well if you tell them there are 0 programs,
-                // so this should be at least 1, even if you're not really implementing programs.
+    return juce::jmax(1, presetBank.size());   // NB: some hosts don't cope very well if you tell them there are 0 programs,
+                                               // so this should be at least 1, even if you're not really implementing programs.
 }
 
 int SimpleeqAudioProcessor::getCurrentProgram()
 {
-    return 0;
+    return currentPreset.load();
 }
 
 void SimpleeqAudioProcessor::setCurrentProgram (int index)
 {
+    recallPreset(index);
 }
 
 const juce::String SimpleeqAudioProcessor::getProgramName (int index)
 {
-    return {};
+    return presetBank.getName(index);
 }
 
 void SimpleeqAudioProcessor::changeProgramName (int index, const juce::String& newName)
 {
+    presetBank.setName(index, newName);
+    updateHostDisplay(juce::AudioProcessorListener::ChangeDetails().withProgramChanged(true));
 }
 
 //==============================================================================
@@ -111,18 +127,105 @@ void SimpleeqAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlo
     // assign sampleRate parameter to spec sampleRate attribute
     spec.sampleRate = sampleRate;
     
-    // pass spec to each chain to prepare for processing
-    leftChain.prepare(spec);
-    rightChain.prepare(spec);
+    // any layout with matching input and output is supported,
+    // so we need one mono chain per channel of the main bus
+    auto numChannels = getMainBusNumOutputChannels();
+    
+    // the sidechain only feeds the dynamic peak's detector
+    auto* sidechainBus = getBus(true, 1);
+    auto numSidechainChannels = sidechainBus != nullptr && sidechainBus->isEnabled() ? sidechainBus->getNumberOfChannels() : 0;
+    
+    // the host has already picked the precision it will call us with
+    if (isUsingDoublePrecision())
+    {
+        prepareEngines(doubleEngines, spec, numChannels, numSidechainChannels);
+        floatEngines.channelChains.clear();
+    }
+    else
+    {
+        prepareEngines(floatEngines, spec, numChannels, numSidechainChannels);
+        doubleEngines.channelChains.clear();
+    }
+    
+    smoothedEngine.prepare(sampleRate, numChannels, isUsingDoublePrecision());
+    activeEngine = requestedEngine.load();
+    
+    // the first block decides whether the peak runs dynamic, and the stereo mode
+    dynamicPeakEnabled = false;
+    dynamicPeakParameters.invalidate();
+    smoothedEngine.setPeakBypassed(false);
+    stereoMode = StereoMode::Linked;
+    numMainChannels = numChannels;
+    
+    // design every band for this sample rate before the first block
+    // and start the background designer
+    coefficientDesigner.prepare(sampleRate);
+    rightSideDesigner.prepare(sampleRate);
+    
+    // the presets' sets too, a recall still on its way was designed for
+    // the old rate and is dropped
+    presetBank.prepare(sampleRate);
+    presetRecalls.acquire();
     
-    // helper function to get apvts and update filters
+    // the linear phase kernel starts from the same set, designed right here
+    linearPhase.prepare(sampleRate, numChannels, coefficientDesigner.getCurrentCoefficients());
+    setLatencySamples(getLatencyInSamples(activeEngine));
+    
+    analyser.prepare(sampleRate);
+    
+    silentSamples = 0;
+    sleeping.store(false);
+    
+    midiAutomation.reset();
+    hasSampleAccurateDesign = false;
+    
+    // every band of the bank is designed for the new sample rate on the first block
+    bandParameters.invalidate();
+    bankTailInSamples = 0;
+    
+    // helper function to pick up the designed coefficients
     updateFilters();
 }
 
+template <typename SampleType>
+void SimpleeqAudioProcessor::prepareEngines(Engines<SampleType>& engines, const juce::dsp::ProcessSpec& spec, int numChannels, int numSidechainChannels)
+{
+    engines.channelChains.clear();
+    for (int channel = 0; channel < numChannels; ++channel)
+        engines.channelChains.add(new MonoChainType<SampleType>());
+    
+    for (auto* chain : engines.channelChains)
+    {
+        // give every filter its own second order coefficients up front,
+        // the audio thread then only overwrites their values
+        auto allocate = [](FilterType<SampleType>& filter)
+        {
+            filter.coefficients = new juce::dsp::IIR::Coefficients<SampleType>(1, 0, 0, 1, 0, 0);
+        };
+        
+        forEachCutStage(chain->template get<ChainPositions::LowCut>(), allocate, std::make_integer_sequence<int, maxCutSections>());
+        allocate(chain->template get<ChainPositions::Peak>());
+        forEachCutStage(chain->template get<ChainPositions::HighCut>(), allocate, std::make_integer_sequence<int, maxCutSections>());
+        
+        // pass spec to each chain to prepare for processing
+        chain->prepare(spec);
+    }
+    
+    // the fused engines keep the state of all channels themselves
+    engines.cascade.prepare(numChannels);
+    engines.multichannelCascade.prepare(numChannels, (int) spec.maximumBlockSize);
+    engines.dynamicPeak.prepare(spec.sampleRate, numChannels, numSidechainChannels);
+    engines.filterBank.prepare(numBankBands, numChannels);
+    engines.stereoCascade.prepare((int) spec.maximumBlockSize);
+}
+
 void SimpleeqAudioProcessor::releaseResources()
 {
     // When playback stops, you can use this as an opportunity to free up any
     // spare memory, etc.
+    coefficientDesigner.release();
+    rightSideDesigner.release();
+    linearPhase.release();
 }
 
 #ifndef JucePlugin_PreferredChannelConfigurations
@@ -133,11 +236,9 @@ bool SimpleeqAudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts)
     return true;
   #else
     // This is the place where you check if the layout is supported.
-    // In this template code we only support mono or stereo.
-    // Some plugin hosts, such as certain GarageBand versions, will only
-    // load plugins that support stereo bus layouts.
-    if (layouts.getMainOutputChannelSet() != juce::AudioChannelSet::mono()
-     && layouts.getMainOutputChannelSet() != juce::AudioChannelSet::stereo())
+    // Every engine works on any number of channels, so we take mono,
+    // stereo, surround (5.1, 7.1.4...) and ambisonic layouts alike.
+    if (layouts.getMainOutputChannelSet().isDisabled())
         return false;
 
     // This checks if the input layout matches the output layout
@@ -146,6 +247,8 @@ bool SimpleeqAudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts)
         return false;
    #endif
 
+    // the sidechain may be off or have any layout, the detector
+    // listens to all of its channels
     return true;
   #endif
 }
@@ -154,8 +257,50 @@ bool SimpleeqAudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts)
 // This function is called by the host and given a buffer
 // which can have any number of channels
 void SimpleeqAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
+{
+    process(buffer, midiMessages, floatEngines);
+}
+
+bool SimpleeqAudioProcessor::supportsDoublePrecisionProcessing() const
+{
+    return true;
+}
+
+// the same processing on the host's 64 bit buffers, every filter state
+// and multiply is double here
+void SimpleeqAudioProcessor::processBlock (juce::AudioBuffer<double>& buffer, juce::MidiBuffer& midiMessages)
+{
+    process(buffer, midiMessages, doubleEngines);
+}
+
+template <typename SampleType>
+void SimpleeqAudioProcessor::resetEngine(Engines<SampleType>& engines, Engine engine) noexcept
+{
+    if (engine == Engine::SmoothedSvf)
+        smoothedEngine.reset();
+    else if (engine == Engine::LinearPhase)
+        linearPhase.reset();
+    else if (engine == Engine::SimdCascade)
+    {
+        engines.multichannelCascade.reset();
+        engines.stereoCascade.reset();
+    }
+    else if (engine == Engine::FusedCascade)
+    {
+        engines.cascade.reset();
+        engines.stereoCascade.reset();
+    }
+    else
+        for (auto* chain : engines.channelChains)
+            chain->reset();
+}
+
+template <typename SampleType>
+void SimpleeqAudioProcessor::process(juce::AudioBuffer<SampleType>& buffer, juce::MidiBuffer& midiMessages, Engines<SampleType>& engines) noexcept
 {
     juce::ScopedNoDenormals noDenormals;
+    profiler.beginBlock(buffer.getNumSamples(), getSampleRate());
+    
     auto totalNumInputChannels  = getTotalNumInputChannels();
     auto totalNumOutputChannels = getTotalNumOutputChannels();
 
@@ -168,29 +313,344 @@ void SimpleeqAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juc
     for (auto i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
         buffer.clear (i, 0, buffer.getNumSamples());
     
-    // helper function to get apvts and update filters
-    updateFilters();
+    // pick up coefficients published by the background designer
+    {
+        StageProfiler::ScopedStage stage(&profiler, StageProfiler::CoefficientUpdate);
+        updateFilters();
+        updateStereoMode(engines);
+        updateDynamicPeak(engines);
+        updateFilterBank(engines);
+    }
+    
+    // the engines only see the main bus, the sidechain is only listened to
+    auto mainBuffer = getBusBuffer(buffer, false, 0);
+    juce::dsp::AudioBlock<SampleType> sidechainBlock;
+    
+    if (auto* sidechainBus = getBus(true, 1))
+        if (sidechainBus->getNumberOfChannels() > 0)
+            sidechainBlock = juce::dsp::AudioBlock<SampleType>(buffer).getSubsetChannelBlock((size_t) getChannelIndexInProcessBlockBuffer(true, 1, 0),
+                                                                                             (size_t) sidechainBus->getNumberOfChannels());
+    
+    // the engine we switch to still holds the state of the last time it ran
+    auto engine = requestedEngine.load();
+    if (engine != activeEngine)
+    {
+        resetEngine(engines, engine);
+        activeEngine = engine;
+        
+        // the linear phase kernel only follows the sets while it runs,
+        // and its tail is the kernel's rather than the biquads'
+        applyLoadedCoefficients();
+    }
+    
+    activeStereoMode.store(runsDualStereo() ? stereoMode : StereoMode::Linked);
+    
+    // the analyser only runs while the editor is open, otherwise
+    // this one flag check is all it costs
+    auto analyse = analyser.isActive();
+    
+    if (analyse)
+    {
+        StageProfiler::ScopedStage stage(&profiler, StageProfiler::AnalyserTaps);
+        analyser.push(SpectrumAnalyser::PreEq, mainBuffer);
+    }
+    
+    // most tracks of a big session are silent most of the time. Once the
+    // input has been silent for as long as the filters ring, what they
+    // still put out is below the threshold too, so we clear them and skip
+    // filtering until signal returns
+    auto inputIsSilent = sleepWhenSilent.load()
+                      && mainBuffer.getMagnitude(0, mainBuffer.getNumSamples()) <= static_cast<SampleType>(silenceThreshold);
+    
+    if (! inputIsSilent)
+    {
+        silentSamples = 0;
+        sleeping.store(false);
+    }
+    
+    // in order to run audio through our engines we wrap the
+    // AudioBuffer in an AudioBlock
+    juce::dsp::AudioBlock<SampleType> block(mainBuffer);
+    auto asleep = sleeping.load();
+    
+    // sample accurate automation: the block is split where a controller
+    // moves a parameter (see MidiAutomation.h) and the new filters take
+    // over on that very sample. Without controllers this is the single
+    // pass over the whole block it always was
+    size_t segmentStart = 0;
+    
+    for (const auto metadata : midiMessages)
+    {
+        MidiAutomation::Change change;
+        
+        if (! midiAutomation.handle(metadata.data, metadata.numBytes, change))
+            continue;
+        
+        auto position = (size_t) juce::jlimit(0, buffer.getNumSamples(), metadata.samplePosition);
+        
+        if (position > segmentStart)
+        {
+            if (! asleep)
+            {
+                auto segment = block.getSubBlock(segmentStart, position - segmentStart);
+                runSegment(segment, sidechainBlock, segmentStart, engines);
+            }
+            
+            segmentStart = position;
+        }
+        
+        StageProfiler::ScopedStage stage(&profiler, StageProfiler::CoefficientUpdate);
+        applyParameterChange(change);
+    }
+    
+    if (! asleep)
+    {
+        if (segmentStart < block.getNumSamples())
+        {
+            auto segment = block.getSubBlock(segmentStart, block.getNumSamples() - segmentStart);
+            runSegment(segment, sidechainBlock, segmentStart, engines);
+        }
+        
+        if (inputIsSilent)
+        {
+            silentSamples = juce::jmin(silentSamples + buffer.getNumSamples(), tailLengthInSamples);
+            
+            if (silentSamples >= tailLengthInSamples)
+            {
+                resetEngine(engines, activeEngine);
+                engines.dynamicPeak.reset();
+                engines.filterBank.reset();
+                sleeping.store(true);
+            }
+        }
+    }
+    
+    if (analyse)
+    {
+        StageProfiler::ScopedStage stage(&profiler, StageProfiler::AnalyserTaps);
+        analyser.push(SpectrumAnalyser::PostEq, mainBuffer);
+    }
+    
+    profiler.endBlock();
+}
+
+template <typename SampleType>
+void SimpleeqAudioProcessor::runEngine(juce::dsp::AudioBlock<SampleType>& block, Engines<SampleType>& engines) noexcept
+{
+    // the smoothed engine designs its own filters on its sub-block grid,
+    // it times its stages itself
+    if (activeEngine == Engine::SmoothedSvf)
+    {
+        smoothedEngine.process(block);
+    }
+    // the linear phase engine convolves a partition at a time, whatever the block size
+    else if (activeEngine == Engine::LinearPhase)
+    {
+        StageProfiler::ScopedStage stage(&profiler, StageProfiler::Filtering);
+        linearPhase.process(block);
+    }
+    // in the dual stereo modes both cascades run the two sides in the
+    // lanes of one register, with the mid/side matrix in the same pass
+    else if (stereoMode != StereoMode::Linked
+             && (activeEngine == Engine::SimdCascade || activeEngine == Engine::FusedCascade))
+    {
+        StageProfiler::ScopedStage stage(&profiler, StageProfiler::Filtering);
+        engines.stereoCascade.process(block);
+    }
+    // the SIMD cascade filters groups of channels at once
+    else if (activeEngine == Engine::SimdCascade)
+    {
+        StageProfiler::ScopedStage stage(&profiler, StageProfiler::Filtering);
+        engines.multichannelCascade.process(block);
+    }
+    // the fused cascade runs each channel through every active biquad in one pass
+    else if (activeEngine == Engine::FusedCascade)
+    {
+        StageProfiler::ScopedStage stage(&profiler, StageProfiler::Filtering);
+        engines.cascade.process(block);
+    }
+    else
+    {
+        // the ProcessorChain processes a ProcessContext instance
+        // in order to run audio through the links in the chain
+        auto numChannels = juce::jmin((int) block.getNumChannels(), engines.channelChains.size());
+        
+        // the chains are the reference, so mid/side takes passes of its own here
+        auto midSide = stereoMode == StereoMode::MidSide && numChannels == 2;
+        
+        if (midSide)
+            StereoCascade<SampleType>::encodeMidSide(block.getChannelPointer(0), block.getChannelPointer(1), block.getNumSamples());
+        
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            // We need to extract each channel from the buffer
+            // which will be wrapped inside its own block
+            auto channelBlock = block.getSingleChannelBlock((size_t) channel);
+            
+            // create processing context to wrap the audio block for the channel
+            juce::dsp::ProcessContextReplacing<SampleType> context(channelBlock);
+            
+            // now pass the context through the links of the channel's
+            // mono filter chain one by one, so each band can be timed
+            auto& chain = *engines.channelChains.getUnchecked(channel);
+            
+            {
+                StageProfiler::ScopedStage stage(&profiler, StageProfiler::LowCut);
+                chain.template get<ChainPositions::LowCut>().process(context);
+            }
+            
+            if (! chain.template isBypassed<ChainPositions::Peak>())
+            {
+                StageProfiler::ScopedStage stage(&profiler, StageProfiler::Peak);
+                chain.template get<ChainPositions::Peak>().process(context);
+            }
+            
+            {
+                StageProfiler::ScopedStage stage(&profiler, StageProfiler::HighCut);
+                chain.template get<ChainPositions::HighCut>().process(context);
+            }
+        }
+        
+        if (midSide)
+            StereoCascade<SampleType>::decodeMidSide(block.getChannelPointer(0), block.getChannelPointer(1), block.getNumSamples());
+    }
+}
+
+template <typename SampleType>
+void SimpleeqAudioProcessor::runSegment(juce::dsp::AudioBlock<SampleType>& segment,
+                                        const juce::dsp::AudioBlock<SampleType>& sidechain, size_t segmentStart,
+                                        Engines<SampleType>& engines) noexcept
+{
+    runEngine(segment, engines);
+    
+    if (dynamicPeakEnabled)
+        runDynamicPeak(segment, sidechain, segmentStart, engines);
+    
+    // with every band bypassed the bank costs this one check
+    if (engines.filterBank.getNumLiveBands() > 0)
+    {
+        StageProfiler::ScopedStage stage(&profiler, StageProfiler::Bank);
+        engines.filterBank.process(segment);
+    }
+}
+
+template <typename SampleType>
+void SimpleeqAudioProcessor::runDynamicPeak(juce::dsp::AudioBlock<SampleType>& block,
+                                            const juce::dsp::AudioBlock<SampleType>& sidechain, size_t sidechainStart,
+                                            Engines<SampleType>& engines) noexcept
+{
+    // runs after whichever engine is active, which leaves its own peak out
+    StageProfiler::ScopedStage stage(&profiler, StageProfiler::DynamicBand);
+    
+    // without a sidechain the band listens to itself
+    juce::dsp::AudioBlock<SampleType> sidechainSegment;
     
-    // the ProcessorChain processes a ProcessContext instance
-    // in order to run audio through the links in the chain
+    if (sidechain.getNumChannels() > 0)
+        sidechainSegment = sidechain.getSubBlock(sidechainStart, block.getNumSamples());
+    
+    auto* detectorInput = sidechain.getNumChannels() > 0 ? &sidechainSegment : nullptr;
+    
+    if (! runsDualStereo())
+    {
+        engines.dynamicPeak.process(block, detectorInput);
+        return;
+    }
+    
+    // in the dual stereo modes the band only replaces the peak of the left
+    // or mid channel, the right or side one keeps the static peak of its
+    // set. Mid/side takes passes of its own, like in the ProcessorChain
+    auto midSide = stereoMode == StereoMode::MidSide;
+    
+    if (midSide)
+        StereoCascade<SampleType>::encodeMidSide(block.getChannelPointer(0), block.getChannelPointer(1), block.getNumSamples());
+    
+    auto firstChannel = block.getSingleChannelBlock(0);
+    engines.dynamicPeak.process(firstChannel, detectorInput);
+    
+    if (midSide)
+        StereoCascade<SampleType>::decodeMidSide(block.getChannelPointer(0), block.getChannelPointer(1), block.getNumSamples());
+}
 
-    // in order to make a ProcessContext, we need to supply it
-    // with an AudioBlock instance which are constructed
-    // with AudioBuffers
-    juce::dsp::AudioBlock<float> block(buffer);
-    // We need to extract left and right channels (0, 1) from the buffer
-    // which will be wrapped inside more blocks
-    auto leftBlock = block.getSingleChannelBlock(0);
-    auto rightBlock = block.getSingleChannelBlock(1);
+template <typename SampleType>
+void SimpleeqAudioProcessor::updateDynamicPeak(Engines<SampleType>& engines) noexcept
+{
+    if (! dynamicPeakParameters.update())
+        return;
     
-    // create processing context to wrap each audio block for the channels
-    juce::dsp::ProcessContextReplacing<float> leftContext(leftBlock);
-    juce::dsp::ProcessContextReplacing<float> rightContext(rightBlock);
+    const auto& settings = dynamicPeakParameters.getSettings();
+    
+    if (settings.enabled != dynamicPeakEnabled)
+    {
+        dynamicPeakEnabled = settings.enabled;
+        
+        // the static peak drops out of (or comes back into) every engine
+        smoothedEngine.setPeakBypassed(dynamicPeakEnabled);
+        applyLoadedCoefficients();
+        
+        if (dynamicPeakEnabled)
+            engines.dynamicPeak.reset();
+    }
     
-    // now pass contexts to mono filter chains
-    leftChain.process(leftContext);
-    rightChain.process(rightContext);
+    // only redesigns the band when its frequency or quality moved
+    if (dynamicPeakEnabled)
+        engines.dynamicPeak.setSettings(settings);
+}
+
+bool SimpleeqAudioProcessor::runsDualStereo() const noexcept
+{
+    // the smoothed and linear phase engines stay linked whatever the mode
+    return stereoMode != StereoMode::Linked
+        && (activeEngine == Engine::ProcessorChain || activeEngine == Engine::FusedCascade || activeEngine == Engine::SimdCascade);
+}
+
+template <typename SampleType>
+void SimpleeqAudioProcessor::updateStereoMode(Engines<SampleType>& engines) noexcept
+{
+    // mid/side and left/right only mean something on two channels
+    auto mode = numMainChannels == 2 ? static_cast<StereoMode>(juce::roundToInt(stereoModeParameter->load()))
+                                     : StereoMode::Linked;
+    
+    if (mode == stereoMode)
+        return;
+    
+    stereoMode = mode;
+    
+    if (stereoMode != StereoMode::Linked)
+        engines.stereoCascade.setMode(stereoMode);
+    
+    // what the filters hold no longer matches the signal they get
+    resetEngine(engines, activeEngine);
+    applyLoadedCoefficients();
+}
 
+template <typename SampleType>
+void SimpleeqAudioProcessor::updateFilterBank(Engines<SampleType>& engines) noexcept
+{
+    // a few cookbook biquads for the bands that moved, which neither
+    // locks nor allocates, like the sample accurate designs
+    auto changedBands = bandParameters.update();
+    
+    if (changedBands == 0)
+        return;
+    
+    std::array<double, maxBankBands> radii;
+    int numLiveBands = 0;
+    
+    for (int band = 0; band < bandParameters.getNumBands(); ++band)
+    {
+        if ((changedBands >> band) & 1)
+        {
+            auto coefficients = CoefficientDesigner::designBand(bandParameters.getSettings(band), getSampleRate());
+            engines.filterBank.setBand(band, coefficients);
+            bankPoleRadii[(size_t) band] = coefficients.getPoleRadius();
+        }
+        
+        if (engines.filterBank.isLive(band))
+            radii[(size_t) numLiveBands++] = bankPoleRadii[(size_t) band];
+    }
+    
+    bankTailInSamples = getDecayLengthInSamples(radii.data(), numLiveBands, silenceThreshold);
+    updateTailLength();
 }
 
 //==============================================================================
@@ -216,9 +676,9 @@ void SimpleeqAudioProcessor::getStateInformation (juce::MemoryBlock& destData)
     // You could do that either as raw data, or use the XML or ValueTree classes
     // as intermediaries to make it easy to save and load complex data.
     
-    // Writes plugin state to memory
-    juce::MemoryOutputStream memoryOutputStream(destData, true);
-    apvts.state.writeToStream(memoryOutputStream);
+    // Writes plugin state to memory, in the compact format of
+    // PluginState.h: 8 bytes per parameter instead of the whole apvts tree
+    pluginState.write(pluginState.capture(), destData);
 }
 
 void SimpleeqAudioProcessor::setStateInformation (const void* data, int sizeInBytes)
@@ -226,14 +686,72 @@ void SimpleeqAudioProcessor::setStateInformation (const void* data, int sizeInBy
     // You should use this method to restore your parameters from this memory block,
     // whose contents will have been created by the getStateInformation() call.
     
-    // Restore plugin state from memory
-    auto tree = juce::ValueTree::readFromData(data, sizeInBytes);
-    if (tree.isValid()) {
-        apvts.replaceState(tree);
-        updateFilters();
+    // Restore plugin state from memory. Sessions saved by earlier
+    // releases hold the apvts tree or XML, PluginState reads those too
+    PluginState::Values values;
+    
+    if (pluginState.read(data, (size_t) juce::jmax(0, sizeInBytes), values)) {
+        // only the parameters that differ move
+        pluginState.apply(values);
+        // we are on the message thread here, so we design right away and
+        // publish; the audio thread picks the new set up on its next block
+        coefficientDesigner.designChangedBands();
+        rightSideDesigner.designChangedBands();
     }
 }
 
+int SimpleeqAudioProcessor::storePreset(const juce::String& name)
+{
+    auto index = presetBank.add(name, pluginState.capture());
+    
+    // hosts only read the program list again when they are told
+    updateHostDisplay(juce::AudioProcessorListener::ChangeDetails().withProgramChanged(true));
+    
+    return index;
+}
+
+bool SimpleeqAudioProcessor::loadPresetLibrary(const juce::File& file, juce::String& error)
+{
+    if (! presetBank.loadLibrary(file, error))
+        return false;
+    
+    // the old index may be past the end of the new bank, or another preset
+    currentPreset.store(0);
+    updateHostDisplay(juce::AudioProcessorListener::ChangeDetails().withProgramChanged(true));
+    
+    return true;
+}
+
+bool SimpleeqAudioProcessor::recallPreset(int index)
+{
+    PresetBank::Preset preset;
+    
+    if (! presetBank.getPreset(index, preset))
+        return false;
+    
+    // sets designed for the rate we run at go straight to the audio
+    // thread. Otherwise the designers take over as for any other change
+    if (preset.coefficients != nullptr && presetBank.getSampleRate() == getSampleRate())
+    {
+        auto& recall = presetRecalls.getWriteBuffer();
+        recall.coefficients = *preset.coefficients;
+        recall.rightSideCoefficients = *preset.rightSideCoefficients;
+        presetRecalls.publish();
+    }
+    
+    pluginState.apply(preset.values);
+    
+    if (currentPreset.exchange(index) != index)
+        updateHostDisplay(juce::AudioProcessorListener::ChangeDetails().withProgramChanged(true));
+    
+    // the designers find the preset's sets in the service's cache, and
+    // whatever they were still designing for the old settings is dropped
+    coefficientDesigner.designChangedBands();
+    rightSideDesigner.designChangedBands();
+    
+    return true;
+}
+
 // Here we implement our ChainSettings helper function to get param values from
 // the APVTS
 ChainSettings getChainSettings(juce::AudioProcessorValueTreeState& apvts)
@@ -256,58 +774,172 @@ ChainSettings getChainSettings(juce::AudioProcessorValueTreeState& apvts)
     return settings;
 }
 
-void SimpleeqAudioProcessor::updatePeakFilter(const ChainSettings &chainSettings)
+DynamicPeakSettings getDynamicPeakSettings(juce::AudioProcessorValueTreeState& apvts)
 {
-    auto peakCoefficients = juce::dsp::IIR::Coefficients<float>::makePeakFilter(getSampleRate(),
-                                                                                chainSettings.peakFreq,
-                                                                                chainSettings.peakQuality,
-                                                                                juce::Decibels::decibelsToGain(chainSettings.peakGainInDecibles));
+    DynamicPeakSettings settings;
+    
+    settings.enabled = apvts.getRawParameterValue("Peak Dynamic")->load() > 0.5f;
+    settings.peakFreq = apvts.getRawParameterValue("Peak Freq")->load();
+    settings.peakGainInDecibles = apvts.getRawParameterValue("Peak Gain")->load();
+    settings.peakQuality = apvts.getRawParameterValue("Peak Quality")->load();
+    settings.thresholdInDecibels = apvts.getRawParameterValue("Peak Threshold")->load();
+    settings.ratio = apvts.getRawParameterValue("Peak Ratio")->load();
+    settings.attackMs = apvts.getRawParameterValue("Peak Attack")->load();
+    settings.releaseMs = apvts.getRawParameterValue("Peak Release")->load();
     
-    updateCoefficients(leftChain.get<ChainPositions::Peak>().coefficients, peakCoefficients);
-    updateCoefficients(rightChain.get<ChainPositions::Peak>().coefficients, peakCoefficients);
+    return settings;
+}
 
+template <typename SampleType>
+void SimpleeqAudioProcessor::applyCoefficients(Engines<SampleType>& engines, const CoefficientSet& coefficientSet,
+                                               const CoefficientSet& rightSideSet) noexcept
+{
+    auto dual = stereoMode != StereoMode::Linked;
+    
+    for (int channel = 0; channel < engines.channelChains.size(); ++channel)
+    {
+        auto* chain = engines.channelChains.getUnchecked(channel);
+        const auto& set = dual && channel == 1 ? rightSideSet : coefficientSet;
+        
+        updateCutFilter(chain->template get<ChainPositions::LowCut>(), set.lowCut);
+        updateCoefficients(chain->template get<ChainPositions::Peak>(), set.peak);
+        chain->template setBypassed<ChainPositions::Peak>(set.peak.isIdentity());
+        updateCutFilter(chain->template get<ChainPositions::HighCut>(), set.highCut);
+    }
+    
+    // keep the fused engines in sync too, so switching engines is instant
+    engines.cascade.setCoefficients(coefficientSet);
+    engines.multichannelCascade.setCoefficients(coefficientSet);
+    
+    if (dual)
+        engines.stereoCascade.setCoefficients(coefficientSet, rightSideSet);
 }
 
-void SimpleeqAudioProcessor::updateCoefficients(Coefficients &old, const Coefficients &replacements)
+void SimpleeqAudioProcessor::updateFilters()
 {
-    *old = *replacements;
+    // the coefficients are designed on a background thread, here we only
+    // pick up the newest set if one was published since the last block.
+    // This never locks or allocates.
+    if (auto* rightSideSet = rightSideDesigner.acquire())
+    {
+        loadedRightSideCoefficients = *rightSideSet;
+        
+        if (stereoMode != StereoMode::Linked)
+            applyLoadedCoefficients();
+    }
+    
+    if (auto* coefficientSet = coefficientDesigner.acquire())
+    {
+        // after a sample accurate change the designer may still deliver
+        // sets for settings from before it. As long as the parameters have
+        // not caught up with that change yet, or are where it left them,
+        // we already run the right filters
+        auto alreadyRunning = hasSampleAccurateDesign
+                              && (midiAutomation.hasPendingChanges()
+                                  || sampleAccurateKey == CoefficientService::DesignKey { getSampleRate(), readChainSettings() });
+        
+        if (! alreadyRunning)
+        {
+            hasSampleAccurateDesign = false;
+            loadCoefficients(*coefficientSet);
+        }
+    }
+    
+    // a recalled preset brings both sets along, they replace whatever the
+    // designers delivered before the recall. Swapping them in is a copy
+    // out of the triple buffer, nothing is designed here
+    if (auto* recall = presetRecalls.acquire())
+    {
+        hasSampleAccurateDesign = false;
+        loadedRightSideCoefficients = recall->rightSideCoefficients;
+        loadCoefficients(recall->coefficients);
+    }
+}
+
+void SimpleeqAudioProcessor::loadCoefficients(const CoefficientSet& coefficientSet) noexcept
+{
+    loadedCoefficients = coefficientSet;
+    applyLoadedCoefficients();
 }
 
-void SimpleeqAudioProcessor::updateLowCutFilters(const ChainSettings &chainSettings)
+void SimpleeqAudioProcessor::applyLoadedCoefficients() noexcept
 {
-    auto lowCutCoefficients = juce::dsp::FilterDesign<float>::designIIRHighpassHighOrderButterworthMethod(chainSettings.lowCutFreq,
-                                                                                                          getSampleRate(),
-                                                                                                          2 * (chainSettings.lowCutSlope + 1));
+    // in dynamic mode the DynamicPeak replaces the peak of the main set,
+    // the engines leave it out. The right or side set of the dual stereo
+    // modes keeps its static peak (see runDynamicPeak)
+    auto engineSet = loadedCoefficients;
+    
+    if (dynamicPeakEnabled)
+        engineSet.peak = {};
+    
+    // only the engines of the precision we were prepared for are in use
+    if (isUsingDoublePrecision())
+        applyCoefficients(doubleEngines, engineSet, loadedRightSideCoefficients);
+    else
+        applyCoefficients(floatEngines, engineSet, loadedRightSideCoefficients);
     
-    auto& leftLowCut = leftChain.get<ChainPositions::LowCut>();
-    auto& rightLowCut = rightChain.get<ChainPositions::LowCut>();
+    // the kernel is designed in the background and crossfades in once it is ready
+    if (activeEngine == Engine::LinearPhase)
+        linearPhase.setCoefficients(engineSet);
     
-    updateCutFilter(leftLowCut, lowCutCoefficients, chainSettings.lowCutSlope);
-    updateCutFilter(rightLowCut, lowCutCoefficients, chainSettings.lowCutSlope);
+    // how long the new filters ring, for sleeping and for the host. The
+    // kernel's response is over once it has gone through the delay line
+    if (activeEngine == Engine::LinearPhase)
+        mainTailInSamples = linearPhase.getTailLengthInSamples();
+    else if (stereoMode != StereoMode::Linked)
+        mainTailInSamples = juce::jmax(loadedCoefficients.getDecayLengthInSamples(silenceThreshold),
+                                       loadedRightSideCoefficients.getDecayLengthInSamples(silenceThreshold));
+    else
+        mainTailInSamples = loadedCoefficients.getDecayLengthInSamples(silenceThreshold);
+    
+    updateTailLength();
 }
 
-void SimpleeqAudioProcessor::updateHighCutFilters(const ChainSettings &chainSettings)
+void SimpleeqAudioProcessor::updateTailLength() noexcept
 {
-    auto highCutCoefficients = juce::dsp::FilterDesign<float>::designIIRLowpassHighOrderButterworthMethod(chainSettings.highCutFreq,
-                                                                                                          getSampleRate(),
-                                                                                                          2 * (chainSettings.highCutSlope + 1));
+    auto sampleRate = getSampleRate();
+    auto decayLength = juce::jmin((double) mainTailInSamples + (double) bankTailInSamples,
+                                  maxTailSeconds * sampleRate);
     
-    auto& leftHighCut = leftChain.get<ChainPositions::HighCut>();
-    auto& rightHighCut = rightChain.get<ChainPositions::HighCut>();
+    tailLengthInSamples = (int) decayLength;
+    tailLengthSeconds.store(sampleRate > 0.0 ? decayLength / sampleRate : 0.0);
+}
+
+void SimpleeqAudioProcessor::setEngine(Engine newEngine) noexcept
+{
+    requestedEngine.store(newEngine);
+    setLatencySamples(getLatencyInSamples(newEngine));
+}
 
-    updateCutFilter(leftHighCut, highCutCoefficients, chainSettings.highCutSlope);
-    updateCutFilter(rightHighCut, highCutCoefficients, chainSettings.highCutSlope);
+int SimpleeqAudioProcessor::getLatencyInSamples(Engine engine) const noexcept
+{
+    return engine == Engine::LinearPhase ? linearPhase.getLatencyInSamples() : 0;
 }
 
-void SimpleeqAudioProcessor::updateFilters()
+void SimpleeqAudioProcessor::applyParameterChange(const MidiAutomation::Change& change) noexcept
 {
-    auto chainSettings = getChainSettings(apvts);
+    // the parameters only hold the earlier changes once the message thread
+    // has handed them over, until then the last change's settings are newer
+    auto settings = hasSampleAccurateDesign && midiAutomation.hasPendingChanges() ? sampleAccurateKey.settings
+                                                                                  : readChainSettings();
+    midiAutomation.apply(change, settings);
+    
+    // the host, the editor and the background designer follow the parameter
+    // later, but the filters change right here. The design only looks up
+    // the cut table and computes the peak, it neither locks nor allocates
+    midiAutomation.post(change);
     
-    updateLowCutFilters(chainSettings);
-    updatePeakFilter(chainSettings);
-    updateHighCutFilters(chainSettings);
+    sampleAccurateKey = { getSampleRate(), settings };
+    hasSampleAccurateDesign = true;
+    loadCoefficients(coefficientDesigner.designNow(settings));
 }
 
+const ChainSettings& SimpleeqAudioProcessor::readChainSettings() noexcept
+{
+    // only the settings are of interest here, not which bands moved
+    automationSnapshot.update();
+    return automationSnapshot.getSettings();
+}
 
 // Here we call our createParameterLayout() function and return the layout
 juce::AudioProcessorValueTreeState::ParameterLayout SimpleeqAudioProcessor::createParameterLayout()
@@ -362,9 +994,10 @@ juce::AudioProcessorValueTreeState::ParameterLayout SimpleeqAudioProcessor::crea
     layout.add(std::make_unique<juce::AudioParameterFloat>("Peak Quality", "Peak Quality", juce::NormalisableRange<float>(0.f, 10.f, 0.05f, 1.f), 1.f));
     
     // LowCut and HighCut slopes (both filters will share the same slopes)
-    // Set up 4 choices: 12, 24, 36, 48 dB/octave slopes (12 dB/oct default)
+    // Set up 8 choices: 12, 24, 36, 48, 72, 96 dB/octave butterworth slopes
+    // and LR 24, LR 48 linkwitz-riley ones (12 dB/oct default)
     // Here we use AudioParameterChoice obj instead since we are choosing
-    // between 5 options instead of gliding through a stepped-range of options
+    // between 8 options instead of gliding through a stepped-range of options
     
     // juce::AudioParameterChoice()
     // @params
@@ -384,10 +1017,41 @@ juce::AudioProcessorValueTreeState::ParameterLayout SimpleeqAudioProcessor::crea
         stringArray.add(str);
     }
     
+    // then the steeper butterworths and the linkwitz-riley alignments,
+    // in the order of the Slope enum
+    stringArray.addArray(juce::StringArray { "72 dB/oct", "96 dB/oct", "LR 24 dB/oct", "LR 48 dB/oct" });
+    
     // add LowCut slope to layout
     layout.add(std::make_unique<juce::AudioParameterChoice>("LowCut Slope", "LowCut Slope", stringArray, 0));
     // add HighCut slope to layout
     layout.add(std::make_unique<juce::AudioParameterChoice>("HighCut Slope", "HighCut Slope", stringArray, 0));
+    
+    // dynamic peak (see DynamicPeak.h): when on, Peak Gain becomes the
+    // range the band moves by once its level passes the threshold
+    layout.add(std::make_unique<juce::AudioParameterBool>("Peak Dynamic", "Peak Dynamic", false));
+    layout.add(std::make_unique<juce::AudioParameterFloat>("Peak Threshold", "Peak Threshold", juce::NormalisableRange<float>(-60.f, 0.f, 0.5f, 1.f), -24.f));
+    layout.add(std::make_unique<juce::AudioParameterFloat>("Peak Ratio", "Peak Ratio", juce::NormalisableRange<float>(1.f, 20.f, 0.1f, 0.5f), 4.f));
+    // attack and release in ms
+    layout.add(std::make_unique<juce::AudioParameterFloat>("Peak Attack", "Peak Attack", juce::NormalisableRange<float>(0.1f, 200.f, 0.1f, 0.4f), 5.f));
+    layout.add(std::make_unique<juce::AudioParameterFloat>("Peak Release", "Peak Release", juce::NormalisableRange<float>(5.f, 2000.f, 1.f, 0.4f), 100.f));
+    
+    // the stereo mode and the second set of the fixed bands it uses for
+    // the right or side channel, "Right/Side LowCut Freq" and so on with
+    // the same ranges as the main set (see StereoMode)
+    layout.add(std::make_unique<juce::AudioParameterChoice>("Stereo Mode", "Stereo Mode", juce::StringArray { "Stereo", "Left/Right", "Mid/Side" }, 0));
+    
+    const juce::String rightSide { rightSideParameterPrefix };
+    layout.add(std::make_unique<juce::AudioParameterFloat>(rightSide + "LowCut Freq", rightSide + "LowCut Freq", juce::NormalisableRange<float>(20.f, 20000.f, 1.f, 0.25f), 20.f));
+    layout.add(std::make_unique<juce::AudioParameterFloat>(rightSide + "HighCut Freq", rightSide + "HighCut Freq", juce::NormalisableRange<float>(20.f, 20000.f, 1.f, 0.25f), 20000.f));
+    layout.add(std::make_unique<juce::AudioParameterFloat>(rightSide + "Peak Freq", rightSide + "Peak Freq", juce::NormalisableRange<float>(20.f, 20000.f, 1.f, 0.25f), 1000.f));
+    layout.add(std::make_unique<juce::AudioParameterFloat>(rightSide + "Peak Gain", rightSide + "Peak Gain", juce::NormalisableRange<float>(-24.f, 24.f, 0.5f, 1.f), 0.f));
+    layout.add(std::make_unique<juce::AudioParameterFloat>(rightSide + "Peak Quality", rightSide + "Peak Quality", juce::NormalisableRange<float>(0.f, 10.f, 0.05f, 1.f), 1.f));
+    layout.add(std::make_unique<juce::AudioParameterChoice>(rightSide + "LowCut Slope", rightSide + "LowCut Slope", stringArray, 0));
+    layout.add(std::make_unique<juce::AudioParameterChoice>(rightSide + "HighCut Slope", rightSide + "HighCut Slope", stringArray, 0));
+    
+    // the filter bank: Type, Freq, Gain, Quality and Bypass for each of
+    // its bands, "Band 1 Freq" and so on (see BandParameters.h)
+    BandParameters::addParameters(layout, numBankBands);
 
     
     // audio parameters are saved in layout and returned to the AudioProcessorTreeValueState constructor (in PluginProcessor.h)
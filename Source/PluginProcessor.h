@@ -9,36 +9,46 @@
 #pragma once
 
 #include <JuceHeader.h>
-
-// Cut filter slope dB/oct names
-enum Slope {
-    Slope_12,
-    Slope_24,
-    Slope_36,
-    Slope_48
-};
-
-// extract params values from AudioProcessorValueTreeState using data structure
-struct ChainSettings
-{
-    float peakFreq { 0 }, peakGainInDecibles { 0 }, peakQuality { 1.f };
-    float lowCutFreq { 0 }, highCutFreq { 0 };
-    Slope lowCutSlope { Slope::Slope_12 }, highCutSlope { Slope::Slope_12 };
-};
-
-// helper function that will pass params into the data structure
-ChainSettings getChainSettings(juce::AudioProcessorValueTreeState& apvts);
+#include "BandParameters.h"
+#include "ChainSettings.h"
+#include "CoefficientDesigner.h"
+#include "DynamicPeak.h"
+#include "DynamicPeakParameters.h"
+#include "FilterBank.h"
+#include "LinearPhaseEngine.h"
+#include "MidiAutomation.h"
+#include "MultichannelCascade.h"
+#include "ParameterSnapshot.h"
+#include "PluginState.h"
+#include "PresetBank.h"
+#include "SmoothedSvfEngine.h"
+#include "SpectrumAnalyser.h"
+#include "StageProfiler.h"
+#include "StereoCascade.h"
 
 // create alias for our normal filters (Peak/Parametric)
-using Filter = juce::dsp::IIR::Filter<float>;
+// the aliases are templated on the sample type, so the same chain
+// can run in float or in double precision
+template <typename SampleType>
+using FilterType = juce::dsp::IIR::Filter<SampleType>;
 
 // create alias for our cut filters
-// We chain 4 filters to the processor chain to represent each of the
-// optional cut filter slopes (12, 24, 36, 48 dB/oct)
-using CutFilter = juce::dsp::ProcessorChain<Filter, Filter, Filter, Filter>;
+// We chain 8 filters to the processor chain, one per biquad of the
+// steepest slope (96 dB/oct). A slope only runs the ones it needs, the
+// others are bypassed and cost a flag check per block
+template <typename SampleType>
+using CutFilterType = juce::dsp::ProcessorChain<FilterType<SampleType>, FilterType<SampleType>,
+                                                FilterType<SampleType>, FilterType<SampleType>,
+                                                FilterType<SampleType>, FilterType<SampleType>,
+                                                FilterType<SampleType>, FilterType<SampleType>>;
 
 // create a mono signal chain of our 3 filters (LowCut -> Peak -> HighCut
-using MonoChain = juce::dsp::ProcessorChain<CutFilter, Filter, CutFilter>;
+template <typename SampleType>
+using MonoChainType = juce::dsp::ProcessorChain<CutFilterType<SampleType>, FilterType<SampleType>, CutFilterType<SampleType>>;
+
+using Filter = FilterType<float>;
+using CutFilter = CutFilterType<float>;
+using MonoChain = MonoChainType<float>;
 
 enum ChainPositions
 {
@@ -67,6 +77,12 @@ public:
    #endif
 
     void processBlock (juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
+    
+    // hosts with a 64 bit mix bus can hand us their buffers directly
+    // instead of converting them to float and back. The host picks the
+    // precision before prepareToPlay, see setProcessingPrecision
+    bool supportsDoublePrecisionProcessing() const override;
+    void processBlock (juce::AudioBuffer<double>&, juce::MidiBuffer&) override;
 
     //==============================================================================
     juce::AudioProcessorEditor* createEditor() override;
@@ -109,64 +125,319 @@ public:
     // * Identifier = "Parameters"
     // * ParameterLayour = createParameterLayout()
     juce::AudioProcessorValueTreeState apvts {*this, nullptr, "Parameters", createParameterLayout()};
+    
+    // the filter engines the eq can run on
+    // * ProcessorChain: one juce::dsp::ProcessorChain per channel, one pass per biquad
+    // * FusedCascade: every active biquad in a single pass (see SosCascade.h)
+    // * SimdCascade: the fused cascade with channels packed into SIMD lanes
+    //   (see MultichannelCascade.h)
+    // * SmoothedSvf: zipper free automation, parameters are ramped and the
+    //   filters redesigned on a fixed sub-block grid (see SmoothedSvfEngine.h)
+    // * LinearPhase: the magnitude of the fixed bands as a linear phase FIR,
+    //   at the price of latency (see LinearPhaseEngine.h)
+    // The dual stereo modes (see StereoMode) run on the first three, the
+    // cascades both through the StereoCascade. The other two stay linked
+    enum class Engine
+    {
+        ProcessorChain,
+        FusedCascade,
+        SimdCascade,
+        SmoothedSvf,
+        LinearPhase
+    };
+    
+    // can be called from any thread, the switch happens at the next block.
+    // The latency reported to the host follows right away
+    void setEngine(Engine newEngine) noexcept;
+    Engine getEngine() const noexcept { return requestedEngine.load(); }
+    
+    // taps of the linear phase kernel, from the next prepareToPlay on
+    void setLinearPhaseKernelLength(int numTaps) noexcept { linearPhase.setKernelLength(numTaps); }
+    
+    // the coefficients the background designer produced last,
+    // e.g. to find out how long the filters ring. Not real-time safe.
+    CoefficientSet getDesignedCoefficients() const { return coefficientDesigner.getCurrentCoefficients(); }
+    
+    // samples between two filter redesigns of the SmoothedSvf engine
+    void setSmoothingSubBlockSize(int numSamples) noexcept { smoothedEngine.setSubBlockSize(numSamples); }
+    
+    // pre and post eq spectrum, the editor switches it on while it is open
+    SpectrumAnalyser& getAnalyser() noexcept { return analyser; }
+    
+    // per stage timing of processBlock, off until enabled (see StageProfiler.h)
+    StageProfiler& getProfiler() noexcept { return profiler; }
+    const StageProfiler& getProfiler() const noexcept { return profiler; }
+    
+    // input below this level (-120 dB) counts as silence, and the tail
+    // ends once the filters ring out below it relative to their impulse
+    static constexpr double silenceThreshold = 1.0e-6;
+    
+    // longer tails are cut here, e.g. a low cut so close to 0 Hz that it
+    // practically never decays
+    static constexpr double maxTailSeconds = 30.0;
+    
+    // on by default: once the input has been silent for the tail length,
+    // the filters are cleared and skipped until signal returns
+    void setSleepWhenSilent(bool shouldSleep) noexcept { sleepWhenSilent.store(shouldSleep); }
+    bool isSleeping() const noexcept { return sleeping.load(); }
+    
+    // user bands after the three fixed ones, each with its own type,
+    // see FilterBank.h and BandParameters.h
+    static constexpr int numBankBands = 24;
+    
+    // the stereo mode the fixed bands ran in during the last block: Linked
+    // unless the bus is stereo and the engine runs a set per side. Any thread
+    StereoMode getActiveStereoMode() const noexcept { return activeStereoMode.load(); }
+    
+    // the gain the dynamic peak applies right now, e.g. to draw it. Any thread
+    float getDynamicPeakGainInDecibels() const noexcept;
+    
+    // the state in the compact format of PluginState.h, which reads the
+    // formats of earlier releases too
+    PluginState& getPluginState() noexcept { return pluginState; }
+    
+    // presets with their coefficients designed ahead, also offered to the
+    // host as programs. Message thread. Changing the bank directly does not
+    // tell the host, storePreset() and loadPresetLibrary() do
+    PresetBank& getPresetBank() noexcept { return presetBank; }
+    
+    // adds the current settings to the bank and returns the preset's index
+    int storePreset(const juce::String& name);
+    
+    // replaces the bank with a library file (see PresetBank::loadLibrary)
+    // and starts over at its first preset. Message thread
+    bool loadPresetLibrary(const juce::File& file, juce::String& error);
+    
+    // moves every parameter to the preset. The audio thread swaps in the
+    // preset's coefficients on its next block instead of waiting for a
+    // design. Message thread, false if there is no such preset
+    bool recallPreset(int index);
 
 private:
-    // need two instances if we want to do stereo processing
-    MonoChain leftChain, rightChain;
+    // the biquad engines of one precision
+    template <typename SampleType>
+    struct Engines
+    {
+        // one mono chain per channel of the bus layout (see prepareToPlay)
+        juce::OwnedArray<MonoChainType<SampleType>> channelChains;
+        
+        // the same filters fused into one pass, one state per channel
+        SosCascade<SampleType> cascade;
+        
+        // the same filters again, with the channels packed into SIMD lanes
+        MultichannelCascade<SampleType> multichannelCascade;
+        
+        // the peak in dynamic mode, the engines above then leave it out
+        DynamicPeak<SampleType> dynamicPeak;
+        
+        // the user bands, after whichever engine runs the fixed ones
+        FilterBank<SampleType> filterBank;
+        
+        // the fixed bands with a set per side in the dual stereo modes
+        StereoCascade<SampleType> stereoCascade;
+    };
+    
+    // only the set matching the processing precision is prepared and kept
+    // up to date, the other one stays empty
+    Engines<float> floatEngines;
+    Engines<double> doubleEngines;
+    
+    // ramps the parameters and runs state variable filters instead,
+    // it reads the apvts itself because it designs on the audio thread
+    SmoothedSvfEngine smoothedEngine { apvts };
+    
+    // convolves in either precision, its kernels are designed by a
+    // background thread from the sets the audio thread hands it
+    LinearPhaseEngine linearPhase;
+    
+    std::atomic<Engine> requestedEngine { Engine::SimdCascade };
+    Engine activeEngine { Engine::SimdCascade };
+    
+    // gets the coefficients designed off the audio thread, shared with
+    // every other instance using the same settings, and hands them to
+    // the audio thread without locking or allocating
+    CoefficientDesigner coefficientDesigner { apvts };
+    
+    // the second set of the dual stereo modes, for the right or side channel
+    CoefficientDesigner rightSideDesigner { apvts, rightSideParameterPrefix };
+    
+    // the audio thread only queues samples for it, see SpectrumAnalyser.h
+    SpectrumAnalyser analyser;
+    
+    StageProfiler profiler;
+    
+    // silence detection, see process(). The tail length follows the
+    // coefficients the audio thread has picked up last
+    std::atomic<bool> sleepWhenSilent { true }, sleeping { false };
+    int silentSamples { 0 }, tailLengthInSamples { 0 };
+    std::atomic<double> tailLengthSeconds { 0.0 };
+    
+    // the fixed bands and the filter bank ring one after the other
+    int mainTailInSamples { 0 }, bankTailInSamples { 0 };
+    std::array<double, maxBankBands> bankPoleRadii {};
+    
+    // the bank's bands are designed on the audio thread when they move,
+    // see updateFilterBank()
+    BandParameters bandParameters { apvts, numBankBands };
+    
+    // the peak band runs as a dynamic eq, see DynamicPeak.h. The last
+    // loaded set is kept so the static peak can be put back
+    DynamicPeakParameters dynamicPeakParameters { apvts };
+    bool dynamicPeakEnabled { false };
+    CoefficientSet loadedCoefficients;
+    
+    // the stereo mode in use, only a stereo main bus leaves Linked.
+    // The second set is kept up to date in every mode. The parameter's
+    // pointer is looked up once, so the audio thread never searches the apvts
+    StereoMode stereoMode { StereoMode::Linked };
+    std::atomic<float>* stereoModeParameter { apvts.getRawParameterValue("Stereo Mode") };
+    int numMainChannels { 0 };
+    std::atomic<StereoMode> activeStereoMode { StereoMode::Linked };
+    CoefficientSet loadedRightSideCoefficients;
+    
+    // reads and writes the parameters as flat lists of values
+    PluginState pluginState { *this };
+    PresetBank presetBank { pluginState };
+    std::atomic<int> currentPreset { 0 };
+    
+    // the sets of a recalled preset on their way to the audio thread,
+    // picked up by updateFilters()
+    struct PresetRecall
+    {
+        CoefficientSet coefficients, rightSideCoefficients;
+    };
+    
+    TripleBuffer<PresetRecall> presetRecalls;
+    
+    // sample accurate parameter changes from controllers, see MidiAutomation.h
+    MidiAutomation midiAutomation { apvts };
+    
+    // the settings of the last sample accurate change while the designer
+    // has not caught up with them yet, see updateFilters()
+    CoefficientService::DesignKey sampleAccurateKey;
+    bool hasSampleAccurateDesign { false };
+    
+    // the main settings as the audio thread reads them, with the parameter
+    // pointers looked up once
+    ParameterSnapshot automationSnapshot { apvts };
     
     // before we use our filter chains we need to prepare them
     // see prepareToPlay method in PluginProcessor.cpp
     
-    void updatePeakFilter(const ChainSettings& chainSettings);
-    using Coefficients = Filter::CoefficientsPtr;
-    static void updateCoefficients(Coefficients& old, const Coefficients& replacements);
+    // writes plain coefficients into a filter's already allocated
+    // second order juce coefficients, so the audio thread never allocates
+    template <typename SampleType>
+    static void updateCoefficients(FilterType<SampleType>& filter, const BiquadCoefficients& replacements) noexcept
+    {
+        // prepareToPlay made sure every filter owns second order coefficients,
+        // so we can overwrite the values in place
+        jassert(filter.coefficients->getFilterOrder() == 2);
+        
+        auto* raw = filter.coefficients->getRawCoefficients();
+        raw[0] = static_cast<SampleType>(replacements.b0);
+        raw[1] = static_cast<SampleType>(replacements.b1);
+        raw[2] = static_cast<SampleType>(replacements.b2);
+        raw[3] = static_cast<SampleType>(replacements.a1);
+        raw[4] = static_cast<SampleType>(replacements.a2);
+    }
     
-    template<int Index, typename ChainType, typename CoefficientType>
-    void update(ChainType& chain, const CoefficientType& coefficients)
+    template<int Index, typename ChainType>
+    void update(ChainType& chain, const CutCoefficients& coefficients) noexcept
     {
-        updateCoefficients(chain.template get<Index>().coefficients, coefficients[Index]);
+        updateCoefficients(chain.template get<Index>(), coefficients.sections[Index]);
         chain.template setBypassed<Index>(false);
     }
     
-    template<typename ChainType, typename CoefficientType>
-    void updateCutFilter(ChainType& chain,
-                         const CoefficientType& coefficients,
-                         const Slope& slope)
+    // runs the first getNumSections() positions of the chain and bypasses the rest
+    template<typename ChainType, int... Index>
+    void updateCutFilter(ChainType& chain, const CutCoefficients& coefficients, std::integer_sequence<int, Index...>) noexcept
     {
-        // bypasses all 4 positions in the chain
-        chain.template setBypassed<0>(true);
-        chain.template setBypassed<1>(true);
-        chain.template setBypassed<2>(true);
-        chain.template setBypassed<3>(true);
-        // want to switch filters based on dB/oct name
-        // see enum defined in header
-        // NOTE: enums constants are of int type which is what the AudioParameterChoice object is expressed in
+        // a cut at the edge of its range is off and has no sections, see CoefficientDesigner
+        auto numSections = coefficients.getNumSections();
         
-        switch ( slope )
-        {
-            case Slope_48:
-            {
-                update<3>(chain, coefficients);
-            }
-            case Slope_36:
-            {
-                update<2>(chain, coefficients);
-            }
-            case Slope_24:
-            {
-                update<1>(chain, coefficients);
-            }
-            case Slope_12:
-            {
-                update<0>(chain, coefficients);
-            }
-        }
+        ((Index < numSections ? update<Index>(chain, coefficients) : chain.template setBypassed<Index>(true)), ...);
     }
     
-    void updateLowCutFilters(const ChainSettings& chainSettings);
-    void updateHighCutFilters(const ChainSettings& chainSettings);
+    template<typename ChainType>
+    void updateCutFilter(ChainType& chain, const CutCoefficients& coefficients) noexcept
+    {
+        updateCutFilter(chain, coefficients, std::make_integer_sequence<int, maxCutSections>());
+    }
+    
+    // calls function with every filter of a cut chain
+    template<typename ChainType, typename Function, int... Index>
+    static void forEachCutStage(ChainType& chain, Function&& function, std::integer_sequence<int, Index...>)
+    {
+        (function(chain.template get<Index>()), ...);
+    }
+    
+    template <typename SampleType>
+    void prepareEngines(Engines<SampleType>& engines, const juce::dsp::ProcessSpec& spec, int numChannels, int numSidechainChannels);
+    
+    // copies the finished sets into every engine, the second one is only
+    // used by the right channel in the dual stereo modes
+    template <typename SampleType>
+    void applyCoefficients(Engines<SampleType>& engines, const CoefficientSet& coefficientSet,
+                           const CoefficientSet& rightSideSet) noexcept;
+    
+    template <typename SampleType>
+    void resetEngine(Engines<SampleType>& engines, Engine engine) noexcept;
+    
+    // runs the block through the active engine
+    template <typename SampleType>
+    void runEngine(juce::dsp::AudioBlock<SampleType>& block, Engines<SampleType>& engines) noexcept;
+    
+    // the peak band in dynamic mode, after the engine. The sidechain is the
+    // whole block's, possibly without channels
+    template <typename SampleType>
+    void runDynamicPeak(juce::dsp::AudioBlock<SampleType>& block, const juce::dsp::AudioBlock<SampleType>& sidechain,
+                        size_t sidechainStart, Engines<SampleType>& engines) noexcept;
+    
+    // one segment of the block through the engine, the dynamic peak and the bank
+    template <typename SampleType>
+    void runSegment(juce::dsp::AudioBlock<SampleType>& segment, const juce::dsp::AudioBlock<SampleType>& sidechain,
+                    size_t segmentStart, Engines<SampleType>& engines) noexcept;
+    
+    // the body of both processBlock overloads
+    template <typename SampleType>
+    void process(juce::AudioBuffer<SampleType>& buffer, juce::MidiBuffer& midiMessages, Engines<SampleType>& engines) noexcept;
     
     void updateFilters();
+    
+    // hands a set to the engines of the precision in use
+    void loadCoefficients(const CoefficientSet& coefficientSet) noexcept;
+    
+    // hands both loaded sets to the engines again, e.g. after a mode change
+    void applyLoadedCoefficients() noexcept;
+    
+    // switches between linked stereo and the dual stereo modes
+    template <typename SampleType>
+    void updateStereoMode(Engines<SampleType>& engines) noexcept;
+    
+    // true while the fixed bands run a set per side: a dual stereo mode on
+    // one of the biquad engines
+    bool runsDualStereo() const noexcept;
+    
+    // switches the peak between the static engines and the dynamic band
+    template <typename SampleType>
+    void updateDynamicPeak(Engines<SampleType>& engines) noexcept;
+    
+    // redesigns the bank's bands whose parameters moved
+    template <typename SampleType>
+    void updateFilterBank(Engines<SampleType>& engines) noexcept;
+    
+    // the tail of the fixed bands and the bank together, for sleeping and the host
+    void updateTailLength() noexcept;
+    
+    // the latency of an engine, only the linear phase one has any
+    int getLatencyInSamples(Engine engine) const noexcept;
+    
+    // redesigns the filters on the spot for a controller's change, the
+    // parameter itself follows on the message thread
+    void applyParameterChange(const MidiAutomation::Change& change) noexcept;
+    
+    // the current main settings, read through automationSnapshot
+    const ChainSettings& readChainSettings() noexcept;
     //==============================================================================
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SimpleeqAudioProcessor)
 };
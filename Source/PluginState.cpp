@@ -0,0 +1,221 @@
+/*
+  ==============================================================================
+
+    PluginState.cpp
+
+  ==============================================================================
+*/
+
+#include "PluginState.h"
+
+namespace
+{
+    // magic, version and count
+    constexpr size_t headerSize = 8;
+    constexpr size_t valueSize = 8;
+}
+
+PluginState::PluginState(juce::AudioProcessor& processor)
+{
+    for (auto* parameter : processor.getParameters())
+    {
+        auto* ranged = dynamic_cast<juce::RangedAudioParameter*>(parameter);
+        jassert(ranged != nullptr);
+
+        if (ranged == nullptr)
+            continue;
+
+        // two IDs with the same hash could not be told apart in a state
+        auto inserted = indices.emplace(hashParameterID(ranged->paramID), parameters.size()).second;
+        jassert(inserted);
+        juce::ignoreUnused(inserted);
+
+        parameters.add(ranged);
+    }
+}
+
+juce::uint32 PluginState::hashParameterID(const juce::String& parameterID) noexcept
+{
+    juce::uint32 hash = 2166136261u;
+
+    for (auto* c = parameterID.toRawUTF8(); *c != 0; ++c)
+    {
+        hash ^= (juce::uint8) *c;
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+//==============================================================================
+PluginState::Values PluginState::capture() const
+{
+    Values values;
+    values.reserve((size_t) parameters.size());
+
+    for (auto* parameter : parameters)
+        values.push_back(parameter->convertFrom0to1(parameter->getValue()));
+
+    return values;
+}
+
+PluginState::Values PluginState::getDefaults() const
+{
+    Values values;
+    values.reserve((size_t) parameters.size());
+
+    for (auto* parameter : parameters)
+        values.push_back(parameter->convertFrom0to1(parameter->getDefaultValue()));
+
+    return values;
+}
+
+void PluginState::apply(const Values& values) const
+{
+    jassert((int) values.size() == parameters.size());
+
+    for (int i = 0; i < juce::jmin(parameters.size(), (int) values.size()); ++i)
+    {
+        auto* parameter = parameters.getUnchecked(i);
+        auto normalised = parameter->convertTo0to1(values[(size_t) i]);
+
+        // untouched parameters are left alone, so the host only hears
+        // about the ones that really moved
+        if (parameter->getValue() != normalised)
+            parameter->setValueNotifyingHost(normalised);
+    }
+}
+
+//==============================================================================
+void PluginState::write(const Values& values, juce::MemoryBlock& destData) const
+{
+    jassert((int) values.size() == parameters.size());
+
+    auto count = juce::jmin(parameters.size(), (int) values.size());
+
+    juce::MemoryOutputStream stream(destData, true);
+    stream.preallocate(destData.getSize() + headerSize + valueSize * (size_t) count);
+
+    stream.writeInt((int) magic);
+    stream.writeShort((short) currentVersion);
+    stream.writeShort((short) count);
+
+    for (int i = 0; i < count; ++i)
+    {
+        stream.writeInt((int) hashParameterID(parameters.getUnchecked(i)->paramID));
+        stream.writeFloat(values[(size_t) i]);
+    }
+}
+
+bool PluginState::isCompact(const void* data, size_t sizeInBytes) noexcept
+{
+    return data != nullptr && sizeInBytes >= headerSize
+        && juce::ByteOrder::littleEndianInt(data) == magic;
+}
+
+bool PluginState::read(const void* data, size_t sizeInBytes, Values& values) const
+{
+    if (data == nullptr || sizeInBytes == 0)
+        return false;
+
+    if (isCompact(data, sizeInBytes))
+        return readCompact(data, sizeInBytes, values);
+
+    // the formats of earlier releases, all of them a ValueTree in the end:
+    // XML in the binary wrapper hosts got from copyXmlToBinary...
+    if (auto xml = juce::AudioProcessor::getXmlFromBinary(data, (int) sizeInBytes))
+        return readTree(juce::ValueTree::fromXml(*xml), values);
+
+    // ...XML as text, e.g. a preset file...
+    if (static_cast<const char*>(data)[0] == '<')
+        if (auto xml = juce::parseXML(juce::String::fromUTF8(static_cast<const char*>(data), (int) sizeInBytes)))
+            return readTree(juce::ValueTree::fromXml(*xml), values);
+
+    // ...and the apvts tree as written by ValueTree::writeToStream
+    return readTree(juce::ValueTree::readFromData(data, sizeInBytes), values);
+}
+
+bool PluginState::readCompact(const void* data, size_t sizeInBytes, Values& values) const
+{
+    juce::MemoryInputStream stream(data, sizeInBytes, false);
+    stream.readInt();
+
+    auto version = (int) (juce::uint16) stream.readShort();
+    auto count = (size_t) (juce::uint16) stream.readShort();
+
+    // a newer release may have changed what the values mean
+    if (version < 1 || version > currentVersion || sizeInBytes < headerSize + count * valueSize)
+        return false;
+
+    values = getDefaults();
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        auto idHash = (juce::uint32) stream.readInt();
+        auto value = stream.readFloat();
+        auto index = indexOf(idHash);
+
+        if (index >= 0 && std::isfinite(value))
+        {
+            const auto& range = parameters.getUnchecked(index)->getNormalisableRange();
+            values[(size_t) index] = juce::jlimit(range.start, range.end, value);
+        }
+    }
+
+    return true;
+}
+
+bool PluginState::readTree(const juce::ValueTree& tree, Values& values) const
+{
+    if (! tree.isValid())
+        return false;
+
+    values = getDefaults();
+
+    // the apvts keeps one PARAM child per parameter with its id and value
+    for (const auto& child : tree)
+    {
+        if (! child.hasProperty("id") || ! child.hasProperty("value"))
+            continue;
+
+        auto index = indexOf(hashParameterID(child.getProperty("id").toString()));
+
+        if (index >= 0)
+        {
+            const auto& range = parameters.getUnchecked(index)->getNormalisableRange();
+            values[(size_t) index] = juce::jlimit(range.start, range.end, (float) child.getProperty("value"));
+        }
+    }
+
+    return true;
+}
+
+//==============================================================================
+int PluginState::indexOf(juce::uint32 idHash) const
+{
+    auto found = indices.find(idHash);
+    return found != indices.end() ? found->second : -1;
+}
+
+float PluginState::getValue(const Values& values, const juce::String& parameterID) const
+{
+    auto index = indexOf(hashParameterID(parameterID));
+    jassert(index >= 0 && (size_t) index < values.size());
+
+    return index >= 0 && (size_t) index < values.size() ? values[(size_t) index] : 0.f;
+}
+
+ChainSettings PluginState::getChainSettings(const Values& values, const juce::String& parameterPrefix) const
+{
+    ChainSettings settings;
+
+    settings.lowCutFreq = getValue(values, parameterPrefix + "LowCut Freq");
+    settings.highCutFreq = getValue(values, parameterPrefix + "HighCut Freq");
+    settings.peakFreq = getValue(values, parameterPrefix + "Peak Freq");
+    settings.peakGainInDecibles = getValue(values, parameterPrefix + "Peak Gain");
+    settings.peakQuality = getValue(values, parameterPrefix + "Peak Quality");
+    settings.lowCutSlope = static_cast<Slope>(getValue(values, parameterPrefix + "LowCut Slope"));
+    settings.highCutSlope = static_cast<Slope>(getValue(values, parameterPrefix + "HighCut Slope"));
+
+    return settings;
+}
@@ -0,0 +1,83 @@
+/*
+  ==============================================================================
+
+    PluginState.h
+
+    The plugin state as a flat list of parameter values, and its compact
+    binary format. Instead of the whole apvts ValueTree with the string
+    ID of every parameter, a state is
+
+        uint32  magic 'SEQS'
+        uint16  version
+        uint16  number of values
+        per value: uint32 hash of the parameter ID, float32 value
+
+    all little endian, 8 bytes per parameter. Values are stored
+    denormalised, so a state still means the same when a later version
+    widens a range. Parameters the reader does not know are skipped and
+    the ones missing from the data keep their default, so states move
+    freely between versions with different parameter sets. A state of a
+    newer format version is refused.
+
+    read() also takes the formats of earlier releases: the apvts ValueTree
+    written by ValueTree::writeToStream, and XML, either as text or in the
+    binary wrapper of AudioProcessor::copyXmlToBinary.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "ChainSettings.h"
+
+class PluginState
+{
+public:
+    // one value per parameter of the processor, in the processor's order
+    using Values = std::vector<float>;
+
+    static constexpr juce::uint32 magic = 0x53514553; // "SEQS" in the file
+    static constexpr int currentVersion = 1;
+
+    // collects the processor's parameters, which must all be ranged
+    explicit PluginState(juce::AudioProcessor& processor);
+
+    int getNumParameters() const noexcept { return parameters.size(); }
+
+    // the current values of every parameter, and their defaults
+    Values capture() const;
+    Values getDefaults() const;
+
+    // moves every parameter that differs to its value, notifying the host
+    void apply(const Values& values) const;
+
+    // appends the compact form of the values to the block
+    void write(const Values& values, juce::MemoryBlock& destData) const;
+
+    // reads a state of any format, parameters it does not contain get
+    // their default. Returns false if the data is none of the formats
+    bool read(const void* data, size_t sizeInBytes, Values& values) const;
+
+    // whether the data starts like a compact state
+    static bool isCompact(const void* data, size_t sizeInBytes) noexcept;
+
+    // the fixed bands of the values, the prefix picks the second set of
+    // the dual stereo modes like everywhere else
+    ChainSettings getChainSettings(const Values& values, const juce::String& parameterPrefix = {}) const;
+
+    // 32 bit FNV-1a of the UTF-8 ID, what the compact format stores
+    static juce::uint32 hashParameterID(const juce::String& parameterID) noexcept;
+
+private:
+    bool readCompact(const void* data, size_t sizeInBytes, Values& values) const;
+    bool readTree(const juce::ValueTree& tree, Values& values) const;
+
+    int indexOf(juce::uint32 idHash) const;
+    float getValue(const Values& values, const juce::String& parameterID) const;
+
+    juce::Array<juce::RangedAudioParameter*> parameters;
+    std::unordered_map<juce::uint32, int> indices;
+
+    JUCE_DECLARE_NON_COPYABLE (PluginState)
+};
@@ -0,0 +1,224 @@
+/*
+  ==============================================================================
+
+    PresetBank.cpp
+
+  ==============================================================================
+*/
+
+#include "PresetBank.h"
+
+PresetBank::PresetBank(const PluginState& stateToUse)
+    : state(stateToUse)
+{
+}
+
+void PresetBank::prepare(double newSampleRate)
+{
+    const juce::ScopedLock sl(lock);
+
+    if (newSampleRate == sampleRate)
+        return;
+
+    sampleRate = newSampleRate;
+
+    for (auto& preset : presets)
+        design(preset);
+}
+
+double PresetBank::getSampleRate() const
+{
+    const juce::ScopedLock sl(lock);
+    return sampleRate;
+}
+
+void PresetBank::design(Preset& preset)
+{
+    if (sampleRate <= 0.0)
+        return;
+
+    preset.coefficients = service->getDesign({ sampleRate, state.getChainSettings(preset.values) });
+    preset.rightSideCoefficients = service->getDesign({ sampleRate, state.getChainSettings(preset.values, rightSideParameterPrefix) });
+}
+
+//==============================================================================
+int PresetBank::add(const juce::String& name, PluginState::Values values)
+{
+    jassert((int) values.size() == state.getNumParameters());
+
+    Preset preset { name, std::move(values), {}, {} };
+
+    const juce::ScopedLock sl(lock);
+    design(preset);
+    presets.push_back(std::move(preset));
+
+    return (int) presets.size() - 1;
+}
+
+void PresetBank::clear()
+{
+    const juce::ScopedLock sl(lock);
+    presets.clear();
+}
+
+int PresetBank::size() const
+{
+    const juce::ScopedLock sl(lock);
+    return (int) presets.size();
+}
+
+bool PresetBank::getPreset(int index, Preset& preset) const
+{
+    const juce::ScopedLock sl(lock);
+
+    if (! juce::isPositiveAndBelow(index, (int) presets.size()))
+        return false;
+
+    preset = presets[(size_t) index];
+    return true;
+}
+
+juce::String PresetBank::getName(int index) const
+{
+    const juce::ScopedLock sl(lock);
+    return juce::isPositiveAndBelow(index, (int) presets.size()) ? presets[(size_t) index].name : juce::String();
+}
+
+void PresetBank::setName(int index, const juce::String& newName)
+{
+    const juce::ScopedLock sl(lock);
+
+    if (juce::isPositiveAndBelow(index, (int) presets.size()))
+        presets[(size_t) index].name = newName;
+}
+
+//==============================================================================
+bool PresetBank::loadLibrary(const juce::File& file, juce::String& error)
+{
+    // the pages are only read in as the presets are parsed, and the
+    // mapping is gone again once they are
+    juce::MemoryMappedFile mappedFile(file, juce::MemoryMappedFile::readOnly);
+
+    if (mappedFile.getData() == nullptr)
+    {
+        error = "could not open preset library: " + file.getFullPathName();
+        return false;
+    }
+
+    std::vector<Preset> loaded;
+
+    if (! readLibrary(mappedFile.getData(), mappedFile.getSize(), loaded, error))
+    {
+        error << ": " << file.getFullPathName();
+        return false;
+    }
+
+    const juce::ScopedLock sl(lock);
+
+    for (auto& preset : loaded)
+        design(preset);
+
+    presets = std::move(loaded);
+    return true;
+}
+
+bool PresetBank::readLibrary(const void* data, size_t sizeInBytes, std::vector<Preset>& loaded, juce::String& error) const
+{
+    juce::MemoryInputStream stream(data, sizeInBytes, false);
+
+    if (sizeInBytes < 8 || (juce::uint32) stream.readInt() != libraryMagic)
+    {
+        error = "not a preset library";
+        return false;
+    }
+
+    auto version = (int) (juce::uint16) stream.readShort();
+    auto count = (int) (juce::uint16) stream.readShort();
+
+    if (version < 1 || version > libraryVersion)
+    {
+        error = "preset library of a newer version";
+        return false;
+    }
+
+    const auto* bytes = static_cast<const char*>(data);
+    loaded.reserve((size_t) count);
+
+    for (int i = 0; i < count; ++i)
+    {
+        Preset preset;
+
+        auto nameLength = (size_t) (juce::uint16) stream.readShort();
+
+        if (stream.getNumBytesRemaining() < (juce::int64) nameLength + 4)
+        {
+            error = "truncated preset library";
+            return false;
+        }
+
+        auto position = (size_t) stream.getPosition();
+        preset.name = juce::String::fromUTF8(bytes + position, (int) nameLength);
+        stream.skipNextBytes((juce::int64) nameLength);
+
+        auto stateSize = (size_t) (juce::uint32) stream.readInt();
+
+        if (stream.getNumBytesRemaining() < (juce::int64) stateSize)
+        {
+            error = "truncated preset library";
+            return false;
+        }
+
+        // the state is read straight out of the mapped file
+        position = (size_t) stream.getPosition();
+
+        if (! state.read(bytes + position, stateSize, preset.values))
+        {
+            error = "unreadable preset \"" + preset.name + "\" in library";
+            return false;
+        }
+
+        stream.skipNextBytes((juce::int64) stateSize);
+        loaded.push_back(std::move(preset));
+    }
+
+    return true;
+}
+
+bool PresetBank::saveLibrary(const juce::File& file, juce::String& error) const
+{
+    juce::MemoryBlock library;
+
+    {
+        const juce::ScopedLock sl(lock);
+
+        juce::MemoryOutputStream stream(library, false);
+        stream.writeInt((int) libraryMagic);
+        stream.writeShort((short) libraryVersion);
+        stream.writeShort((short) juce::jmin((int) presets.size(), 0xffff));
+
+        juce::MemoryBlock presetState;
+
+        for (size_t i = 0; i < juce::jmin(presets.size(), (size_t) 0xffff); ++i)
+        {
+            const auto& preset = presets[i];
+            auto name = preset.name.toUTF8();
+            auto nameLength = juce::jmin(name.sizeInBytes() - 1, (size_t) 0xffff);
+
+            stream.writeShort((short) nameLength);
+            stream.write(name.getAddress(), nameLength);
+
+            presetState.reset();
+            state.write(preset.values, presetState);
+            stream.writeInt((int) presetState.getSize());
+            stream << presetState;
+        }
+    }
+
+    if (! file.replaceWithData(library.getData(), library.getSize()))
+    {
+        error = "could not write preset library: " + file.getFullPathName();
+        return false;
+    }
+
+    return true;
+}
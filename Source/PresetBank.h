@@ -0,0 +1,91 @@
+/*
+  ==============================================================================
+
+    PresetBank.h
+
+    Presets held in memory with their coefficients designed ahead, so
+    recalling one (or switching between an A and a B) does not design
+    anything: the processor hands the finished sets to the audio thread,
+    which swaps them in on its next block (see
+    SimpleeqAudioProcessor::recallPreset).
+
+    Each preset keeps its sets from the CoefficientService, so they are
+    shared with every instance using the same settings and stay in the
+    service's cache as long as the preset exists. prepare() designs them
+    all for a new sample rate.
+
+    A bank can be loaded from a preset library file, which is mapped into
+    memory instead of read, and holds the presets in the compact state
+    format (see PluginState.h):
+
+        uint32  magic 'SEQL'
+        uint16  version
+        uint16  number of presets
+        per preset: uint16 name length, the name in UTF-8,
+                    uint32 state size, the compact state
+
+    all little endian. Not real-time safe, every call takes a lock.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "CoefficientService.h"
+#include "PluginState.h"
+
+class PresetBank
+{
+public:
+    static constexpr juce::uint32 libraryMagic = 0x4c514553; // "SEQL" in the file
+    static constexpr int libraryVersion = 1;
+
+    struct Preset
+    {
+        juce::String name;
+        PluginState::Values values;
+
+        // both sets of the fixed bands (the second one for the dual stereo
+        // modes), designed for the bank's sample rate. Empty until prepare()
+        std::shared_ptr<const CoefficientSet> coefficients, rightSideCoefficients;
+    };
+
+    // the state reads and writes the presets' values
+    explicit PresetBank(const PluginState& state);
+
+    // designs every preset for this sample rate, and every preset added later
+    void prepare(double sampleRate);
+    double getSampleRate() const;
+
+    // adds a preset and returns its index
+    int add(const juce::String& name, PluginState::Values values);
+    void clear();
+
+    int size() const;
+
+    // a copy of a preset, false if the index is out of range
+    bool getPreset(int index, Preset& preset) const;
+    juce::String getName(int index) const;
+    void setName(int index, const juce::String& newName);
+
+    // replaces the bank with the presets of a library file. A preset
+    // with a state that cannot be read fails the whole file
+    bool loadLibrary(const juce::File& file, juce::String& error);
+    bool saveLibrary(const juce::File& file, juce::String& error) const;
+
+private:
+    bool readLibrary(const void* data, size_t sizeInBytes, std::vector<Preset>& loaded, juce::String& error) const;
+
+    // gets the sets of a preset from the service, with the lock held
+    void design(Preset& preset);
+
+    const PluginState& state;
+    std::shared_ptr<CoefficientService> service { CoefficientService::getInstance() };
+
+    mutable juce::CriticalSection lock;
+    std::vector<Preset> presets;
+    double sampleRate { 0.0 };
+
+    JUCE_DECLARE_NON_COPYABLE (PresetBank)
+};
@@ -0,0 +1,65 @@
+/*
+  ==============================================================================
+
+    SectionSlots.h
+
+    The cascades only store the sections that are actually in use, packed
+    next to each other. Every section also remembers which slot of the eq it
+    belongs to (0..7 low cut, 8 peak, 9..16 high cut), so when a slope change
+    moves a section its filter state can move with it.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "CoefficientSet.h"
+
+// 8 low cut sections + 1 peak + 8 high cut sections
+static constexpr int maxEqSections = 2 * maxCutSections + 1;
+
+// slot numbers of the eq bands
+static constexpr int lowCutSlot(int section) noexcept  { return section; }
+static constexpr int peakSlot() noexcept                { return maxCutSections; }
+static constexpr int highCutSlot(int section) noexcept { return maxCutSections + 1 + section; }
+
+using SectionSlots = std::array<int, maxEqSections>;
+
+// the section of a set that sits in a slot, or nullptr if it is not live
+inline const BiquadCoefficients* getSlotSection(const CoefficientSet& coefficientSet, int slot) noexcept
+{
+    if (slot < peakSlot())
+        return slot < coefficientSet.lowCut.getNumSections() ? &coefficientSet.lowCut.sections[(size_t) slot] : nullptr;
+
+    if (slot == peakSlot())
+        return coefficientSet.peak.isIdentity() ? nullptr : &coefficientSet.peak;
+
+    auto section = slot - highCutSlot(0);
+    return section < coefficientSet.highCut.getNumSections() ? &coefficientSet.highCut.sections[(size_t) section] : nullptr;
+}
+
+// moves numStates values of per-section state from the old packing to the
+// new one. Sections that were not active before start from silence.
+template <typename StateType>
+void remapSectionState(StateType* state,
+                       const SectionSlots& oldSlots, int oldNumSections,
+                       const SectionSlots& newSlots, int newNumSections) noexcept
+{
+    std::array<StateType, maxEqSections> old;
+    std::copy(state, state + maxEqSections, old.begin());
+
+    for (int s = 0; s < newNumSections; ++s)
+    {
+        state[s] = StateType(0);
+
+        for (int o = 0; o < oldNumSections; ++o)
+        {
+            if (oldSlots[(size_t) o] == newSlots[(size_t) s])
+            {
+                state[s] = old[(size_t) o];
+                break;
+            }
+        }
+    }
+}
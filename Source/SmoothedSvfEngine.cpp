@@ -0,0 +1,218 @@
+/*
+  ==============================================================================
+
+    SmoothedSvfEngine.cpp
+
+  ==============================================================================
+*/
+
+#include "SmoothedSvfEngine.h"
+
+namespace
+{
+    // makePeakFilter asserts on a quality of 0, the parameter range allows it
+    constexpr float minimumQuality = 0.025f;
+}
+
+SmoothedSvfEngine::SmoothedSvfEngine(juce::AudioProcessorValueTreeState& apvts)
+    : parameterSnapshot(apvts)
+{
+}
+
+void SmoothedSvfEngine::prepare(double newSampleRate, int numChannels, bool shouldUseDoublePrecision)
+{
+    sampleRate = newSampleRate;
+    numPaths = juce::jmax(1, numChannels);
+    useDoublePrecision = shouldUseDoublePrecision;
+    
+    // the coefficients are the same for both, only the state and the
+    // arithmetic are double
+    if (useDoublePrecision)
+        doubleCascade.prepare(numPaths);
+    else
+        cascade.prepare(numPaths);
+    prewarpTable = CutCoefficientTable::getFor(sampleRate);
+    
+    for (auto* smoother : { &lowCutFreq, &highCutFreq, &peakFreq })
+        smoother->reset(sampleRate, rampLengthSeconds);
+    for (auto* smoother : { &peakGain, &peakQuality })
+        smoother->reset(sampleRate, rampLengthSeconds);
+    
+    // start at the current values instead of ramping from wherever we were
+    parameterSnapshot.invalidate();
+    parameterSnapshot.update();
+    readParameters(true);
+    designSections();
+    
+    samplesUntilUpdate = getSubBlockSize();
+    needsDesign = false;
+}
+
+void SmoothedSvfEngine::reset() noexcept
+{
+    cascade.reset();
+    doubleCascade.reset();
+}
+
+void SmoothedSvfEngine::setSubBlockSize(int numSamples) noexcept
+{
+    subBlockSize.store(juce::jlimit(minSubBlockSize, maxSubBlockSize, numSamples));
+}
+
+void SmoothedSvfEngine::setPeakBypassed(bool shouldBeBypassed) noexcept
+{
+    if (peakBypassed != shouldBeBypassed)
+    {
+        peakBypassed = shouldBeBypassed;
+        needsDesign = true;
+    }
+}
+
+void SmoothedSvfEngine::readParameters(bool jumpToTargets) noexcept
+{
+    const auto& settings = parameterSnapshot.getSettings();
+    
+    auto setTarget = [jumpToTargets](auto& smoother, float value)
+    {
+        if (jumpToTargets)
+            smoother.setCurrentAndTargetValue(value);
+        else
+            smoother.setTargetValue(value);
+    };
+    
+    setTarget(lowCutFreq, settings.lowCutFreq);
+    setTarget(highCutFreq, settings.highCutFreq);
+    setTarget(peakFreq, settings.peakFreq);
+    setTarget(peakGain, settings.peakGainInDecibles);
+    setTarget(peakQuality, juce::jmax(minimumQuality, settings.peakQuality));
+    
+    // slopes are discrete, they switch at the next grid step
+    lowCutSlope = settings.lowCutSlope;
+    highCutSlope = settings.highCutSlope;
+}
+
+bool SmoothedSvfEngine::isSmoothing() const noexcept
+{
+    return lowCutFreq.isSmoothing() || highCutFreq.isSmoothing() || peakFreq.isSmoothing()
+        || peakGain.isSmoothing() || peakQuality.isSmoothing();
+}
+
+void SmoothedSvfEngine::advanceSmoothers(int numSamples) noexcept
+{
+    lowCutFreq.skip(numSamples);
+    highCutFreq.skip(numSamples);
+    peakFreq.skip(numSamples);
+    peakGain.skip(numSamples);
+    peakQuality.skip(numSamples);
+}
+
+void SmoothedSvfEngine::designSections() noexcept
+{
+    std::array<SvfCoefficients, maxEqSections> sections;
+    SectionSlots slots {};
+    int numSections = 0;
+    
+    // every g = tan(pi * f / fs) comes from the shared table
+    const auto& table = *prewarpTable;
+    
+    // like the biquad engines, a band that does nothing is left out, but
+    // only once its smoother has come to rest so it never cuts out mid ramp
+    auto lowCutActive = lowCutFreq.isSmoothing() || lowCutFreq.getCurrentValue() > CutCoefficientTable::minFrequency;
+    auto peakActive = ! peakBypassed && (peakGain.isSmoothing() || peakGain.getCurrentValue() != 0.f);
+    auto highCutActive = highCutFreq.isSmoothing() || highCutFreq.getCurrentValue() < CutCoefficientTable::maxFrequency;
+    
+    // low cut: butterworth or linkwitz-riley highpass, 2 poles per section, damping k = 1 / Q
+    auto lowCutG = (float) table.getPrewarped(lowCutFreq.getCurrentValue());
+    
+    for (int i = 0; lowCutActive && i < getNumCutSections(lowCutSlope); ++i)
+    {
+        sections[(size_t) numSections] = SvfCoefficients::makeHighPass(lowCutG, (float) (1.0 / CutCoefficientTable::getSectionQ(lowCutSlope, i)));
+        slots[(size_t) numSections++] = lowCutSlot(i);
+    }
+    
+    // peak: A = 10^(dB / 40), so the bell reaches A * A at its centre
+    if (peakActive)
+    {
+        auto A = juce::Decibels::decibelsToGain(peakGain.getCurrentValue() * 0.5f);
+        sections[(size_t) numSections] = SvfCoefficients::makeBell((float) table.getPrewarped(peakFreq.getCurrentValue()),
+                                                                   peakQuality.getCurrentValue(), A);
+        slots[(size_t) numSections++] = peakSlot();
+    }
+    
+    // high cut: butterworth or linkwitz-riley lowpass
+    auto highCutG = (float) table.getPrewarped(highCutFreq.getCurrentValue());
+    
+    for (int i = 0; highCutActive && i < getNumCutSections(highCutSlope); ++i)
+    {
+        sections[(size_t) numSections] = SvfCoefficients::makeLowPass(highCutG, (float) (1.0 / CutCoefficientTable::getSectionQ(highCutSlope, i)));
+        slots[(size_t) numSections++] = highCutSlot(i);
+    }
+    
+    // only the cascade of the precision we were prepared for is running
+    if (useDoublePrecision)
+        doubleCascade.setSections(sections, slots, numSections);
+    else
+        cascade.setSections(sections, slots, numSections);
+}
+
+void SmoothedSvfEngine::process(juce::dsp::AudioBlock<float>& block) noexcept
+{
+    jassert(! useDoublePrecision);
+    processWithCascade(block, cascade);
+}
+
+void SmoothedSvfEngine::process(juce::dsp::AudioBlock<double>& block) noexcept
+{
+    jassert(useDoublePrecision);
+    processWithCascade(block, doubleCascade);
+}
+
+template <typename SampleType>
+void SmoothedSvfEngine::processWithCascade(juce::dsp::AudioBlock<SampleType>& block, SvfCascade<SampleType>& svfCascade) noexcept
+{
+    {
+        StageProfiler::ScopedStage stage(profiler, StageProfiler::ReadParameters);
+        
+        if (parameterSnapshot.update() != 0)
+        {
+            readParameters(false);
+            needsDesign = true;
+        }
+    }
+    
+    auto numChannels = juce::jmin((int) block.getNumChannels(), numPaths);
+    auto numSamples = block.getNumSamples();
+    size_t position = 0;
+    
+    // the grid carries on across host blocks, so the update rate does not
+    // depend on the host buffer size
+    while (position < numSamples)
+    {
+        if (samplesUntilUpdate == 0)
+        {
+            auto step = getSubBlockSize();
+            
+            if (needsDesign || isSmoothing())
+            {
+                StageProfiler::ScopedStage stage(profiler, StageProfiler::CoefficientDesign);
+                advanceSmoothers(step);
+                designSections();
+                needsDesign = false;
+            }
+            
+            samplesUntilUpdate = step;
+        }
+        
+        auto chunk = juce::jmin((size_t) samplesUntilUpdate, numSamples - position);
+        
+        {
+            StageProfiler::ScopedStage stage(profiler, StageProfiler::Filtering);
+            
+            for (int channel = 0; channel < numChannels; ++channel)
+                svfCascade.process(block.getChannelPointer((size_t) channel) + position, chunk, channel);
+        }
+        
+        position += chunk;
+        samplesUntilUpdate -= (int) chunk;
+    }
+}
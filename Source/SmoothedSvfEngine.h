@@ -0,0 +1,100 @@
+/*
+  ==============================================================================
+
+    SmoothedSvfEngine.h
+
+    Zipper free automation. Every continuous parameter is ramped with a
+    juce::SmoothedValue and the filters are redesigned on a fixed internal
+    grid of subBlockSize samples, no matter how big the host blocks are.
+    The filters are TPT state variable filters (see SvfCascade.h), so the
+    coefficient steps on the grid never make the cascade unstable.
+
+    CPU budget: while a parameter is moving, every grid step costs
+    maxPrewarpsPerUpdate lookups in the shared CutCoefficientTable plus
+    maxEqSections section setups (a handful of multiplies and one division
+    each), no trigonometry. When nothing moves the grid steps cost nothing
+    and only the filtering is paid for.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "ParameterSnapshot.h"
+#include "SvfCascade.h"
+#include "CutCoefficientTable.h"
+#include "StageProfiler.h"
+
+class SmoothedSvfEngine
+{
+public:
+    explicit SmoothedSvfEngine(juce::AudioProcessorValueTreeState& apvts);
+
+    // allocates the filter state, jumps to the current parameter values
+    // and designs the filters. Not real-time safe.
+    void prepare(double sampleRate, int numChannels, bool useDoublePrecision = false);
+
+    void reset() noexcept;
+
+    // samples between two filter redesigns, from the next grid step on
+    static constexpr int minSubBlockSize = 1;
+    static constexpr int maxSubBlockSize = 256;
+    static constexpr int defaultSubBlockSize = 32;
+    void setSubBlockSize(int numSamples) noexcept;
+    int getSubBlockSize() const noexcept { return subBlockSize.load(); }
+
+    // how long the smoothers take to reach a new value, used by the next prepare()
+    static constexpr double defaultRampLengthSeconds = 0.05;
+    void setRampLengthSeconds(double newRampLengthSeconds) noexcept { rampLengthSeconds = newRampLengthSeconds; }
+
+    // one prewarped frequency per band and grid step
+    static constexpr int maxPrewarpsPerUpdate = 3;
+
+    // filters every channel of the block in place, in the precision
+    // passed to prepare()
+    void process(juce::dsp::AudioBlock<float>& block) noexcept;
+    void process(juce::dsp::AudioBlock<double>& block) noexcept;
+
+    // leaves the peak out while the processor runs it as a dynamic band
+    void setPeakBypassed(bool shouldBeBypassed) noexcept;
+
+    // times parameter reading, design and filtering as separate stages
+    void setProfiler(StageProfiler* profilerToUse) noexcept { profiler = profilerToUse; }
+
+private:
+    template <typename SampleType>
+    void processWithCascade(juce::dsp::AudioBlock<SampleType>& block, SvfCascade<SampleType>& svfCascade) noexcept;
+
+    // reads the parameters and hands them to the smoothers
+    void readParameters(bool jumpToTargets) noexcept;
+
+    bool isSmoothing() const noexcept;
+    void advanceSmoothers(int numSamples) noexcept;
+    void designSections() noexcept;
+
+    ParameterSnapshot parameterSnapshot;
+
+    using FrequencySmoother = juce::SmoothedValue<float, juce::ValueSmoothingTypes::Multiplicative>;
+    using LinearSmoother = juce::SmoothedValue<float, juce::ValueSmoothingTypes::Linear>;
+
+    FrequencySmoother lowCutFreq, highCutFreq, peakFreq;
+    LinearSmoother peakGain, peakQuality;
+    Slope lowCutSlope { Slope::Slope_12 }, highCutSlope { Slope::Slope_12 };
+
+    SvfCascade<float> cascade;
+    SvfCascade<double> doubleCascade;
+    bool useDoublePrecision { false };
+    std::shared_ptr<const CutCoefficientTable> prewarpTable;
+
+    double sampleRate { 44100.0 };
+    double rampLengthSeconds { defaultRampLengthSeconds };
+    std::atomic<int> subBlockSize { defaultSubBlockSize };
+    int samplesUntilUpdate { 0 };
+    bool needsDesign { true };
+    bool peakBypassed { false };
+    int numPaths { 0 };
+    StageProfiler* profiler { nullptr };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SmoothedSvfEngine)
+};
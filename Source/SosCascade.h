@@ -0,0 +1,287 @@
+/*
+  ==============================================================================
+
+    SosCascade.h
+
+    A cascade of second order sections that runs every active section of
+    the eq in a single pass over the samples.
+
+    The ProcessorChain version walks the whole buffer once per biquad
+    (up to 8 + 1 + 8 times), going through the Coefficients pointer every
+    time. Here the coefficients of all active sections live next to each
+    other in a structure-of-arrays and each sample is loaded and stored
+    only once, while it travels through all the sections.
+
+    SampleType can be float, double or a juce::dsp::SIMDRegister, in which
+    case every lane of the register is an independent signal running
+    through the same coefficients (see MultichannelCascade.h), or through
+    coefficients of its own (see MultiTrackCascade.h).
+
+    The sample loop is compiled once for every possible number of live
+    sections, fully unrolled, and picked when the coefficients change.
+    Because the live sections are packed next to each other, that number
+    is all a kernel depends on: every combination of the two slopes and
+    the peak maps onto one of maxSections + 1 kernels, and bands that do
+    nothing (see CoefficientSet.h) are not compiled into the one that runs.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "CoefficientSet.h"
+#include "SectionSlots.h"
+
+template <typename SampleType>
+class SosCascade
+{
+public:
+    // 8 low cut biquads + 1 peak + 8 high cut biquads
+    static constexpr int maxSections = maxEqSections;
+
+    // allocates the filter state of numPaths independent signals
+    // (one per channel, or one per group of SIMD lanes), not real-time safe
+    void prepare(int numPathsToUse)
+    {
+        numPaths = juce::jmax(1, numPathsToUse);
+        state1.assign((size_t) (numPaths * maxSections), SampleType(0));
+        state2.assign((size_t) (numPaths * maxSections), SampleType(0));
+        reset();
+    }
+
+    void reset() noexcept
+    {
+        std::fill(state1.begin(), state1.end(), SampleType(0));
+        std::fill(state2.begin(), state2.end(), SampleType(0));
+    }
+
+    // packs the active sections of a CoefficientSet next to each other.
+    // The state of a section follows it when slopes change, so a section
+    // that stays active keeps ringing the way it did before.
+    void setCoefficients(const CoefficientSet& coefficientSet) noexcept
+    {
+        SectionSlots newSlots {};
+        int newNumSections = 0;
+
+        auto addSection = [&](int slot, const BiquadCoefficients& c)
+        {
+            b0[(size_t) newNumSections] = static_cast<SampleType>(c.b0);
+            b1[(size_t) newNumSections] = static_cast<SampleType>(c.b1);
+            b2[(size_t) newNumSections] = static_cast<SampleType>(c.b2);
+            a1[(size_t) newNumSections] = static_cast<SampleType>(c.a1);
+            a2[(size_t) newNumSections] = static_cast<SampleType>(c.a2);
+            newSlots[(size_t) newNumSections++] = slot;
+        };
+
+        for (int i = 0; i < coefficientSet.lowCut.getNumSections(); ++i)
+            addSection(lowCutSlot(i), coefficientSet.lowCut.sections[(size_t) i]);
+
+        if (! coefficientSet.peak.isIdentity())
+            addSection(peakSlot(), coefficientSet.peak);
+
+        for (int i = 0; i < coefficientSet.highCut.getNumSections(); ++i)
+            addSection(highCutSlot(i), coefficientSet.highCut.sections[(size_t) i]);
+
+        if (newNumSections != numSections || newSlots != slots)
+            remapState(newSlots, newNumSections);
+
+        slots = newSlots;
+        numSections = newNumSections;
+        kernel = getKernel(numSections);
+    }
+
+    // gives every lane of a SIMDRegister its own set, lanes without one
+    // pass their signal through. The cascade runs every slot that is live
+    // in any lane, lanes that do not use a slot get an identity section
+    // there, so each lane's state stays in the slot it belongs to.
+    void setLaneCoefficients(const CoefficientSet* const* laneSets, size_t numLaneSets) noexcept
+    {
+        jassert(numLaneSets <= getNumLanes());
+
+        SectionSlots newSlots {};
+        int newNumSections = 0;
+
+        // per section, the lanes that pass through it
+        std::array<std::array<bool, getNumLanes()>, maxSections> idle {};
+
+        for (int slot = 0; slot < maxSections; ++slot)
+        {
+            auto live = false;
+
+            for (size_t lane = 0; lane < numLaneSets; ++lane)
+                live = live || (laneSets[lane] != nullptr && getSlotSection(*laneSets[lane], slot) != nullptr);
+
+            if (! live)
+                continue;
+
+            for (size_t lane = 0; lane < getNumLanes(); ++lane)
+            {
+                static const BiquadCoefficients identity;
+                auto* laneSet = lane < numLaneSets ? laneSets[lane] : nullptr;
+                auto* section = laneSet != nullptr ? getSlotSection(*laneSet, slot) : nullptr;
+                const auto& c = section != nullptr ? *section : identity;
+
+                idle[(size_t) newNumSections][lane] = section == nullptr;
+
+                setLane(b0[(size_t) newNumSections], lane, c.b0);
+                setLane(b1[(size_t) newNumSections], lane, c.b1);
+                setLane(b2[(size_t) newNumSections], lane, c.b2);
+                setLane(a1[(size_t) newNumSections], lane, c.a1);
+                setLane(a2[(size_t) newNumSections], lane, c.a2);
+            }
+
+            newSlots[(size_t) newNumSections++] = slot;
+        }
+
+        if (newNumSections != numSections || newSlots != slots)
+            remapState(newSlots, newNumSections);
+
+        // a lane that stops using a section drops its state, just as a
+        // single eq drops the state of a section that is switched off
+        for (int path = 0; path < numPaths; ++path)
+            for (int n = 0; n < newNumSections; ++n)
+                for (size_t lane = 0; lane < getNumLanes(); ++lane)
+                    if (idle[(size_t) n][lane])
+                    {
+                        setLane(state1[(size_t) (path * maxSections + n)], lane, 0.0);
+                        setLane(state2[(size_t) (path * maxSections + n)], lane, 0.0);
+                    }
+
+        slots = newSlots;
+        numSections = newNumSections;
+        kernel = getKernel(numSections);
+    }
+
+    // 1 for float and double, the register width for a SIMDRegister
+    static constexpr size_t getNumLanes() noexcept
+    {
+        if constexpr (std::is_floating_point<SampleType>::value)
+            return 1;
+        else
+            return SampleType::size();
+    }
+
+    int getNumSections() const noexcept { return numSections; }
+
+    // filters every channel of the block in place, channel n uses path n
+    void process(juce::dsp::AudioBlock<SampleType>& block) noexcept
+    {
+        auto channelsToProcess = juce::jmin((int) block.getNumChannels(), numPaths);
+
+        for (int channel = 0; channel < channelsToProcess; ++channel)
+            process(block.getChannelPointer((size_t) channel), block.getNumSamples(), channel);
+    }
+
+    // filters one signal in place with the state of the given path
+    void process(SampleType* samples, size_t numSamples, int path) noexcept
+    {
+        jassert(juce::isPositiveAndBelow(path, numPaths));
+        (this->*kernel)(samples, numSamples, path);
+    }
+
+private:
+    //==============================================================================
+    // transposed direct form II, the same structure as
+    // juce::dsp::IIR::Filter so both engines sound identical
+    static SampleType processSection(SampleType x, SampleType c0, SampleType c1, SampleType c2,
+                                     SampleType d1, SampleType d2, SampleType& z1, SampleType& z2) noexcept
+    {
+        auto y = c0 * x + z1;
+        z1 = c1 * x - d1 * y + z2;
+        z2 = c2 * x - d2 * y;
+        return y;
+    }
+
+    // the kernel for exactly sizeof...(Sections) live sections
+    template <size_t... Sections>
+    void processSections(SampleType* samples, size_t numSamples, int path, std::index_sequence<Sections...>) noexcept
+    {
+        constexpr auto numKernelSections = sizeof...(Sections);
+
+        auto* s1 = state1.data() + path * maxSections;
+        auto* s2 = state2.data() + path * maxSections;
+
+        // keep the coefficients and the state in locals while we loop, the
+        // compiler can then hold them in registers instead of going back
+        // to memory every sample
+        const SampleType c0[numKernelSections] { b0[Sections]... }, c1[numKernelSections] { b1[Sections]... },
+                         c2[numKernelSections] { b2[Sections]... }, d1[numKernelSections] { a1[Sections]... },
+                         d2[numKernelSections] { a2[Sections]... };
+        SampleType z1[numKernelSections] { s1[Sections]... }, z2[numKernelSections] { s2[Sections]... };
+
+        for (size_t i = 0; i < numSamples; ++i)
+        {
+            auto x = samples[i];
+
+            // one step per section, in order, with no loop left over them
+            ((x = processSection(x, c0[Sections], c1[Sections], c2[Sections], d1[Sections], d2[Sections],
+                                 z1[Sections], z2[Sections])), ...);
+
+            samples[i] = x;
+        }
+
+        // flush denormals that could otherwise stay in the state forever
+        ((juce::dsp::util::snapToZero(z1[Sections]), juce::dsp::util::snapToZero(z2[Sections])), ...);
+        ((s1[Sections] = z1[Sections], s2[Sections] = z2[Sections]), ...);
+    }
+
+    template <size_t NumSections>
+    void processKernel(SampleType* samples, size_t numSamples, int path) noexcept
+    {
+        // every band does nothing, the signal passes through untouched
+        if constexpr (NumSections == 0)
+            juce::ignoreUnused(samples, numSamples, path);
+        else
+            processSections(samples, numSamples, path, std::make_index_sequence<NumSections>());
+    }
+
+    using Kernel = void (SosCascade::*)(SampleType*, size_t, int) noexcept;
+
+    // kernels[n] runs n sections
+    template <size_t... Counts>
+    static constexpr std::array<Kernel, sizeof...(Counts)> makeKernels(std::index_sequence<Counts...>) noexcept
+    {
+        return { &SosCascade::processKernel<Counts>... };
+    }
+
+    static constexpr Kernel getKernel(int numLiveSections) noexcept
+    {
+        constexpr auto kernels = makeKernels(std::make_index_sequence<maxSections + 1>());
+        return kernels[(size_t) numLiveSections];
+    }
+
+    //==============================================================================
+    static void setLane(SampleType& target, size_t lane, double value) noexcept
+    {
+        if constexpr (std::is_floating_point<SampleType>::value)
+        {
+            jassert(lane == 0);
+            juce::ignoreUnused(lane);
+            target = static_cast<SampleType>(value);
+        }
+        else
+        {
+            target.set(lane, static_cast<typename SampleType::ElementType>(value));
+        }
+    }
+
+    // moves each section's state to its new position in the packed arrays
+    void remapState(const SectionSlots& newSlots, int newNumSections) noexcept
+    {
+        for (int path = 0; path < numPaths; ++path)
+        {
+            remapSectionState(state1.data() + path * maxSections, slots, numSections, newSlots, newNumSections);
+            remapSectionState(state2.data() + path * maxSections, slots, numSections, newSlots, newNumSections);
+        }
+    }
+
+    std::array<SampleType, maxSections> b0 {}, b1 {}, b2 {}, a1 {}, a2 {};
+    SectionSlots slots {};
+    int numSections { 0 };
+    Kernel kernel { getKernel(0) };
+
+    // per path state, maxSections values per path
+    std::vector<SampleType> state1, state2;
+    int numPaths { 0 };
+};
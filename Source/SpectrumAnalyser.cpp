@@ -0,0 +1,248 @@
+/*
+  ==============================================================================
+
+    SpectrumAnalyser.cpp
+
+  ==============================================================================
+*/
+
+#include "SpectrumAnalyser.h"
+
+SpectrumAnalyser::SpectrumAnalyser()
+    : juce::Thread("SimpleEQ spectrum analyser")
+{
+    window.resize((size_t) fftSize);
+    juce::dsp::WindowingFunction<float>::fillWindowingTables(window.data(), (size_t) fftSize,
+                                                             juce::dsp::WindowingFunction<float>::hann, false);
+
+    // a sine of amplitude 1 peaks at sum(window) / 2 in its bin
+    auto windowSum = std::accumulate(window.begin(), window.end(), 0.f);
+    powerScale = (2.f / windowSum) * (2.f / windowSum);
+
+    // the frequency only transform needs twice the fft size to work in
+    fftData.resize((size_t) fftSize * 2);
+
+    for (auto& tap : taps)
+    {
+        tap.history.resize((size_t) fftSize);
+        tap.averagedPower.resize((size_t) fftSize / 2 + 1);
+    }
+}
+
+SpectrumAnalyser::~SpectrumAnalyser()
+{
+    stopThread(1000);
+}
+
+void SpectrumAnalyser::prepare(double newSampleRate)
+{
+    const juce::ScopedLock sl(stateLock);
+    stopThread(1000);
+
+    sampleRate = newSampleRate;
+
+    // 88.2 kHz and up are averaged down to 44.1-48 kHz before the fft.
+    // The boxcar is a poor anti-aliasing filter, but good enough for a
+    // display that ends at 20 kHz, and it keeps the bins narrow
+    decimationFactor = juce::jmax(1, (int) (sampleRate / 44100.0));
+    auto analysedRate = sampleRate / decimationFactor;
+
+    // half a second of audio, the thread drains the fifos far more often
+    auto fifoSize = juce::jmax(2, juce::roundToInt(sampleRate * 0.5));
+
+    for (auto& tap : taps)
+    {
+        tap.samples.assign((size_t) fifoSize, 0.f);
+        tap.fifo.setTotalSize(fifoSize);
+        tap.fifo.reset();
+    }
+
+    // the range of fft bins that falls onto each display point
+    auto toBin = [analysedRate](double position)
+    {
+        auto frequency = juce::mapToLog10(position, minFrequency, maxFrequency);
+        return (float) juce::jlimit(0.0, fftSize / 2.0, frequency * fftSize / analysedRate);
+    };
+
+    displayBins.resize((size_t) numDisplayPoints);
+
+    for (int point = 0; point < numDisplayPoints; ++point)
+    {
+        auto position = (double) point / (numDisplayPoints - 1);
+        auto halfStep = 0.5 / (numDisplayPoints - 1);
+        displayBins[(size_t) point] = { toBin(position - halfStep), toBin(position), toBin(position + halfStep) };
+    }
+
+    if (active.load())
+        startThread();
+}
+
+void SpectrumAnalyser::setActive(bool shouldBeActive)
+{
+    const juce::ScopedLock sl(stateLock);
+
+    if (shouldBeActive == active.load())
+        return;
+
+    active.store(shouldBeActive);
+
+    // the audio thread stops pushing as soon as it sees the flag,
+    // whatever it still queued is dropped when the thread restarts
+    if (! shouldBeActive)
+        stopThread(1000);
+    else if (sampleRate > 0.0)
+        startThread();
+}
+
+void SpectrumAnalyser::run()
+{
+    // start from scratch rather than show what was playing when the
+    // editor was last open
+    for (auto& tap : taps)
+    {
+        tap.fifo.finishedRead(tap.fifo.getNumReady());
+        std::fill(tap.history.begin(), tap.history.end(), 0.f);
+        std::fill(tap.averagedPower.begin(), tap.averagedPower.end(), 0.f);
+        tap.historyPosition = 0;
+        tap.decimationSum = 0.f;
+        tap.decimationCount = 0;
+        tap.samplesSinceLastFft = 0;
+    }
+
+    lastSpectrumWasSilent = false;
+
+    while (! threadShouldExit())
+    {
+        auto analysed = false;
+
+        for (auto& tap : taps)
+            if (analyse(tap))
+                analysed = true;
+
+        if (analysed)
+            publish();
+
+        // the fifos hold half a second, so this is plenty
+        wait(20);
+    }
+}
+
+bool SpectrumAnalyser::analyse(Tap& tap)
+{
+    auto ranFft = false;
+
+    int start1, size1, start2, size2;
+    tap.fifo.prepareToRead(tap.fifo.getNumReady(), start1, size1, start2, size2);
+
+    auto consume = [&](const float* samples, int numSamples)
+    {
+        for (int i = 0; i < numSamples; ++i)
+        {
+            tap.decimationSum += samples[i];
+
+            if (++tap.decimationCount < decimationFactor)
+                continue;
+
+            tap.history[(size_t) tap.historyPosition] = tap.decimationSum / (float) decimationFactor;
+            tap.historyPosition = (tap.historyPosition + 1) & (fftSize - 1);
+            tap.decimationSum = 0.f;
+            tap.decimationCount = 0;
+
+            if (++tap.samplesSinceLastFft == hopSize)
+            {
+                performFft(tap);
+                tap.samplesSinceLastFft = 0;
+                ranFft = true;
+            }
+        }
+    };
+
+    consume(tap.samples.data() + start1, size1);
+    consume(tap.samples.data() + start2, size2);
+    tap.fifo.finishedRead(size1 + size2);
+
+    return ranFft;
+}
+
+void SpectrumAnalyser::performFft(Tap& tap)
+{
+    // the oldest sample sits at the write position of the history
+    for (int i = 0; i < fftSize; ++i)
+        fftData[(size_t) i] = tap.history[(size_t) ((tap.historyPosition + i) & (fftSize - 1))] * window[(size_t) i];
+
+    std::fill(fftData.begin() + fftSize, fftData.end(), 0.f);
+    fft.performFrequencyOnlyForwardTransform(fftData.data());
+
+    // exponential average over about five frames (~100 ms at 48 kHz),
+    // steady enough to read without lagging behind the music
+    constexpr float averaging = 0.2f;
+
+    for (size_t bin = 0; bin < tap.averagedPower.size(); ++bin)
+    {
+        auto power = fftData[bin] * fftData[bin] * powerScale;
+        tap.averagedPower[bin] += averaging * (power - tap.averagedPower[bin]);
+    }
+}
+
+float SpectrumAnalyser::getDecibelsAt(const Tap& tap, int point) const noexcept
+{
+    const auto& bins = displayBins[(size_t) point];
+    const auto& power = tap.averagedPower;
+    auto lastBin = (int) power.size() - 1;
+    float value;
+
+    if (bins.high - bins.low < 1.f)
+    {
+        // at the bottom there are more points than bins, interpolate
+        auto index = juce::jmin((int) bins.centre, lastBin);
+        auto next = juce::jmin(index + 1, lastBin);
+        auto fraction = bins.centre - (float) index;
+        value = power[(size_t) index] + fraction * (power[(size_t) next] - power[(size_t) index]);
+    }
+    else
+    {
+        // further up each point shows the loudest bin it covers, so a
+        // tone reads at its level however many bins share its point
+        auto first = juce::jmin(juce::roundToInt(bins.low), lastBin);
+        auto last = juce::jlimit(first, lastBin, juce::roundToInt(bins.high));
+        value = *std::max_element(power.begin() + first, power.begin() + last + 1);
+    }
+
+    return 10.f * std::log10(juce::jmax(value, 1.0e-12f));
+}
+
+bool SpectrumAnalyser::buildPath(const Tap& tap, juce::Path& path) const
+{
+    auto audible = false;
+    path.clear();
+
+    for (int point = 0; point < numDisplayPoints; ++point)
+    {
+        auto decibels = getDecibelsAt(tap, point);
+        audible = audible || decibels > minDecibels;
+
+        auto x = (float) point / (numDisplayPoints - 1);
+        auto y = juce::jmap(juce::jlimit(minDecibels, maxDecibels, decibels), minDecibels, maxDecibels, 1.f, 0.f);
+
+        if (point == 0)
+            path.startNewSubPath(x, y);
+        else
+            path.lineTo(x, y);
+    }
+
+    return audible;
+}
+
+void SpectrumAnalyser::publish()
+{
+    auto& spectrum = exchange.getWriteBuffer();
+    auto preAudible = buildPath(taps[PreEq], spectrum.preEq);
+    auto postAudible = buildPath(taps[PostEq], spectrum.postEq);
+    auto audible = preAudible || postAudible;
+
+    // one flat spectrum is enough, after that the editor has nothing to redraw
+    if (audible || ! lastSpectrumWasSilent)
+        exchange.publish();
+
+    lastSpectrumWasSilent = ! audible;
+}
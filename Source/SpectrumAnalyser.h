@@ -0,0 +1,173 @@
+/*
+  ==============================================================================
+
+    SpectrumAnalyser.h
+
+    Pre and post eq spectrum for the editor.
+
+    The audio thread only mixes each block down to mono and copies it into
+    a wait-free single producer / single consumer fifo (juce::AbstractFifo),
+    once before and once after the eq. It never locks or allocates, and if
+    the analyser falls behind, samples are dropped rather than waited for.
+
+    A background thread decimates high sample rates down to about 48 kHz,
+    runs a Hann windowed juce::dsp::FFT with 75% overlap, averages the
+    power of every bin over time, bins it onto log spaced display points
+    and turns the result into two Paths in a unit square. The editor picks
+    those up through a TripleBuffer and only has to scale and stroke them.
+
+    Nothing runs while the editor is closed: the thread is stopped and the
+    audio thread skips both taps after a single flag check.
+
+    Audio thread budget: the two taps may add at most
+    maxAudioThreadOverhead to processBlock at the benchmark baseline
+    (48 kHz, 512 samples, stereo), see the "analyser" rows of the
+    benchmarks. They cost one multiply-add per channel and sample each,
+    plus the fifo bookkeeping once per block.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "TripleBuffer.h"
+
+class SpectrumAnalyser : private juce::Thread
+{
+public:
+    SpectrumAnalyser();
+    ~SpectrumAnalyser() override;
+
+    // sizes the fifos and the display binning for a sample rate.
+    // Not real-time safe, call it from prepareToPlay
+    void prepare(double sampleRate);
+
+    // the editor switches the analyser on while it is open
+    void setActive(bool shouldBeActive);
+    bool isActive() const noexcept { return active.load(std::memory_order_relaxed); }
+
+    enum TapPoint
+    {
+        PreEq,
+        PostEq,
+        numTapPoints
+    };
+
+    // audio thread: queues the block mixed down to mono
+    template <typename SampleType>
+    void push(TapPoint tapPoint, const juce::AudioBuffer<SampleType>& buffer) noexcept
+    {
+        auto& tap = taps[(size_t) tapPoint];
+        auto numChannels = buffer.getNumChannels();
+
+        if (numChannels == 0)
+            return;
+
+        int start1, size1, start2, size2;
+        tap.fifo.prepareToWrite(buffer.getNumSamples(), start1, size1, start2, size2);
+
+        auto gain = 1.f / (float) numChannels;
+        mixDown(buffer, 0, tap.samples.data() + start1, size1, gain);
+        mixDown(buffer, size1, tap.samples.data() + start2, size2, gain);
+
+        tap.fifo.finishedWrite(size1 + size2);
+    }
+
+    // the spectra as paths in a unit square: x from minFrequency to
+    // maxFrequency (log), y from maxDecibels at 0 to minDecibels at 1
+    struct Spectrum
+    {
+        juce::Path preEq, postEq;
+    };
+
+    // message thread: the newest spectrum, or nullptr if there is none
+    // since the last call. It stays valid until the next call
+    const Spectrum* acquireSpectrum() noexcept { return exchange.acquire(); }
+
+    static constexpr int fftOrder = 12;
+    static constexpr int fftSize = 1 << fftOrder;
+    static constexpr int hopSize = fftSize / 4;
+    static constexpr int numDisplayPoints = 256;
+
+    static constexpr double minFrequency = 20.0;
+    static constexpr double maxFrequency = 20000.0;
+    static constexpr float minDecibels = -96.f;
+    static constexpr float maxDecibels = 0.f;
+
+    // share of processBlock the taps may cost, see the benchmarks
+    static constexpr double maxAudioThreadOverhead = 0.05;
+
+private:
+    template <typename SampleType>
+    static void mixDown(const juce::AudioBuffer<SampleType>& buffer, int offset,
+                        float* destination, int numSamples, float gain) noexcept
+    {
+        for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
+        {
+            auto* source = buffer.getReadPointer(channel, offset);
+
+            if (channel == 0)
+                for (int i = 0; i < numSamples; ++i)
+                    destination[i] = (float) source[i] * gain;
+            else
+                for (int i = 0; i < numSamples; ++i)
+                    destination[i] += (float) source[i] * gain;
+        }
+    }
+
+    // one analysed signal
+    struct Tap
+    {
+        // audio thread -> analyser thread
+        juce::AbstractFifo fifo { 1 };
+        std::vector<float> samples = std::vector<float>(1);
+
+        // analyser thread only
+        std::vector<float> history;
+        int historyPosition { 0 };
+        float decimationSum { 0.f };
+        int decimationCount { 0 };
+        int samplesSinceLastFft { 0 };
+        std::vector<float> averagedPower;
+    };
+
+    void run() override;
+
+    // pulls everything queued in a tap, returns true if an fft ran
+    bool analyse(Tap& tap);
+    void performFft(Tap& tap);
+
+    // log binned display value of a point, in dB
+    float getDecibelsAt(const Tap& tap, int point) const noexcept;
+
+    // returns false if the whole spectrum is below minDecibels
+    bool buildPath(const Tap& tap, juce::Path& path) const;
+    void publish();
+
+    juce::dsp::FFT fft { fftOrder };
+    std::vector<float> window, fftData;
+
+    // scales the squared fft magnitude so a full scale sine reads 0 dB
+    float powerScale { 1.f };
+
+    // fft bin range of every display point
+    struct DisplayBin
+    {
+        float low, centre, high;
+    };
+    std::vector<DisplayBin> displayBins;
+
+    std::array<Tap, numTapPoints> taps;
+    int decimationFactor { 1 };
+    bool lastSpectrumWasSilent { false };
+
+    TripleBuffer<Spectrum> exchange;
+
+    // setActive and prepare both start and stop the thread
+    juce::CriticalSection stateLock;
+    std::atomic<bool> active { false };
+    double sampleRate { 0.0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SpectrumAnalyser)
+};
@@ -0,0 +1,207 @@
+/*
+  ==============================================================================
+
+    StageProfiler.cpp
+
+  ==============================================================================
+*/
+
+#include "StageProfiler.h"
+
+juce::String StageProfiler::getStageName(int stage)
+{
+    switch (stage)
+    {
+        case ReadParameters:    return "read parameters";
+        case CoefficientDesign: return "coefficient design";
+        case CoefficientUpdate: return "coefficient update";
+        case AnalyserTaps:      return "analyser taps";
+        case LowCut:            return "low cut";
+        case Peak:              return "peak";
+        case HighCut:           return "high cut";
+        case Filtering:         return "filtering";
+        case DynamicBand:       return "dynamic band";
+        case Bank:              return "filter bank";
+        default:                return "processBlock";
+    }
+}
+
+StageProfiler::StageProfiler()
+    : records((size_t) ringSize)
+{
+    trace.reserve((size_t) maxTraceBlocks);
+}
+
+//==============================================================================
+void StageProfiler::Histogram::add(juce::int64 cycles) noexcept
+{
+    auto bucket = cycles > 0 ? (int) (std::log2((double) cycles) * bucketsPerOctave) : 0;
+    ++counts[(size_t) juce::jlimit(0, numBuckets - 1, bucket)];
+    ++count;
+    sum += (double) cycles;
+    max = juce::jmax(max, cycles);
+}
+
+void StageProfiler::Histogram::merge(const Histogram& other) noexcept
+{
+    for (size_t i = 0; i < counts.size(); ++i)
+        counts[i] += other.counts[i];
+
+    count += other.count;
+    sum += other.sum;
+    max = juce::jmax(max, other.max);
+}
+
+double StageProfiler::Histogram::getPercentile(double percentile) const noexcept
+{
+    if (count == 0)
+        return 0.0;
+
+    auto rank = (juce::int64) std::ceil(percentile / 100.0 * (double) count);
+    juce::int64 seen = 0;
+
+    for (int bucket = 0; bucket < numBuckets; ++bucket)
+    {
+        seen += counts[(size_t) bucket];
+
+        if (seen >= juce::jmax((juce::int64) 1, rank))
+            return juce::jmin((double) max, std::exp2((bucket + 1) / (double) bucketsPerOctave));
+    }
+
+    return (double) max;
+}
+
+void StageProfiler::Report::merge(const Report& other) noexcept
+{
+    for (size_t i = 0; i < histograms.size(); ++i)
+        histograms[i].merge(other.histograms[i]);
+
+    numBlocks += other.numBlocks;
+    numDeadlineMisses += other.numDeadlineMisses;
+    numDroppedBlocks += other.numDroppedBlocks;
+    totalCycles += other.totalCycles;
+    totalSeconds += other.totalSeconds;
+    maxLoad = juce::jmax(maxLoad, other.maxLoad);
+}
+
+//==============================================================================
+void StageProfiler::collect()
+{
+    const juce::ScopedLock sl(statisticsLock);
+
+    int start1, size1, start2, size2;
+    ring.prepareToRead(ring.getNumReady(), start1, size1, start2, size2);
+
+    auto addRecords = [this](int start, int size)
+    {
+        for (int i = start; i < start + size; ++i)
+        {
+            const auto& record = records[(size_t) i];
+
+            for (int stage = 0; stage < numStages; ++stage)
+                if (record.stageCycles[(size_t) stage] > 0)
+                    report.histograms[(size_t) stage].add(record.stageCycles[(size_t) stage]);
+
+            report.histograms[numStages].add(record.cycles);
+
+            // the host needs the block back before the next one is due
+            auto seconds = juce::Time::highResolutionTicksToSeconds(record.ticks);
+            auto period = record.numSamples / record.sampleRate;
+            auto load = period > 0.0 ? seconds / period : 0.0;
+
+            if (load > 1.0)
+                ++report.numDeadlineMisses;
+
+            report.maxLoad = juce::jmax(report.maxLoad, load);
+            report.totalCycles += (double) record.cycles;
+            report.totalSeconds += seconds;
+            ++report.numBlocks;
+
+            if (trace.size() < (size_t) maxTraceBlocks)
+                trace.push_back(record);
+        }
+    };
+
+    addRecords(start1, size1);
+    addRecords(start2, size2);
+    ring.finishedRead(size1 + size2);
+
+    report.numDroppedBlocks = numDroppedBlocks.load();
+}
+
+void StageProfiler::resetStatistics()
+{
+    const juce::ScopedLock sl(statisticsLock);
+    report = {};
+    trace.clear();
+    numDroppedBlocks.store(0);
+}
+
+StageProfiler::Report StageProfiler::getReport() const
+{
+    const juce::ScopedLock sl(statisticsLock);
+    return report;
+}
+
+void StageProfiler::addTraceEvents(juce::Array<juce::var>& events, int threadId) const
+{
+    const juce::ScopedLock sl(statisticsLock);
+
+    if (trace.empty())
+        return;
+
+    auto firstTicks = trace.front().startTicks;
+
+    auto addEvent = [&events, threadId](const juce::String& name, double startMicros, double durationMicros,
+                                        juce::DynamicObject* args)
+    {
+        auto* event = new juce::DynamicObject();
+        event->setProperty("name", name);
+        event->setProperty("ph", "X");
+        event->setProperty("pid", 1);
+        event->setProperty("tid", threadId);
+        event->setProperty("ts", startMicros);
+        event->setProperty("dur", durationMicros);
+
+        if (args != nullptr)
+            event->setProperty("args", juce::var(args));
+
+        events.add(juce::var(event));
+    };
+
+    for (const auto& record : trace)
+    {
+        auto start = juce::Time::highResolutionTicksToSeconds(record.startTicks - firstTicks) * 1.0e6;
+        auto duration = juce::Time::highResolutionTicksToSeconds(record.ticks) * 1.0e6;
+
+        auto* args = new juce::DynamicObject();
+        args->setProperty("samples", record.numSamples);
+        args->setProperty("cycles", record.cycles);
+        args->setProperty("deadlineMicros", record.numSamples / record.sampleRate * 1.0e6);
+        addEvent(getStageName(numStages), start, duration, args);
+
+        // the block's own ratio turns its stage cycles into time
+        auto microsPerCycle = record.cycles > 0 ? duration / (double) record.cycles : 0.0;
+
+        for (int stage = 0; stage < numStages; ++stage)
+        {
+            auto cycles = record.stageCycles[(size_t) stage];
+
+            if (cycles == 0)
+                continue;
+
+            auto stageDuration = (double) cycles * microsPerCycle;
+            addEvent(getStageName(stage), start, stageDuration, nullptr);
+            start += stageDuration;
+        }
+    }
+}
+
+bool StageProfiler::writeChromeTrace(const juce::File& file, const juce::Array<juce::var>& events)
+{
+    auto* root = new juce::DynamicObject();
+    root->setProperty("traceEvents", events);
+    root->setProperty("displayTimeUnit", "ns");
+
+    return file.replaceWithText(juce::JSON::toString(juce::var(root)));
+}
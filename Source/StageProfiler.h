@@ -0,0 +1,237 @@
+/*
+  ==============================================================================
+
+    StageProfiler.h
+
+    Per stage timing of the audio thread, to find out where the time of a
+    spiking instance went.
+
+    The audio thread brackets each processBlock with beginBlock() and
+    endBlock() and each stage with a ScopedStage. The cycles of every stage
+    are summed up per block and the finished block is pushed into a lock
+    free ring (juce::AbstractFifo), nothing else happens on the audio
+    thread. Another thread calls collect() now and then to move the blocks
+    into per stage histograms, deadline miss counts against the block
+    period and a trace that can be written as Chrome trace JSON
+    (chrome://tracing, Perfetto).
+
+    Profiling is off until setEnabled(true) is called, which leaves one
+    flag check per block and per stage. Building with SIMPLEEQ_PROFILING=0
+    removes even that.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+#if JUCE_INTEL
+ #include <x86intrin.h>
+#endif
+
+#ifndef SIMPLEEQ_PROFILING
+ #define SIMPLEEQ_PROFILING 1
+#endif
+
+class StageProfiler
+{
+public:
+    enum Stage
+    {
+        ReadParameters,     // the SmoothedSvf engine reading the apvts
+        CoefficientDesign,  // the SmoothedSvf engine designing on its grid
+        CoefficientUpdate,  // picking up coefficients from the designer
+        AnalyserTaps,       // queueing samples for the spectrum analyser
+        LowCut,             // the bands of the ProcessorChain engine
+        Peak,
+        HighCut,
+        Filtering,          // the engines that run all bands in one pass
+        DynamicBand,        // the peak band in dynamic mode, see DynamicPeak.h
+        Bank,               // the user bands, see FilterBank.h
+        numStages
+    };
+
+    static juce::String getStageName(int stage);
+
+    // the time stamp counter on intel, high resolution ticks elsewhere
+    static juce::int64 getCycles() noexcept
+    {
+       #if JUCE_INTEL
+        return (juce::int64) __rdtsc();
+       #else
+        return juce::Time::getHighResolutionTicks();
+       #endif
+    }
+
+    StageProfiler();
+
+    // can be called from any thread, takes effect from the next block
+    void setEnabled(bool shouldBeEnabled) noexcept { enabled.store(shouldBeEnabled && SIMPLEEQ_PROFILING); }
+    bool isEnabled() const noexcept { return enabled.load(std::memory_order_relaxed); }
+
+    //==============================================================================
+    // audio thread
+
+    void beginBlock(int numSamples, double sampleRate) noexcept
+    {
+       #if SIMPLEEQ_PROFILING
+        recording = isEnabled() && sampleRate > 0.0;
+
+        if (! recording)
+            return;
+
+        current = {};
+        current.numSamples = numSamples;
+        current.sampleRate = sampleRate;
+        current.startTicks = juce::Time::getHighResolutionTicks();
+        blockStartCycles = getCycles();
+       #else
+        juce::ignoreUnused(numSamples, sampleRate);
+       #endif
+    }
+
+    void endBlock() noexcept
+    {
+       #if SIMPLEEQ_PROFILING
+        if (! recording)
+            return;
+
+        current.cycles = getCycles() - blockStartCycles;
+        current.ticks = juce::Time::getHighResolutionTicks() - current.startTicks;
+        recording = false;
+
+        // if nobody collects, the newest blocks are dropped
+        int start1, size1, start2, size2;
+        ring.prepareToWrite(1, start1, size1, start2, size2);
+
+        if (size1 == 0)
+        {
+            numDroppedBlocks.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        records[(size_t) start1] = current;
+        ring.finishedWrite(1);
+       #endif
+    }
+
+    // times the enclosing scope as part of a stage, several scopes of
+    // the same stage in one block add up
+    class ScopedStage
+    {
+    public:
+        ScopedStage(StageProfiler* profilerToUse, Stage stageToTime) noexcept
+           #if SIMPLEEQ_PROFILING
+            : profiler(profilerToUse != nullptr && profilerToUse->recording ? profilerToUse : nullptr),
+              stage(stageToTime),
+              start(profiler != nullptr ? getCycles() : 0)
+           #endif
+        {
+           #if ! SIMPLEEQ_PROFILING
+            juce::ignoreUnused(profilerToUse, stageToTime);
+           #endif
+        }
+
+        ~ScopedStage() noexcept
+        {
+           #if SIMPLEEQ_PROFILING
+            if (profiler != nullptr)
+                profiler->current.stageCycles[(size_t) stage] += getCycles() - start;
+           #endif
+        }
+
+    private:
+       #if SIMPLEEQ_PROFILING
+        StageProfiler* profiler;
+        Stage stage;
+        juce::int64 start;
+       #endif
+
+        JUCE_DECLARE_NON_COPYABLE (ScopedStage)
+    };
+
+    //==============================================================================
+    // one thread other than the audio thread
+
+    // cycle histogram with four buckets per octave, so percentiles are
+    // accurate to within a quarter octave (19%)
+    struct Histogram
+    {
+        static constexpr int bucketsPerOctave = 4;
+        static constexpr int numBuckets = 64 * bucketsPerOctave;
+
+        void add(juce::int64 cycles) noexcept;
+        void merge(const Histogram& other) noexcept;
+
+        // upper edge of the bucket the percentile falls into, in cycles
+        double getPercentile(double percentile) const noexcept;
+        double getMean() const noexcept { return count > 0 ? sum / (double) count : 0.0; }
+
+        std::array<juce::int64, numBuckets> counts {};
+        juce::int64 count { 0 }, max { 0 };
+        double sum { 0.0 };
+    };
+
+    // everything collected so far. Reports of several profilers (e.g. one
+    // per render thread) can be merged
+    struct Report
+    {
+        void merge(const Report& other) noexcept;
+
+        // the stages, and the whole block at index numStages
+        std::array<Histogram, numStages + 1> histograms;
+
+        juce::int64 numBlocks { 0 }, numDeadlineMisses { 0 }, numDroppedBlocks { 0 };
+
+        // to turn cycles into time
+        double totalCycles { 0.0 }, totalSeconds { 0.0 };
+        double getCyclesPerSecond() const noexcept { return totalSeconds > 0.0 ? totalCycles / totalSeconds : 0.0; }
+
+        // the largest share of its period a block took
+        double maxLoad { 0.0 };
+    };
+
+    // moves the finished blocks out of the ring
+    void collect();
+    void resetStatistics();
+
+    Report getReport() const;
+
+    // one complete event per block, and per stage within it, with the
+    // stages laid out one after another (they may really interleave, e.g.
+    // channel by channel). Only the first maxTraceBlocks blocks are kept
+    static constexpr int maxTraceBlocks = 10000;
+    void addTraceEvents(juce::Array<juce::var>& events, int threadId) const;
+
+    static bool writeChromeTrace(const juce::File& file, const juce::Array<juce::var>& events);
+
+private:
+    struct BlockRecord
+    {
+        juce::int64 startTicks { 0 }, ticks { 0 }, cycles { 0 };
+        int numSamples { 0 };
+        double sampleRate { 0.0 };
+        std::array<juce::int64, numStages> stageCycles {};
+    };
+
+    std::atomic<bool> enabled { false };
+
+    // audio thread only
+    bool recording { false };
+    BlockRecord current;
+    juce::int64 blockStartCycles { 0 };
+
+    // audio thread -> collecting thread
+    static constexpr int ringSize = 1024;
+    juce::AbstractFifo ring { ringSize };
+    std::vector<BlockRecord> records;
+    std::atomic<juce::int64> numDroppedBlocks { 0 };
+
+    // collecting thread, guarded so getReport() can be called from elsewhere
+    juce::CriticalSection statisticsLock;
+    Report report;
+    std::vector<BlockRecord> trace;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (StageProfiler)
+};
@@ -0,0 +1,150 @@
+/*
+  ==============================================================================
+
+    SvfCascade.h
+
+    A cascade of topology preserving transform (TPT) state variable filters,
+    in the trapezoidal form described by Andrew Simper (Cytomic).
+
+    Unlike a direct form biquad, the state of an SVF stays meaningful when
+    its coefficients change, and every coefficient set with g > 0 and k > 0
+    is stable. That makes it the right topology when the coefficients move
+    while audio is running, e.g. under fast automation.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "SectionSlots.h"
+
+// one SVF section: the three solver coefficients derived from
+// g = tan(pi * f / fs) and the damping k, plus the output mix
+// y = m0 * input + m1 * bandpass + m2 * lowpass
+struct SvfCoefficients
+{
+    float a1 { 1.f }, a2 { 0.f }, a3 { 0.f };
+    float m0 { 1.f }, m1 { 0.f }, m2 { 0.f };
+
+    static SvfCoefficients make(float g, float k, float m0, float m1, float m2) noexcept
+    {
+        SvfCoefficients c;
+        c.a1 = 1.f / (1.f + g * (g + k));
+        c.a2 = g * c.a1;
+        c.a3 = g * c.a2;
+        c.m0 = m0;
+        c.m1 = m1;
+        c.m2 = m2;
+        return c;
+    }
+
+    static SvfCoefficients makeLowPass(float g, float k) noexcept   { return make(g, k, 0.f, 0.f, 1.f); }
+    static SvfCoefficients makeHighPass(float g, float k) noexcept  { return make(g, k, 1.f, -k, -1.f); }
+
+    // bell with gain A * A (A = 10^(dB / 40)), constant Q like makePeakFilter
+    static SvfCoefficients makeBell(float g, float q, float A) noexcept
+    {
+        auto k = 1.f / (q * A);
+        return make(g, k, 1.f, k * (A * A - 1.f), 0.f);
+    }
+};
+
+template <typename SampleType>
+class SvfCascade
+{
+public:
+    static constexpr int maxSections = maxEqSections;
+
+    // allocates the state of numPaths independent signals, not real-time safe
+    void prepare(int numPathsToUse)
+    {
+        numPaths = juce::jmax(1, numPathsToUse);
+        state1.assign((size_t) (numPaths * maxSections), SampleType(0));
+        state2.assign((size_t) (numPaths * maxSections), SampleType(0));
+        reset();
+    }
+
+    void reset() noexcept
+    {
+        std::fill(state1.begin(), state1.end(), SampleType(0));
+        std::fill(state2.begin(), state2.end(), SampleType(0));
+    }
+
+    // sets the active sections; each one is tagged with its eq slot
+    // (see SectionSlots.h) so its state survives slope changes
+    void setSections(const std::array<SvfCoefficients, maxSections>& newSections,
+                     const SectionSlots& newSlots, int newNumSections) noexcept
+    {
+        if (newNumSections != numSections || newSlots != slots)
+        {
+            for (int path = 0; path < numPaths; ++path)
+            {
+                remapSectionState(state1.data() + path * maxSections, slots, numSections, newSlots, newNumSections);
+                remapSectionState(state2.data() + path * maxSections, slots, numSections, newSlots, newNumSections);
+            }
+        }
+
+        for (int s = 0; s < newNumSections; ++s)
+        {
+            const auto& c = newSections[(size_t) s];
+            a1[(size_t) s] = static_cast<SampleType>(c.a1);
+            a2[(size_t) s] = static_cast<SampleType>(c.a2);
+            a3[(size_t) s] = static_cast<SampleType>(c.a3);
+            m0[(size_t) s] = static_cast<SampleType>(c.m0);
+            m1[(size_t) s] = static_cast<SampleType>(c.m1);
+            m2[(size_t) s] = static_cast<SampleType>(c.m2);
+        }
+
+        slots = newSlots;
+        numSections = newNumSections;
+    }
+
+    int getNumSections() const noexcept { return numSections; }
+
+    // filters one signal in place with the state of the given path
+    void process(SampleType* samples, size_t numSamples, int path) noexcept
+    {
+        jassert(juce::isPositiveAndBelow(path, numPaths));
+
+        auto* s1 = state1.data() + path * maxSections;
+        auto* s2 = state2.data() + path * maxSections;
+
+        std::array<SampleType, maxSections> ic1eq, ic2eq;
+        std::copy(s1, s1 + numSections, ic1eq.begin());
+        std::copy(s2, s2 + numSections, ic2eq.begin());
+
+        for (size_t i = 0; i < numSamples; ++i)
+        {
+            auto x = samples[i];
+
+            for (int s = 0; s < numSections; ++s)
+            {
+                auto v3 = x - ic2eq[(size_t) s];
+                auto v1 = a1[(size_t) s] * ic1eq[(size_t) s] + a2[(size_t) s] * v3;
+                auto v2 = ic2eq[(size_t) s] + a2[(size_t) s] * ic1eq[(size_t) s] + a3[(size_t) s] * v3;
+                ic1eq[(size_t) s] = SampleType(2) * v1 - ic1eq[(size_t) s];
+                ic2eq[(size_t) s] = SampleType(2) * v2 - ic2eq[(size_t) s];
+                x = m0[(size_t) s] * x + m1[(size_t) s] * v1 + m2[(size_t) s] * v2;
+            }
+
+            samples[i] = x;
+        }
+
+        for (int s = 0; s < numSections; ++s)
+        {
+            juce::dsp::util::snapToZero(ic1eq[(size_t) s]);
+            juce::dsp::util::snapToZero(ic2eq[(size_t) s]);
+            s1[s] = ic1eq[(size_t) s];
+            s2[s] = ic2eq[(size_t) s];
+        }
+    }
+
+private:
+    std::array<SampleType, maxSections> a1 {}, a2 {}, a3 {}, m0 {}, m1 {}, m2 {};
+    SectionSlots slots {};
+    int numSections { 0 };
+
+    std::vector<SampleType> state1, state2;
+    int numPaths { 0 };
+};
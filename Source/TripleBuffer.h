@@ -0,0 +1,63 @@
+/*
+  ==============================================================================
+
+    TripleBuffer.h
+
+    Wait-free single-producer / single-consumer handoff of a value.
+    The producer always owns one buffer, the consumer owns another and the
+    third one sits in the middle. Publishing and acquiring are a single
+    atomic exchange each, so neither side ever blocks, locks or allocates.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+template <typename ValueType>
+class TripleBuffer
+{
+public:
+    TripleBuffer() = default;
+
+    //==============================================================================
+    // producer side
+
+    // the buffer the producer may fill before calling publish()
+    ValueType& getWriteBuffer() noexcept { return buffers[(size_t) writeIndex]; }
+
+    // hands the write buffer over to the consumer and takes back the middle one
+    void publish() noexcept
+    {
+        auto previous = middle.exchange(writeIndex | freshBit, std::memory_order_acq_rel);
+        writeIndex = previous & indexMask;
+    }
+
+    //==============================================================================
+    // consumer side
+
+    // returns the most recently published value, or nullptr if nothing new
+    // was published since the last call
+    const ValueType* acquire() noexcept
+    {
+        // only the producer can set the fresh bit, so if we see it here it
+        // will still be set when we swap
+        if ((middle.load(std::memory_order_acquire) & freshBit) == 0)
+            return nullptr;
+
+        auto previous = middle.exchange(readIndex, std::memory_order_acq_rel);
+        readIndex = previous & indexMask;
+        return &buffers[(size_t) readIndex];
+    }
+
+private:
+    static constexpr int indexMask = 3;
+    static constexpr int freshBit = 4;
+
+    std::array<ValueType, 3> buffers;
+    std::atomic<int> middle { 1 };
+    int writeIndex { 0 }, readIndex { 2 };
+
+    JUCE_DECLARE_NON_COPYABLE (TripleBuffer)
+};